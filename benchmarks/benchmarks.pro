@@ -0,0 +1,7 @@
+# Benchmarks of the wrapper, built against its sources rather than the QML
+# plugin so that nothing of this ends up in the shipped library. Run them
+# with "make check", or run a benchmark executable directly to pass QtTest
+# options, eg: "-o results.xml,xml" to keep the results of a run for later
+# comparison.
+TEMPLATE = subdirs
+SUBDIRS += wrapper
@@ -0,0 +1,425 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvcore.h"
+#include "mpvobject.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMetaProperty>
+#include <QScopedPointer>
+#include <QTimer>
+#include <QtTest>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Measures the code of the wrapper on top of libmpv: opening and seeking,
+// MpvCore's event pump and dispatch, MpvObject's handling of property
+// changes and its getters, and the mpv_node conversions. Nothing is
+// rendered and no audio device is opened.
+class WrapperBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void coreOpen();
+    void coreSeek();
+    void coreEventDispatch();
+    void corePropertyNotifications();
+    void coreMemoryPerInstance();
+
+    void objectOpen();
+    void objectPropertyDispatch_data();
+    void objectPropertyDispatch();
+    void objectGetter_data();
+    void objectGetter();
+
+    void nodeBuilder();
+    void nodeToVariant();
+
+private:
+    QScopedPointer<MpvObject> m_player;
+};
+
+namespace {
+
+// Plays forever, and needs no file.
+const char m_syntheticSource[] = "av://lavfi:testsrc=size=1280x720:rate=30";
+// Commands sent before the events are drained, well below the size of
+// mpv's event queue.
+const int m_floodSize = 200;
+const int m_timeout = 30000;
+
+QString sourcePath()
+{
+    const QString source = qEnvironmentVariable("MPV_BENCHMARK_SOURCE");
+    return source.isEmpty() ? QString::fromUtf8(m_syntheticSource) : source;
+}
+
+// Without a window or an audio device, opening them would skew the open
+// latency and the memory per instance.
+bool initialize(MpvCore &core)
+{
+    core.setVideoOutput(false);
+    core.setQuiet(true);
+    return core.initialize()
+           && core.setMpvProperty(QString::fromUtf8("ao"), QString::fromUtf8("null"));
+}
+
+// Runs the event loop until "done" returns true, or the timeout expires.
+bool spinUntil(const std::function<bool()> &done, const int timeout = m_timeout)
+{
+    // Makes sure the loop below wakes up to check the timeout.
+    QTimer wakeUp;
+    wakeUp.start(50);
+    QElapsedTimer timer;
+    timer.start();
+    while (!done()) {
+        if (timer.elapsed() >= timeout) {
+            return false;
+        }
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    return true;
+}
+
+// Loads the source into the core and waits until it's loaded.
+bool load(MpvCore &core)
+{
+    bool loaded = false;
+    const QMetaObject::Connection connection
+        = QObject::connect(&core, &MpvCore::eventReceived, [&loaded](const mpv_event *event) {
+              if (event->event_id == MPV_EVENT_FILE_LOADED) {
+                  loaded = true;
+              }
+          });
+    const bool result = core.command(QVariantList{QString::fromUtf8("loadfile"), sourcePath()})
+                        && spinUntil([&loaded]() { return loaded; });
+    QObject::disconnect(connection);
+    return result;
+}
+
+// What can be seeked in without touching the source again, at least two
+// seconds of it.
+bool cachedRange(MpvCore &core, qreal *start, qreal *end)
+{
+    return spinUntil(
+        [&core, start, end]() {
+            const QVariantList ranges = core.mpvProperty(QString::fromUtf8("demuxer-cache-state"),
+                                                         true)
+                                            .toMap()
+                                            .value(QString::fromUtf8("seekable-ranges"))
+                                            .toList();
+            if (ranges.isEmpty()) {
+                return false;
+            }
+            const QVariantMap range = ranges.constFirst().toMap();
+            *start = range.value(QString::fromUtf8("start")).toReal();
+            *end = range.value(QString::fromUtf8("end")).toReal();
+            return (*end - *start) >= 2.0;
+        },
+        5000);
+}
+
+// In KiB, -1 if unknown.
+qint64 residentMemory()
+{
+    QFile status(QString::fromUtf8("/proc/self/status"));
+    if (!status.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return -1;
+    }
+    while (!status.atEnd()) {
+        const QByteArray line = status.readLine();
+        if (line.startsWith("VmRSS:")) {
+            return line.mid(6).trimmed().split(' ').constFirst().toLongLong();
+        }
+    }
+    return -1;
+}
+
+// Looks like what mpv reports for a file with a few tracks. "selected"
+// picks the video track that is selected, so that two lists differ.
+QVariantList sampleTrackList(const int selected = 0)
+{
+    QVariantList tracks = {};
+    for (int i = 0; i != 8; ++i) {
+        tracks.append(QVariantMap{
+            {QString::fromUtf8("id"), (i % 4) + 1},
+            {QString::fromUtf8("type"),
+             (i < 2) ? QString::fromUtf8("video")
+                     : ((i < 5) ? QString::fromUtf8("audio") : QString::fromUtf8("sub"))},
+            {QString::fromUtf8("src-id"), i},
+            {QString::fromUtf8("title"), QString::fromUtf8("Track %1").arg(i)},
+            {QString::fromUtf8("lang"), QString::fromUtf8("eng")},
+            {QString::fromUtf8("albumart"), false},
+            {QString::fromUtf8("default"), (i == 0)},
+            {QString::fromUtf8("forced"), false},
+            {QString::fromUtf8("external"), false},
+            {QString::fromUtf8("selected"), (i == selected)},
+            {QString::fromUtf8("codec"), QString::fromUtf8("h264")},
+            {QString::fromUtf8("demux-w"), 1920},
+            {QString::fromUtf8("demux-h"), 1080},
+            {QString::fromUtf8("demux-fps"), 23.976},
+            {QString::fromUtf8("ff-index"), i}});
+    }
+    return tracks;
+}
+
+QVariantList sampleChapterList(const int count)
+{
+    QVariantList chapters = {};
+    for (int i = 0; i != count; ++i) {
+        chapters.append(QVariantMap{{QString::fromUtf8("title"),
+                                     QString::fromUtf8("Chapter %1").arg(i)},
+                                    {QString::fromUtf8("time"), i * 60.0}});
+    }
+    return chapters;
+}
+
+} // namespace
+
+void WrapperBenchmark::initTestCase()
+{
+    m_player.reset(new MpvObject);
+    // Nothing is rendered without a window, don't let mpv wait for it.
+    QVERIFY2(initialize(*m_player->core()), "libmpv could not be loaded.");
+    QVERIFY(load(*m_player->core()));
+}
+
+void WrapperBenchmark::cleanupTestCase()
+{
+    m_player.reset();
+}
+
+void WrapperBenchmark::coreOpen()
+{
+    MpvCore core;
+    QVERIFY(initialize(core));
+    QBENCHMARK {
+        QVERIFY(load(core));
+    }
+}
+
+void WrapperBenchmark::coreSeek()
+{
+    MpvCore core;
+    QVERIFY(initialize(core));
+    // The synthetic source can't seek by itself, the demuxer cache makes
+    // what has been read so far seekable.
+    core.setMpvProperty(QString::fromUtf8("cache"), QString::fromUtf8("yes"));
+    QVERIFY(load(core));
+    qreal start = 0.0;
+    qreal end = 0.0;
+    if (!cachedRange(core, &start, &end)) {
+        QSKIP("Nothing to seek in.");
+    }
+    bool restarted = false;
+    connect(&core, &MpvCore::eventReceived, this, [&restarted](const mpv_event *event) {
+        if (event->event_id == MPV_EVENT_PLAYBACK_RESTART) {
+            restarted = true;
+        }
+    });
+    // Back and forth, so that every seek has to move.
+    bool forward = false;
+    QBENCHMARK {
+        restarted = false;
+        const qreal target = start + ((end - start) * (forward ? 0.8 : 0.2));
+        forward = !forward;
+        QVERIFY(core.command(QVariantList{QString::fromUtf8("seek"),
+                                          target,
+                                          QString::fromUtf8("absolute+exact")}));
+        QVERIFY(spinUntil([&restarted]() { return restarted; }));
+    }
+}
+
+void WrapperBenchmark::coreEventDispatch()
+{
+    MpvCore core;
+    QVERIFY(initialize(core));
+    int messages = 0;
+    connect(&core, &MpvCore::eventReceived, this, [&messages](const mpv_event *event) {
+        if (event->event_id == MPV_EVENT_CLIENT_MESSAGE) {
+            ++messages;
+        }
+    });
+    // A message is broadcast to every client, other handles of the pool
+    // don't matter though: they aren't pumped by this dispatcher.
+    const QVariantList message = {QString::fromUtf8("script-message"),
+                                  QString::fromUtf8("benchmark")};
+    QBENCHMARK {
+        messages = 0;
+        for (int i = 0; i != m_floodSize; ++i) {
+            core.command(message);
+        }
+        QVERIFY(spinUntil([&messages]() { return messages >= m_floodSize; }));
+    }
+}
+
+void WrapperBenchmark::corePropertyNotifications()
+{
+    MpvCore core;
+    QVERIFY(initialize(core));
+    int notifications = 0;
+    bool done = false;
+    connect(&core, &MpvCore::propertyChanged, this, [&notifications](const QString &name) {
+        if (name == QString::fromUtf8("volume")) {
+            ++notifications;
+        }
+    });
+    connect(&core, &MpvCore::eventReceived, this, [&done](const mpv_event *event) {
+        if (event->event_id == MPV_EVENT_CLIENT_MESSAGE) {
+            done = true;
+        }
+    });
+    // Events arrive in order, once the message is there every change
+    // notification before it has been dispatched.
+    const QVariantList sentinel = {QString::fromUtf8("script-message"),
+                                   QString::fromUtf8("benchmark")};
+    int round = 0;
+    QBENCHMARK {
+        done = false;
+        for (int i = 0; i != m_floodSize; ++i) {
+            core.setMpvProperty(QString::fromUtf8("volume"), (round + i) % 100);
+        }
+        ++round;
+        core.command(sentinel);
+        QVERIFY(spinUntil([&done]() { return done; }));
+    }
+    QVERIFY(notifications > 0);
+}
+
+void WrapperBenchmark::coreMemoryPerInstance()
+{
+    const qint64 before = residentMemory();
+    if (before < 0) {
+        QSKIP("The resident set size can't be read on this platform.");
+    }
+    const int instances = 4;
+    std::vector<std::unique_ptr<MpvCore>> cores = {};
+    for (int i = 0; i != instances; ++i) {
+        auto core = std::make_unique<MpvCore>();
+        QVERIFY(initialize(*core));
+        QVERIFY(load(*core));
+        cores.push_back(std::move(core));
+    }
+    const qreal perInstance = static_cast<qreal>(residentMemory() - before) / instances;
+    QTest::setBenchmarkResult(perInstance * 1024.0, QTest::BytesAllocated);
+}
+
+void WrapperBenchmark::objectOpen()
+{
+    MpvObject player;
+    QVERIFY(initialize(*player.core()));
+    bool loaded = false;
+    connect(&player, &MpvObject::loaded, this, [&loaded]() { loaded = true; });
+    QBENCHMARK {
+        loaded = false;
+        QVERIFY(player.core()->command(
+            QVariantList{QString::fromUtf8("loadfile"), sourcePath()}));
+        QVERIFY(spinUntil([&loaded]() { return loaded; }));
+    }
+}
+
+void WrapperBenchmark::objectPropertyDispatch_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<QVariant>("first");
+    QTest::addColumn<QVariant>("second");
+
+    QTest::newRow("time-pos") << QString::fromUtf8("time-pos") << QVariant(10.0)
+                              << QVariant(10.033);
+    // Observed without a value, the getters are notified only.
+    QTest::newRow("volume") << QString::fromUtf8("volume") << QVariant() << QVariant();
+    QTest::newRow("track-list") << QString::fromUtf8("track-list")
+                                << QVariant(sampleTrackList(0)) << QVariant(sampleTrackList(1));
+    QTest::newRow("chapter-list") << QString::fromUtf8("chapter-list")
+                                  << QVariant(sampleChapterList(20))
+                                  << QVariant(sampleChapterList(21));
+}
+
+void WrapperBenchmark::objectPropertyDispatch()
+{
+    QFETCH(QString, name);
+    QFETCH(QVariant, first);
+    QFETCH(QVariant, second);
+    MpvCore *core = m_player->core();
+    bool flip = false;
+    // What MpvCore emits for every property change notification.
+    QBENCHMARK {
+        Q_EMIT core->propertyChanged(name, flip ? second : first);
+        flip = !flip;
+    }
+}
+
+void WrapperBenchmark::objectGetter_data()
+{
+    QTest::addColumn<QByteArray>("property");
+
+    // Read the way QML bindings read them.
+    QTest::newRow("position") << QByteArray("position");
+    QTest::newRow("duration") << QByteArray("duration");
+    QTest::newRow("volume") << QByteArray("volume");
+    QTest::newRow("playbackState") << QByteArray("playbackState");
+    QTest::newRow("videoSize") << QByteArray("videoSize");
+    QTest::newRow("frameNumber") << QByteArray("frameNumber");
+    QTest::newRow("cacheBytes") << QByteArray("cacheBytes");
+}
+
+void WrapperBenchmark::objectGetter()
+{
+    QFETCH(QByteArray, property);
+    const QMetaObject *metaObject = m_player->metaObject();
+    const int index = metaObject->indexOfProperty(property.constData());
+    QVERIFY(index >= 0);
+    const QMetaProperty metaProperty = metaObject->property(index);
+    QBENCHMARK {
+        metaProperty.read(m_player.data());
+    }
+}
+
+void WrapperBenchmark::nodeBuilder()
+{
+    const QVariant trackList = sampleTrackList();
+    QBENCHMARK {
+        mpv::qt::node_builder node(trackList);
+        Q_UNUSED(node)
+    }
+}
+
+void WrapperBenchmark::nodeToVariant()
+{
+    const QVariant trackList = sampleTrackList();
+    mpv::qt::node_builder node(trackList);
+    QBENCHMARK {
+        mpv::qt::node_to_variant(node.node());
+    }
+}
+
+QTEST_MAIN(WrapperBenchmark)
+
+#include "tst_wrapper.moc"
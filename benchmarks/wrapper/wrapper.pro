@@ -0,0 +1,13 @@
+# Drives MpvCore and MpvObject with a real (or fake, see fakempv/) libmpv.
+# The source that is played can be changed through the
+# "MPV_BENCHMARK_SOURCE" environment variable, it defaults to a synthetic
+# lavfi source. No window is needed, use "QT_QPA_PLATFORM=offscreen" on
+# machines without a display.
+TEMPLATE = app
+TARGET = tst_wrapper
+QT += testlib
+CONFIG += testcase console utf8_source
+CONFIG -= app_bundle
+DEFINES += QT_NO_CAST_FROM_ASCII QT_NO_CAST_TO_ASCII
+include(../../mpvwrapper.pri)
+SOURCES += tst_wrapper.cpp
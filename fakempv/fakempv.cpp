@@ -0,0 +1,1131 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// A stand-in for libmpv that decodes nothing. It implements the part of the
+// client API the wrapper resolves when it's built with "dynamic_libmpv", and
+// produces scripted event streams instead of playing media, so that the
+// overhead of the wrapper itself (event dispatch, property handling, the
+// getters) can be profiled and compared between builds. Load it with:
+//
+//     WWX190_LIBMPV_PATH=/path/to/libfakempv.so
+//
+// Every handle starts with the settings of the environment variables below,
+// and can be reconfigured at runtime through the "fakempv-*" properties:
+//
+// - FAKEMPV_PROPERTY_RATE, "fakempv-property-rate": property change events
+//   per second, cycling through the observed properties (or the ones listed
+//   in FAKEMPV_FLOOD/"fakempv-flood", comma separated).
+// - FAKEMPV_LOG_RATE, "fakempv-log-rate": log messages per second, at
+//   FAKEMPV_LOG_LEVEL/"fakempv-log-level" ("info" by default). They are only
+//   sent if the client asked for that level with mpv_request_log_messages().
+// - FAKEMPV_FPS, "fakempv-fps": how often the render update callback fires.
+// - FAKEMPV_QUEUE_SIZE, "fakempv-queue-size": size of the event queue,
+//   MPV_EVENT_QUEUE_OVERFLOW is sent when it's full, like mpv does. Defaults
+//   to 1000.
+//
+// "loadfile", "stop", "seek", "script-message" and "quit" send the events
+// mpv would send, every other command succeeds and does nothing. Calls are
+// counted per function for the whole process, "fakempv-calls" returns them
+// as a map and "fakempv-calls/<function>" one of them. The command
+// "fakempv-reset-calls" clears them.
+
+#include <mpv/client.h>
+#include <mpv/render.h>
+#include <mpv/stream_cb.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define FAKEMPV_EXPORT extern "C" __declspec(dllexport)
+#else
+#define FAKEMPV_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+namespace {
+
+enum Api {
+    GetProperty,
+    SetProperty,
+    SetPropertyAsync,
+    CommandNode,
+    CommandNodeAsync,
+    LoadConfigFile,
+    ErrorString,
+    ObserveProperty,
+    RenderContextCreate,
+    RenderContextSetUpdateCallback,
+    RenderContextRender,
+    SetWakeupCallback,
+    Initialize,
+    RenderContextFree,
+    TerminateDestroy,
+    RequestLogMessages,
+    WaitEvent,
+    Create,
+    EventName,
+    FreeNodeContents,
+    StreamCbAddRo,
+    Free,
+    ApiCount
+};
+
+const char *const m_apiNames[ApiCount] = {"mpv_get_property",
+                                          "mpv_set_property",
+                                          "mpv_set_property_async",
+                                          "mpv_command_node",
+                                          "mpv_command_node_async",
+                                          "mpv_load_config_file",
+                                          "mpv_error_string",
+                                          "mpv_observe_property",
+                                          "mpv_render_context_create",
+                                          "mpv_render_context_set_update_callback",
+                                          "mpv_render_context_render",
+                                          "mpv_set_wakeup_callback",
+                                          "mpv_initialize",
+                                          "mpv_render_context_free",
+                                          "mpv_terminate_destroy",
+                                          "mpv_request_log_messages",
+                                          "mpv_wait_event",
+                                          "mpv_create",
+                                          "mpv_event_name",
+                                          "mpv_free_node_contents",
+                                          "mpv_stream_cb_add_ro",
+                                          "mpv_free"};
+
+std::atomic<int64_t> m_calls[ApiCount] = {};
+
+void count(const Api api)
+{
+    m_calls[api].fetch_add(1, std::memory_order_relaxed);
+}
+
+const char *const m_logLevels[] = {"fatal", "error", "warn", "info", "v", "debug", "trace"};
+
+// "no" and unknown levels are 0, like MPV_LOG_LEVEL_NONE.
+int logLevel(const std::string &name)
+{
+    for (int i = 0; i != 7; ++i) {
+        if (name == m_logLevels[i]) {
+            return (i + 1) * 10;
+        }
+    }
+    return MPV_LOG_LEVEL_NONE;
+}
+
+std::string environment(const char *name, const char *defaultValue)
+{
+    const char *value = std::getenv(name);
+    return (value && *value) ? std::string(value) : std::string(defaultValue);
+}
+
+std::vector<std::string> split(const std::string &list)
+{
+    std::vector<std::string> items = {};
+    std::string::size_type start = 0;
+    while (start < list.size()) {
+        const std::string::size_type end = list.find(',', start);
+        const std::string item = list.substr(start, end - start);
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    return items;
+}
+
+// A scalar property value. Maps and arrays are not stored, the wrapper
+// copes with them being unavailable.
+struct Value
+{
+    mpv_format format = MPV_FORMAT_NONE;
+    int64_t integer = 0;
+    double number = 0.0;
+    std::string string = {};
+
+    static Value fromFlag(const bool value)
+    {
+        Value result;
+        result.format = MPV_FORMAT_FLAG;
+        result.integer = value ? 1 : 0;
+        return result;
+    }
+    static Value fromInteger(const int64_t value)
+    {
+        Value result;
+        result.format = MPV_FORMAT_INT64;
+        result.integer = value;
+        return result;
+    }
+    static Value fromNumber(const double value)
+    {
+        Value result;
+        result.format = MPV_FORMAT_DOUBLE;
+        result.number = value;
+        return result;
+    }
+    static Value fromString(const std::string &value)
+    {
+        Value result;
+        result.format = MPV_FORMAT_STRING;
+        result.string = value;
+        return result;
+    }
+    static Value fromData(const mpv_format format, const void *data)
+    {
+        switch (format) {
+        case MPV_FORMAT_FLAG:
+            return fromFlag(*static_cast<const int *>(data) != 0);
+        case MPV_FORMAT_INT64:
+            return fromInteger(*static_cast<const int64_t *>(data));
+        case MPV_FORMAT_DOUBLE:
+            return fromNumber(*static_cast<const double *>(data));
+        case MPV_FORMAT_STRING:
+        case MPV_FORMAT_OSD_STRING:
+            return fromString(*static_cast<const char *const *>(data));
+        case MPV_FORMAT_NODE: {
+            const auto node = static_cast<const mpv_node *>(data);
+            switch (node->format) {
+            case MPV_FORMAT_FLAG:
+                return fromFlag(node->u.flag != 0);
+            case MPV_FORMAT_INT64:
+                return fromInteger(node->u.int64);
+            case MPV_FORMAT_DOUBLE:
+                return fromNumber(node->u.double_);
+            case MPV_FORMAT_STRING:
+                return fromString(node->u.string);
+            default:
+                return {};
+            }
+        }
+        default:
+            return {};
+        }
+    }
+
+    bool valid() const { return format != MPV_FORMAT_NONE; }
+    int64_t toInteger() const
+    {
+        switch (format) {
+        case MPV_FORMAT_DOUBLE:
+            return static_cast<int64_t>(number);
+        case MPV_FORMAT_STRING:
+            return std::strtoll(string.c_str(), nullptr, 10);
+        default:
+            return integer;
+        }
+    }
+    double toNumber() const
+    {
+        switch (format) {
+        case MPV_FORMAT_DOUBLE:
+            return number;
+        case MPV_FORMAT_STRING:
+            return std::strtod(string.c_str(), nullptr);
+        default:
+            return static_cast<double>(integer);
+        }
+    }
+    std::string toString() const
+    {
+        switch (format) {
+        case MPV_FORMAT_FLAG:
+            return integer ? "yes" : "no";
+        case MPV_FORMAT_INT64:
+            return std::to_string(integer);
+        case MPV_FORMAT_DOUBLE:
+            return std::to_string(number);
+        default:
+            return string;
+        }
+    }
+};
+
+char *duplicate(const std::string &string)
+{
+    auto copy = static_cast<char *>(std::malloc(string.size() + 1));
+    std::memcpy(copy, string.c_str(), string.size() + 1);
+    return copy;
+}
+
+// The node is freed with mpv_free_node_contents(), strings are allocated.
+void toNode(const Value &value, mpv_node *node)
+{
+    node->format = value.format;
+    switch (value.format) {
+    case MPV_FORMAT_FLAG:
+        node->u.flag = static_cast<int>(value.integer);
+        break;
+    case MPV_FORMAT_INT64:
+        node->u.int64 = value.integer;
+        break;
+    case MPV_FORMAT_DOUBLE:
+        node->u.double_ = value.number;
+        break;
+    case MPV_FORMAT_STRING:
+        node->u.string = duplicate(value.string);
+        break;
+    default:
+        node->format = MPV_FORMAT_NONE;
+        break;
+    }
+}
+
+std::string nodeToString(const mpv_node &node)
+{
+    return Value::fromData(MPV_FORMAT_NODE, &node).toString();
+}
+
+struct Observer
+{
+    uint64_t userdata = 0;
+    std::string name = {};
+    mpv_format format = MPV_FORMAT_NONE;
+    int64_t counter = 0;
+};
+
+struct Event
+{
+    mpv_event_id id = MPV_EVENT_NONE;
+    int error = 0;
+    uint64_t userdata = 0;
+    // MPV_EVENT_PROPERTY_CHANGE
+    std::string name = {};
+    mpv_format format = MPV_FORMAT_NONE;
+    Value value = {};
+    // MPV_EVENT_LOG_MESSAGE
+    std::string prefix = {};
+    std::string text = {};
+    int level = MPV_LOG_LEVEL_NONE;
+    // MPV_EVENT_CLIENT_MESSAGE
+    std::vector<std::string> arguments = {};
+    // MPV_EVENT_END_FILE
+    int reason = 0;
+};
+
+} // namespace
+
+struct mpv_render_context
+{
+    mpv_handle *mpv = nullptr;
+    mpv_render_update_fn callback = nullptr;
+    void *callbackContext = nullptr;
+};
+
+struct mpv_handle
+{
+    std::mutex mutex;
+    std::condition_variable eventAdded;
+    std::condition_variable settingsChanged;
+    std::deque<Event> events = {};
+    bool overflowed = false;
+    void (*wakeup)(void *) = nullptr;
+    void *wakeupContext = nullptr;
+    std::map<std::string, Value> properties = {};
+    std::vector<Observer> observers = {};
+    int logLevel = MPV_LOG_LEVEL_NONE;
+    mpv_render_context *renderContext = nullptr;
+    std::thread generator;
+    bool quit = false;
+
+    // The script.
+    double propertyRate = 0.0;
+    double logRate = 0.0;
+    double fps = 0.0;
+    size_t queueSize = 1000;
+    int scriptLogLevel = MPV_LOG_LEVEL_INFO;
+    std::vector<std::string> flood = {};
+    size_t nextObserver = 0;
+    int64_t logCounter = 0;
+
+    // Owned by the last event returned by mpv_wait_event().
+    Event current = {};
+    mpv_event event = {};
+    mpv_event_property property = {};
+    mpv_event_log_message logMessage = {};
+    mpv_event_client_message clientMessage = {};
+    mpv_event_end_file endFile = {};
+    mpv_event_command commandReply = {};
+    std::vector<const char *> argumentPointers = {};
+    int flag = 0;
+    int64_t integer = 0;
+    double number = 0.0;
+    const char *string = nullptr;
+    mpv_node node = {};
+};
+
+namespace {
+
+// Called with the mutex of the handle locked, the wakeup callback is called
+// right away like libmpv does.
+void push(mpv_handle *mpv, Event &&event)
+{
+    if (mpv->events.size() >= mpv->queueSize) {
+        if (!mpv->overflowed) {
+            mpv->overflowed = true;
+            Event overflow = {};
+            overflow.id = MPV_EVENT_QUEUE_OVERFLOW;
+            mpv->events.push_back(std::move(overflow));
+        } else {
+            return;
+        }
+    } else {
+        mpv->events.push_back(std::move(event));
+    }
+    mpv->eventAdded.notify_one();
+    if (mpv->wakeup) {
+        mpv->wakeup(mpv->wakeupContext);
+    }
+}
+
+void pushEvent(mpv_handle *mpv, const mpv_event_id id, const uint64_t userdata = 0)
+{
+    Event event = {};
+    event.id = id;
+    event.userdata = userdata;
+    push(mpv, std::move(event));
+}
+
+void pushPropertyChange(mpv_handle *mpv, const Observer &observer, const Value &value)
+{
+    Event event = {};
+    event.id = MPV_EVENT_PROPERTY_CHANGE;
+    event.userdata = observer.userdata;
+    event.name = observer.name;
+    event.format = value.valid() ? observer.format : MPV_FORMAT_NONE;
+    event.value = value;
+    push(mpv, std::move(event));
+}
+
+// Called with the mutex of the handle locked.
+void setValue(mpv_handle *mpv, const std::string &name, const Value &value)
+{
+    mpv->properties[name] = value;
+    for (auto &&observer : mpv->observers) {
+        if (observer.name == name) {
+            pushPropertyChange(mpv, observer, value);
+        }
+    }
+}
+
+Value valueOf(const mpv_handle *mpv, const std::string &name)
+{
+    const auto iterator = mpv->properties.find(name);
+    return (iterator != mpv->properties.cend()) ? iterator->second : Value{};
+}
+
+// Returns true if it was one of the "fakempv-*" settings. Called with the
+// mutex of the handle locked.
+bool applySetting(mpv_handle *mpv, const std::string &name, const Value &value)
+{
+    if (name == "fakempv-property-rate") {
+        mpv->propertyRate = value.toNumber();
+    } else if (name == "fakempv-log-rate") {
+        mpv->logRate = value.toNumber();
+    } else if (name == "fakempv-fps") {
+        mpv->fps = value.toNumber();
+    } else if (name == "fakempv-queue-size") {
+        mpv->queueSize = static_cast<size_t>(std::max<int64_t>(value.toInteger(), 1));
+    } else if (name == "fakempv-log-level") {
+        mpv->scriptLogLevel = logLevel(value.toString());
+    } else if (name == "fakempv-flood") {
+        mpv->flood = split(value.toString());
+        mpv->nextObserver = 0;
+    } else {
+        return false;
+    }
+    mpv->properties[name] = value;
+    mpv->settingsChanged.notify_one();
+    return true;
+}
+
+// The next property of the flood, in the observed format. Called with the
+// mutex of the handle locked.
+void floodProperty(mpv_handle *mpv)
+{
+    if (mpv->observers.empty()) {
+        return;
+    }
+    for (size_t i = 0; i != mpv->observers.size(); ++i) {
+        Observer &observer = mpv->observers.at(mpv->nextObserver++ % mpv->observers.size());
+        if (!mpv->flood.empty()
+            && (std::find(mpv->flood.cbegin(), mpv->flood.cend(), observer.name)
+                == mpv->flood.cend())) {
+            continue;
+        }
+        const int64_t counter = ++observer.counter;
+        Value value = {};
+        switch (observer.format) {
+        case MPV_FORMAT_FLAG:
+            value = Value::fromFlag(counter % 2);
+            break;
+        case MPV_FORMAT_INT64:
+            value = Value::fromInteger(counter);
+            break;
+        case MPV_FORMAT_STRING:
+        case MPV_FORMAT_OSD_STRING:
+            value = Value::fromString("fakempv " + std::to_string(counter));
+            break;
+        case MPV_FORMAT_NONE:
+            break;
+        default:
+            // As if it was a timestamp at 25 fps.
+            value = Value::fromNumber(counter * 0.04);
+            break;
+        }
+        mpv->properties[observer.name] = value;
+        pushPropertyChange(mpv, observer, value);
+        return;
+    }
+}
+
+void logMessage(mpv_handle *mpv)
+{
+    if ((mpv->scriptLogLevel == MPV_LOG_LEVEL_NONE) || (mpv->logLevel < mpv->scriptLogLevel)) {
+        return;
+    }
+    Event event = {};
+    event.id = MPV_EVENT_LOG_MESSAGE;
+    event.prefix = "fakempv";
+    event.level = mpv->scriptLogLevel;
+    event.text = "Scripted log message " + std::to_string(++mpv->logCounter) + "\n";
+    push(mpv, std::move(event));
+}
+
+// Runs the script of one handle until it's destroyed.
+void generate(mpv_handle *mpv)
+{
+    using Clock = std::chrono::steady_clock;
+    const auto tick = std::chrono::milliseconds(1);
+    double properties = 0.0;
+    double logs = 0.0;
+    double frames = 0.0;
+    auto last = Clock::now();
+    std::unique_lock<std::mutex> locker(mpv->mutex);
+    while (!mpv->quit) {
+        if ((mpv->propertyRate <= 0.0) && (mpv->logRate <= 0.0) && (mpv->fps <= 0.0)) {
+            // Nothing scripted, sleep until that changes.
+            mpv->settingsChanged.wait(locker);
+            last = Clock::now();
+            continue;
+        }
+        mpv->settingsChanged.wait_for(locker, tick);
+        const auto now = Clock::now();
+        const double elapsed = std::chrono::duration<double>(now - last).count();
+        last = now;
+        properties += mpv->propertyRate * elapsed;
+        logs += mpv->logRate * elapsed;
+        frames += mpv->fps * elapsed;
+        for (; properties >= 1.0; properties -= 1.0) {
+            floodProperty(mpv);
+        }
+        for (; logs >= 1.0; logs -= 1.0) {
+            logMessage(mpv);
+        }
+        for (; frames >= 1.0; frames -= 1.0) {
+            if (mpv->renderContext && mpv->renderContext->callback) {
+                mpv->renderContext->callback(mpv->renderContext->callbackContext);
+            }
+        }
+    }
+}
+
+// Called with the mutex of the handle locked.
+int runCommand(mpv_handle *mpv, const std::vector<std::string> &arguments)
+{
+    if (arguments.empty()) {
+        return MPV_ERROR_INVALID_PARAMETER;
+    }
+    const std::string &name = arguments.front();
+    if (name == "loadfile") {
+        if (arguments.size() < 2) {
+            return MPV_ERROR_INVALID_PARAMETER;
+        }
+        pushEvent(mpv, MPV_EVENT_START_FILE);
+        setValue(mpv, "path", Value::fromString(arguments.at(1)));
+        setValue(mpv, "idle-active", Value::fromFlag(false));
+        setValue(mpv, "duration", Value::fromNumber(3600.0));
+        setValue(mpv, "time-pos", Value::fromNumber(0.0));
+        pushEvent(mpv, MPV_EVENT_FILE_LOADED);
+        pushEvent(mpv, MPV_EVENT_PLAYBACK_RESTART);
+    } else if (name == "stop") {
+        Event event = {};
+        event.id = MPV_EVENT_END_FILE;
+        event.reason = MPV_END_FILE_REASON_STOP;
+        push(mpv, std::move(event));
+        setValue(mpv, "idle-active", Value::fromFlag(true));
+    } else if (name == "seek") {
+        if (arguments.size() < 2) {
+            return MPV_ERROR_INVALID_PARAMETER;
+        }
+        const double target = std::strtod(arguments.at(1).c_str(), nullptr);
+        const bool absolute = (arguments.size() > 2)
+                              && (arguments.at(2).find("absolute") != std::string::npos);
+        const double position = absolute ? target
+                                         : (valueOf(mpv, "time-pos").toNumber() + target);
+        pushEvent(mpv, MPV_EVENT_SEEK);
+        setValue(mpv, "time-pos", Value::fromNumber(std::max(position, 0.0)));
+        pushEvent(mpv, MPV_EVENT_PLAYBACK_RESTART);
+    } else if ((name == "script-message") || (name == "script-message-to")) {
+        Event event = {};
+        event.id = MPV_EVENT_CLIENT_MESSAGE;
+        event.arguments.assign(arguments.cbegin() + ((name == "script-message") ? 1 : 2),
+                               arguments.cend());
+        push(mpv, std::move(event));
+    } else if (name == "quit") {
+        pushEvent(mpv, MPV_EVENT_SHUTDOWN);
+    } else if (name == "fakempv-reset-calls") {
+        for (auto &&calls : m_calls) {
+            calls.store(0, std::memory_order_relaxed);
+        }
+    }
+    return 0;
+}
+
+std::vector<std::string> commandArguments(const mpv_node *node)
+{
+    std::vector<std::string> arguments = {};
+    if (!node || (node->format != MPV_FORMAT_NODE_ARRAY) || !node->u.list) {
+        return arguments;
+    }
+    for (int i = 0; i != node->u.list->num; ++i) {
+        arguments.push_back(nodeToString(node->u.list->values[i]));
+    }
+    return arguments;
+}
+
+// "fakempv-calls" as a map, or false if it's not one of the counters.
+bool getCalls(const std::string &name, mpv_node *node)
+{
+    if (name == "fakempv-calls") {
+        auto list = static_cast<mpv_node_list *>(std::calloc(1, sizeof(mpv_node_list)));
+        list->num = ApiCount;
+        list->values = static_cast<mpv_node *>(std::calloc(ApiCount, sizeof(mpv_node)));
+        list->keys = static_cast<char **>(std::calloc(ApiCount, sizeof(char *)));
+        for (int i = 0; i != ApiCount; ++i) {
+            list->keys[i] = duplicate(m_apiNames[i]);
+            list->values[i].format = MPV_FORMAT_INT64;
+            list->values[i].u.int64 = m_calls[i].load(std::memory_order_relaxed);
+        }
+        node->format = MPV_FORMAT_NODE_MAP;
+        node->u.list = list;
+        return true;
+    }
+    const std::string prefix = "fakempv-calls/";
+    if (name.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    for (int i = 0; i != ApiCount; ++i) {
+        if (name.compare(prefix.size(), std::string::npos, m_apiNames[i]) == 0) {
+            toNode(Value::fromInteger(m_calls[i].load(std::memory_order_relaxed)), node);
+            return true;
+        }
+    }
+    return false;
+}
+
+void freeNode(mpv_node *node)
+{
+    switch (node->format) {
+    case MPV_FORMAT_STRING:
+        std::free(node->u.string);
+        break;
+    case MPV_FORMAT_NODE_ARRAY:
+    case MPV_FORMAT_NODE_MAP:
+        if (mpv_node_list *list = node->u.list) {
+            for (int i = 0; i != list->num; ++i) {
+                freeNode(&list->values[i]);
+                if (list->keys) {
+                    std::free(list->keys[i]);
+                }
+            }
+            std::free(list->values);
+            std::free(list->keys);
+            std::free(list);
+        }
+        break;
+    default:
+        break;
+    }
+    node->format = MPV_FORMAT_NONE;
+}
+
+// Fills the mpv_event of the handle from the current event, the data lives
+// in the handle until the next mpv_wait_event() call.
+void prepareEvent(mpv_handle *mpv)
+{
+    Event &current = mpv->current;
+    mpv_event &event = mpv->event;
+    event.event_id = current.id;
+    event.error = current.error;
+    event.reply_userdata = current.userdata;
+    event.data = nullptr;
+    switch (current.id) {
+    case MPV_EVENT_PROPERTY_CHANGE:
+        mpv->property.name = current.name.c_str();
+        mpv->property.format = current.format;
+        mpv->property.data = nullptr;
+        switch (current.format) {
+        case MPV_FORMAT_FLAG:
+            mpv->flag = static_cast<int>(current.value.toInteger() != 0);
+            mpv->property.data = &mpv->flag;
+            break;
+        case MPV_FORMAT_INT64:
+            mpv->integer = current.value.toInteger();
+            mpv->property.data = &mpv->integer;
+            break;
+        case MPV_FORMAT_DOUBLE:
+            mpv->number = current.value.toNumber();
+            mpv->property.data = &mpv->number;
+            break;
+        case MPV_FORMAT_STRING:
+        case MPV_FORMAT_OSD_STRING:
+            current.value = Value::fromString(current.value.toString());
+            mpv->string = current.value.string.c_str();
+            mpv->property.data = &mpv->string;
+            break;
+        case MPV_FORMAT_NODE:
+            // Not allocated, the client doesn't free event data.
+            mpv->node.format = current.value.format;
+            mpv->node.u.int64 = current.value.integer;
+            if (current.value.format == MPV_FORMAT_FLAG) {
+                mpv->node.u.flag = static_cast<int>(current.value.integer);
+            } else if (current.value.format == MPV_FORMAT_DOUBLE) {
+                mpv->node.u.double_ = current.value.number;
+            } else if (current.value.format == MPV_FORMAT_STRING) {
+                mpv->node.u.string = const_cast<char *>(current.value.string.c_str());
+            }
+            mpv->property.data = &mpv->node;
+            break;
+        default:
+            mpv->property.format = MPV_FORMAT_NONE;
+            break;
+        }
+        event.data = &mpv->property;
+        break;
+    case MPV_EVENT_LOG_MESSAGE:
+        mpv->logMessage.prefix = current.prefix.c_str();
+        mpv->logMessage.level = m_logLevels[(current.level / 10) - 1];
+        mpv->logMessage.text = current.text.c_str();
+        mpv->logMessage.log_level = static_cast<mpv_log_level>(current.level);
+        event.data = &mpv->logMessage;
+        break;
+    case MPV_EVENT_CLIENT_MESSAGE:
+        mpv->argumentPointers.clear();
+        for (auto &&argument : current.arguments) {
+            mpv->argumentPointers.push_back(argument.c_str());
+        }
+        mpv->clientMessage.num_args = static_cast<int>(mpv->argumentPointers.size());
+        mpv->clientMessage.args = mpv->argumentPointers.data();
+        event.data = &mpv->clientMessage;
+        break;
+    case MPV_EVENT_END_FILE:
+        mpv->endFile = {};
+        mpv->endFile.reason = static_cast<mpv_end_file_reason>(current.reason);
+        event.data = &mpv->endFile;
+        break;
+    case MPV_EVENT_COMMAND_REPLY:
+        mpv->commandReply = {};
+        mpv->commandReply.result.format = MPV_FORMAT_NONE;
+        event.data = &mpv->commandReply;
+        break;
+    default:
+        break;
+    }
+}
+
+} // namespace
+
+FAKEMPV_EXPORT mpv_handle *mpv_create()
+{
+    count(Create);
+    auto mpv = new mpv_handle;
+    mpv->propertyRate = std::strtod(environment("FAKEMPV_PROPERTY_RATE", "0").c_str(), nullptr);
+    mpv->logRate = std::strtod(environment("FAKEMPV_LOG_RATE", "0").c_str(), nullptr);
+    mpv->fps = std::strtod(environment("FAKEMPV_FPS", "0").c_str(), nullptr);
+    mpv->queueSize = std::max<size_t>(
+        std::strtoul(environment("FAKEMPV_QUEUE_SIZE", "1000").c_str(), nullptr, 10), 1);
+    mpv->scriptLogLevel = logLevel(environment("FAKEMPV_LOG_LEVEL", "info"));
+    mpv->flood = split(environment("FAKEMPV_FLOOD", ""));
+    mpv->properties["idle-active"] = Value::fromFlag(true);
+    mpv->properties["pause"] = Value::fromFlag(false);
+    mpv->properties["volume"] = Value::fromNumber(100.0);
+    mpv->properties["mpv-version"] = Value::fromString("fakempv");
+    return mpv;
+}
+
+FAKEMPV_EXPORT int mpv_initialize(mpv_handle *mpv)
+{
+    count(Initialize);
+    std::lock_guard<std::mutex> locker(mpv->mutex);
+    if (mpv->generator.joinable()) {
+        return MPV_ERROR_INVALID_PARAMETER;
+    }
+    mpv->generator = std::thread(generate, mpv);
+    return 0;
+}
+
+FAKEMPV_EXPORT void mpv_terminate_destroy(mpv_handle *mpv)
+{
+    count(TerminateDestroy);
+    if (!mpv) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> locker(mpv->mutex);
+        mpv->quit = true;
+        mpv->settingsChanged.notify_one();
+        mpv->eventAdded.notify_all();
+    }
+    if (mpv->generator.joinable()) {
+        mpv->generator.join();
+    }
+    delete mpv;
+}
+
+FAKEMPV_EXPORT int mpv_get_property(mpv_handle *mpv,
+                                    const char *name,
+                                    mpv_format format,
+                                    void *data)
+{
+    count(GetProperty);
+    if (!name || !data) {
+        return MPV_ERROR_INVALID_PARAMETER;
+    }
+    if ((format == MPV_FORMAT_NODE) && getCalls(name, static_cast<mpv_node *>(data))) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> locker(mpv->mutex);
+    const Value value = valueOf(mpv, name);
+    if (!value.valid()) {
+        return MPV_ERROR_PROPERTY_UNAVAILABLE;
+    }
+    switch (format) {
+    case MPV_FORMAT_NODE:
+        toNode(value, static_cast<mpv_node *>(data));
+        return 0;
+    case MPV_FORMAT_FLAG:
+        *static_cast<int *>(data) = static_cast<int>(value.toInteger() != 0);
+        return 0;
+    case MPV_FORMAT_INT64:
+        *static_cast<int64_t *>(data) = value.toInteger();
+        return 0;
+    case MPV_FORMAT_DOUBLE:
+        *static_cast<double *>(data) = value.toNumber();
+        return 0;
+    case MPV_FORMAT_STRING:
+    case MPV_FORMAT_OSD_STRING:
+        *static_cast<char **>(data) = duplicate(value.toString());
+        return 0;
+    default:
+        return MPV_ERROR_PROPERTY_FORMAT;
+    }
+}
+
+FAKEMPV_EXPORT int mpv_set_property(mpv_handle *mpv,
+                                    const char *name,
+                                    mpv_format format,
+                                    void *data)
+{
+    count(SetProperty);
+    if (!name || !data) {
+        return MPV_ERROR_INVALID_PARAMETER;
+    }
+    const Value value = Value::fromData(format, data);
+    std::lock_guard<std::mutex> locker(mpv->mutex);
+    if (!applySetting(mpv, name, value)) {
+        setValue(mpv, name, value);
+    }
+    return 0;
+}
+
+FAKEMPV_EXPORT int mpv_set_property_async(
+    mpv_handle *mpv, uint64_t reply_userdata, const char *name, mpv_format format, void *data)
+{
+    count(SetPropertyAsync);
+    if (!name || !data) {
+        return MPV_ERROR_INVALID_PARAMETER;
+    }
+    const Value value = Value::fromData(format, data);
+    std::lock_guard<std::mutex> locker(mpv->mutex);
+    if (!applySetting(mpv, name, value)) {
+        setValue(mpv, name, value);
+    }
+    pushEvent(mpv, MPV_EVENT_SET_PROPERTY_REPLY, reply_userdata);
+    return 0;
+}
+
+FAKEMPV_EXPORT int mpv_command_node(mpv_handle *mpv, mpv_node *args, mpv_node *result)
+{
+    count(CommandNode);
+    if (result) {
+        result->format = MPV_FORMAT_NONE;
+    }
+    const std::vector<std::string> arguments = commandArguments(args);
+    std::lock_guard<std::mutex> locker(mpv->mutex);
+    return runCommand(mpv, arguments);
+}
+
+FAKEMPV_EXPORT int mpv_command_node_async(mpv_handle *mpv, uint64_t reply_userdata, mpv_node *args)
+{
+    count(CommandNodeAsync);
+    const std::vector<std::string> arguments = commandArguments(args);
+    std::lock_guard<std::mutex> locker(mpv->mutex);
+    Event reply = {};
+    reply.id = MPV_EVENT_COMMAND_REPLY;
+    reply.userdata = reply_userdata;
+    reply.error = runCommand(mpv, arguments);
+    push(mpv, std::move(reply));
+    return 0;
+}
+
+FAKEMPV_EXPORT int mpv_load_config_file(mpv_handle *mpv, const char *filename)
+{
+    count(LoadConfigFile);
+    (void) mpv;
+    (void) filename;
+    return 0;
+}
+
+FAKEMPV_EXPORT const char *mpv_error_string(int error)
+{
+    count(ErrorString);
+    static const char *const errors[] = {"success",
+                                         "event queue full",
+                                         "memory allocation failed",
+                                         "core not uninitialized",
+                                         "invalid parameter",
+                                         "option not found",
+                                         "unsupported format for accessing option",
+                                         "error setting option",
+                                         "property not found",
+                                         "unsupported format for accessing property",
+                                         "property unavailable",
+                                         "error accessing property",
+                                         "error running command",
+                                         "error loading",
+                                         "error initializing audio output",
+                                         "error initializing video output",
+                                         "no audio or video data played",
+                                         "unrecognized file format",
+                                         "not supported",
+                                         "operation not implemented",
+                                         "something happened"};
+    const int index = -error;
+    return ((index >= 0) && (index < static_cast<int>(sizeof(errors) / sizeof(errors[0]))))
+               ? errors[index]
+               : "unknown error";
+}
+
+FAKEMPV_EXPORT int mpv_observe_property(mpv_handle *mpv,
+                                        uint64_t reply_userdata,
+                                        const char *name,
+                                        mpv_format format)
+{
+    count(ObserveProperty);
+    if (!name) {
+        return MPV_ERROR_INVALID_PARAMETER;
+    }
+    std::lock_guard<std::mutex> locker(mpv->mutex);
+    Observer observer = {};
+    observer.userdata = reply_userdata;
+    observer.name = name;
+    observer.format = format;
+    mpv->observers.push_back(observer);
+    // libmpv always reports the current value first.
+    pushPropertyChange(mpv, observer, valueOf(mpv, name));
+    return 0;
+}
+
+FAKEMPV_EXPORT int mpv_request_log_messages(mpv_handle *mpv, const char *min_level)
+{
+    count(RequestLogMessages);
+    std::lock_guard<std::mutex> locker(mpv->mutex);
+    mpv->logLevel = logLevel(min_level ? min_level : "no");
+    return 0;
+}
+
+FAKEMPV_EXPORT void mpv_set_wakeup_callback(mpv_handle *mpv, void (*cb)(void *), void *d)
+{
+    count(SetWakeupCallback);
+    std::lock_guard<std::mutex> locker(mpv->mutex);
+    mpv->wakeup = cb;
+    mpv->wakeupContext = d;
+}
+
+FAKEMPV_EXPORT mpv_event *mpv_wait_event(mpv_handle *mpv, double timeout)
+{
+    count(WaitEvent);
+    std::unique_lock<std::mutex> locker(mpv->mutex);
+    if (mpv->events.empty() && (timeout != 0.0)) {
+        const auto ready = [mpv]() { return !mpv->events.empty() || mpv->quit; };
+        if (timeout < 0.0) {
+            mpv->eventAdded.wait(locker, ready);
+        } else {
+            mpv->eventAdded.wait_for(locker, std::chrono::duration<double>(timeout), ready);
+        }
+    }
+    if (mpv->events.empty()) {
+        mpv->current = {};
+    } else {
+        mpv->current = std::move(mpv->events.front());
+        mpv->events.pop_front();
+        if (mpv->current.id == MPV_EVENT_QUEUE_OVERFLOW) {
+            mpv->overflowed = false;
+        }
+    }
+    prepareEvent(mpv);
+    return &mpv->event;
+}
+
+FAKEMPV_EXPORT const char *mpv_event_name(mpv_event_id event)
+{
+    count(EventName);
+    switch (event) {
+    case MPV_EVENT_NONE:
+        return "none";
+    case MPV_EVENT_SHUTDOWN:
+        return "shutdown";
+    case MPV_EVENT_LOG_MESSAGE:
+        return "log-message";
+    case MPV_EVENT_GET_PROPERTY_REPLY:
+        return "get-property-reply";
+    case MPV_EVENT_SET_PROPERTY_REPLY:
+        return "set-property-reply";
+    case MPV_EVENT_COMMAND_REPLY:
+        return "command-reply";
+    case MPV_EVENT_START_FILE:
+        return "start-file";
+    case MPV_EVENT_END_FILE:
+        return "end-file";
+    case MPV_EVENT_FILE_LOADED:
+        return "file-loaded";
+    case MPV_EVENT_CLIENT_MESSAGE:
+        return "client-message";
+    case MPV_EVENT_VIDEO_RECONFIG:
+        return "video-reconfig";
+    case MPV_EVENT_AUDIO_RECONFIG:
+        return "audio-reconfig";
+    case MPV_EVENT_SEEK:
+        return "seek";
+    case MPV_EVENT_PLAYBACK_RESTART:
+        return "playback-restart";
+    case MPV_EVENT_PROPERTY_CHANGE:
+        return "property-change";
+    case MPV_EVENT_QUEUE_OVERFLOW:
+        return "event-queue-overflow";
+    case MPV_EVENT_HOOK:
+        return "hook";
+    default:
+        return nullptr;
+    }
+}
+
+FAKEMPV_EXPORT void mpv_free_node_contents(mpv_node *node)
+{
+    count(FreeNodeContents);
+    if (node) {
+        freeNode(node);
+    }
+}
+
+FAKEMPV_EXPORT void mpv_free(void *data)
+{
+    count(Free);
+    std::free(data);
+}
+
+FAKEMPV_EXPORT int mpv_stream_cb_add_ro(mpv_handle *mpv,
+                                        const char *protocol,
+                                        void *user_data,
+                                        mpv_stream_cb_open_ro_fn open_fn)
+{
+    count(StreamCbAddRo);
+    (void) mpv;
+    (void) protocol;
+    (void) user_data;
+    (void) open_fn;
+    return 0;
+}
+
+FAKEMPV_EXPORT int mpv_render_context_create(mpv_render_context **res,
+                                             mpv_handle *mpv,
+                                             mpv_render_param *params)
+{
+    count(RenderContextCreate);
+    (void) params;
+    std::lock_guard<std::mutex> locker(mpv->mutex);
+    if (!res || mpv->renderContext) {
+        return MPV_ERROR_INVALID_PARAMETER;
+    }
+    mpv->renderContext = new mpv_render_context;
+    mpv->renderContext->mpv = mpv;
+    *res = mpv->renderContext;
+    return 0;
+}
+
+FAKEMPV_EXPORT void mpv_render_context_set_update_callback(mpv_render_context *ctx,
+                                                           mpv_render_update_fn callback,
+                                                           void *callback_ctx)
+{
+    count(RenderContextSetUpdateCallback);
+    std::lock_guard<std::mutex> locker(ctx->mpv->mutex);
+    ctx->callback = callback;
+    ctx->callbackContext = callback_ctx;
+}
+
+FAKEMPV_EXPORT int mpv_render_context_render(mpv_render_context *ctx, mpv_render_param *params)
+{
+    count(RenderContextRender);
+    (void) ctx;
+    (void) params;
+    // Nothing is drawn, only the cost of the call is measured.
+    return 0;
+}
+
+FAKEMPV_EXPORT void mpv_render_context_free(mpv_render_context *ctx)
+{
+    count(RenderContextFree);
+    if (!ctx) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> locker(ctx->mpv->mutex);
+        ctx->mpv->renderContext = nullptr;
+    }
+    delete ctx;
+}
@@ -0,0 +1,18 @@
+# A stand-in for libmpv, see fakempv.cpp. Build it separately and point
+# "WWX190_LIBMPV_PATH" at it, the wrapper has to be built with
+# "CONFIG += dynamic_libmpv" to load it.
+TEMPLATE = lib
+TARGET = fakempv
+CONFIG -= qt
+CONFIG += c++17 strict_c++ warn_on shared hide_symbols thread
+win32: !mingw {
+    isEmpty(MPV_SDK_DIR) {
+        error(You have to setup \"MPV_SDK_DIR\" in \".qmake.conf\" first!)
+    } else {
+        INCLUDEPATH += $$MPV_SDK_DIR/include
+    }
+} else {
+    # Only the headers are needed, libmpv itself is not linked.
+    INCLUDEPATH += $$system(pkg-config --variable=includedir mpv)
+}
+SOURCES += fakempv.cpp
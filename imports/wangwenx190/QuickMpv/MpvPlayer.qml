@@ -995,6 +995,178 @@ Item {
     */
     property alias metadata: mpvObject.metadata
 
+    /*!
+        \qmlproperty MpvTrackModel MpvPlayer::videoTrackModel
+
+        Video tracks, as a model that is updated in place.
+    */
+    property alias videoTrackModel: mpvObject.videoTrackModel
+
+    /*!
+        \qmlproperty MpvTrackModel MpvPlayer::audioTrackModel
+
+        Audio tracks, as a model that is updated in place.
+    */
+    property alias audioTrackModel: mpvObject.audioTrackModel
+
+    /*!
+        \qmlproperty MpvTrackModel MpvPlayer::subtitleTrackModel
+
+        Subtitle tracks, as a model that is updated in place.
+    */
+    property alias subtitleTrackModel: mpvObject.subtitleTrackModel
+
+    /*!
+        \qmlproperty MpvChapterModel MpvPlayer::chapterModel
+
+        Chapters, as a model that is updated in place. Its currentIndex property
+        follows the playback position.
+    */
+    property alias chapterModel: mpvObject.chapterModel
+
+    /*!
+        \qmlproperty MpvMetadataModel MpvPlayer::metadataModel
+
+        Metadata, as a model of key/value pairs that is updated in place.
+    */
+    property alias metadataModel: mpvObject.metadataModel
+
+    /*!
+        \qmlproperty enumeration MpvPlayer::priority
+
+        The priority MpvResourceScheduler gives this player. Automatic, the
+        default, lets the scheduler work it out from the item.
+    */
+    property alias priority: mpvObject.priority
+
+    /*!
+        \qmlproperty real MpvPlayer::renderScale
+
+        The resolution the video is rendered at, relative to the size of the
+        item. Managed by MpvResourceScheduler when it's enabled.
+    */
+    property alias renderScale: mpvObject.renderScale
+
+    /*!
+        \qmlproperty int MpvPlayer::demuxerMaxBytes
+
+        How much the demuxer is allowed to buffer ahead, in bytes.
+    */
+    property alias demuxerMaxBytes: mpvObject.demuxerMaxBytes
+
+    /*!
+        \qmlproperty int MpvPlayer::demuxerMaxBackBytes
+
+        How much already played data the demuxer keeps for seeking back, in
+        bytes.
+    */
+    property alias demuxerMaxBackBytes: mpvObject.demuxerMaxBackBytes
+
+    /*!
+        \qmlproperty int MpvPlayer::cacheBytes
+
+        The memory the demuxer cache actually uses right now, in bytes.
+    */
+    property alias cacheBytes: mpvObject.cacheBytes
+
+    /*!
+        \qmlproperty MpvCacheTelemetry MpvPlayer::cacheTelemetry
+
+        The state of the demuxer cache: cached duration and bytes, buffered
+        ranges, input rate and underruns.
+    */
+    property alias cacheTelemetry: mpvObject.cacheTelemetry
+
+    /*!
+        \qmlproperty MpvLatencyTracker MpvPlayer::latency
+
+        How long opening files and seeking take, as rolling p50, p95 and p99
+        statistics in milliseconds.
+    */
+    property alias latency: mpvObject.latency
+
+    /*!
+        \qmlproperty MpvLogSink MpvPlayer::logSink
+
+        The recent log messages of libmpv, filtered and rate limited. Fatal
+        messages are reported through its fatalError() signal.
+    */
+    property alias logSink: mpvObject.logSink
+
+    /*!
+        \qmlproperty int MpvPlayer::queueOverflows
+
+        How many times the event queue of libmpv overflowed. The observed
+        properties are read again each time, so no stale value is left behind.
+    */
+    property alias queueOverflows: mpvObject.queueOverflows
+
+    /*!
+        \qmlproperty bool MpvPlayer::lowLatency
+
+        Plays live streams as close to the live edge as possible. Playback is
+        sped up while liveLatency is above targetLatency, and everything that's
+        buffered is dropped once it's above maxLatency.
+    */
+    property alias lowLatency: mpvObject.lowLatency
+
+    /*!
+        \qmlproperty real MpvPlayer::targetLatency
+
+        In seconds, 0.3 by default.
+    */
+    property alias targetLatency: mpvObject.targetLatency
+
+    /*!
+        \qmlproperty real MpvPlayer::maxLatency
+
+        In seconds, 2.0 by default.
+    */
+    property alias maxLatency: mpvObject.maxLatency
+
+    /*!
+        \qmlproperty real MpvPlayer::liveLatency
+
+        How far playback is behind the newest packet that has been received, in
+        seconds. Only measured in low latency mode.
+    */
+    property alias liveLatency: mpvObject.liveLatency
+
+    /*!
+        \qmlproperty int MpvPlayer::frameNumber
+
+        The number of the frame being displayed, counted from 0. Exact for
+        constant frame rate video.
+    */
+    property alias frameNumber: mpvObject.frameNumber
+
+    /*!
+        \qmlproperty int MpvPlayer::stepCacheBytes
+
+        How much memory frameBackStep() may use to keep decoded frames, in
+        bytes. 0 (the default) decodes from the previous keyframe for every
+        backward step.
+    */
+    property alias stepCacheBytes: mpvObject.stepCacheBytes
+
+    /*!
+        \qmlproperty MpvKeyframeIndex MpvPlayer::keyframeIndex
+
+        The keyframes of the current source. With an index, seeks to a
+        keyframe use a fast keyframe seek, and seeks while \l scrubbing snap
+        to the nearest keyframe.
+    */
+    property alias keyframeIndex: mpvObject.keyframeIndex
+
+    /*!
+        \qmlproperty bool MpvPlayer::scrubbing
+
+        Set this while the seek bar is being dragged. Once it's unset, the
+        exact seek to the last position is done if it was snapped to a
+        keyframe.
+    */
+    property alias scrubbing: mpvObject.scrubbing
+
     /*!
         \qmlproperty double MpvPlayer::avsync
 
@@ -1155,6 +1327,29 @@ Item {
         mpvObject.seekPercent(percent);
     }
 
+    /*!
+        \qmlmethod MpvPlayer::frameStep()
+
+        Show the next frame, then pause.
+
+        \sa frameBackStep(), frameNumber
+    */
+    function frameStep() {
+        mpvObject.frameStep();
+    }
+
+    /*!
+        \qmlmethod MpvPlayer::frameBackStep()
+
+        Show the previous frame, then pause. Set \l stepCacheBytes to make
+        repeated backward steps fast.
+
+        \sa frameStep(), frameNumber
+    */
+    function frameBackStep() {
+        mpvObject.frameBackStep();
+    }
+
     /*!
         \qmlmethod MpvPlayer::screenshot()
 
@@ -0,0 +1,609 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvaudioanalyzer.h"
+#include "mpvaudiokernels.h"
+#include "mpvheadlesshandle.h"
+#include "mpvpcmpipe.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QMetaMethod>
+#include <QMutex>
+#include <QThread>
+#include <QtMath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// The companion handle always outputs this format, whatever the source.
+const int m_sampleRate = 48000;
+const int m_channelCount = 2;
+
+// Read this far ahead of the player, in seconds, so that the samples of the
+// current position are always available.
+const qreal m_lookahead = 0.1;
+// Resynchronize the companion handle if it drifts further than this.
+const qreal m_maximumDrift = 1.0;
+// The spectrum starts at this frequency, in Hz.
+const float m_lowestFrequency = 20.0f;
+const float m_dynamicRange = 90.0f;
+
+QVariantMap analyzerOptions(const QString &pcmPath)
+{
+    return QVariantMap{{QString::fromUtf8("ao"), QString::fromUtf8("pcm")},
+                       {QString::fromUtf8("ao-pcm-file"), QDir::toNativeSeparators(pcmPath)},
+                       {QString::fromUtf8("ao-pcm-waveheader"), false},
+                       {QString::fromUtf8("audio-format"), QString::fromUtf8("float")},
+                       {QString::fromUtf8("audio-channels"), QString::fromUtf8("stereo")},
+                       {QString::fromUtf8("audio-samplerate"), m_sampleRate},
+                       {QString::fromUtf8("vid"), QString::fromUtf8("no")},
+                       {QString::fromUtf8("sid"), QString::fromUtf8("no")},
+                       {QString::fromUtf8("hr-seek"), QString::fromUtf8("yes")}};
+}
+
+int roundUpToPowerOfTwo(const int value)
+{
+    int result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Interleaved stereo history of the decoded audio, the newest frame last.
+class FrameRing
+{
+public:
+    explicit FrameRing(const int capacity)
+        : m_data(static_cast<size_t>(capacity) * m_channelCount), m_capacity(capacity)
+    {}
+
+    int size() const { return m_size; }
+    void clear() { m_size = 0; }
+
+    void append(const float *frames, const int count)
+    {
+        const int skip = qMax(count - m_capacity, 0);
+        for (int i = skip; i != count;) {
+            const int chunk = qMin(count - i, m_capacity - m_head);
+            std::memcpy(m_data.data() + m_head * m_channelCount,
+                        frames + i * m_channelCount,
+                        static_cast<size_t>(chunk) * m_channelCount * sizeof(float));
+            m_head = (m_head + chunk) % m_capacity;
+            i += chunk;
+        }
+        m_size = qMin(m_size + count, m_capacity);
+    }
+
+    // Copies "count" frames that end "endOffset" frames before the newest
+    // one. Frames that are not available are zeroed.
+    void copy(const int endOffset, const int count, float *out) const
+    {
+        const int available = qBound(0, m_size - endOffset, count);
+        const int missing = count - available;
+        std::memset(out, 0, static_cast<size_t>(missing) * m_channelCount * sizeof(float));
+        int index = ((m_head - endOffset - available) % m_capacity + m_capacity) % m_capacity;
+        for (int i = missing; i != count;) {
+            const int chunk = qMin(count - i, m_capacity - index);
+            std::memcpy(out + i * m_channelCount,
+                        m_data.data() + index * m_channelCount,
+                        static_cast<size_t>(chunk) * m_channelCount * sizeof(float));
+            index = (index + chunk) % m_capacity;
+            i += chunk;
+        }
+    }
+
+private:
+    std::vector<float> m_data;
+    int m_capacity = 0;
+    int m_head = 0;
+    int m_size = 0;
+};
+
+// Qt 5's QList can't be constructed with a size.
+QList<qreal> zeroLevels(const int count)
+{
+    QList<qreal> levels = {};
+    levels.reserve(count);
+    for (int i = 0; i != count; ++i) {
+        levels.append(0.0);
+    }
+    return levels;
+}
+
+} // namespace
+
+struct MpvAudioAnalyzer::Shared
+{
+    QAtomicInt stopped = 0;
+    // Set while a result is waiting to be picked up by the GUI thread.
+    QAtomicInt dirty = 0;
+    QElapsedTimer clock;
+
+    // Everything below is protected by the mutex.
+    QMutex mutex;
+    QUrl source = QUrl();
+    int aid = 0;
+    qreal position = 0.0;
+    qint64 positionTime = 0;
+    bool playing = false;
+    qreal speed = 1.0;
+    int bandCount = 0;
+    int updateRate = 0;
+    int fftSize = 0;
+    QList<qreal> peakLevels = {};
+    QList<qreal> rmsLevels = {};
+    QList<qreal> spectrum = {};
+};
+
+MpvAudioAnalyzer::MpvAudioAnalyzer(QObject *parent) : QObject(parent)
+{
+    m_threadPool.setMaxThreadCount(1);
+}
+
+MpvAudioAnalyzer::~MpvAudioAnalyzer()
+{
+    if (m_shared) {
+        m_shared->stopped.storeRelease(1);
+    }
+    m_threadPool.waitForDone();
+}
+
+MpvObject *MpvAudioAnalyzer::player() const
+{
+    return currentPlayer;
+}
+
+bool MpvAudioAnalyzer::enabled() const
+{
+    return currentEnabled;
+}
+
+int MpvAudioAnalyzer::bandCount() const
+{
+    return currentBandCount;
+}
+
+int MpvAudioAnalyzer::updateRate() const
+{
+    return currentUpdateRate;
+}
+
+int MpvAudioAnalyzer::fftSize() const
+{
+    return currentFftSize;
+}
+
+bool MpvAudioAnalyzer::running() const
+{
+    return !m_shared.isNull();
+}
+
+QList<qreal> MpvAudioAnalyzer::peakLevels() const
+{
+    return m_peakLevels;
+}
+
+QList<qreal> MpvAudioAnalyzer::rmsLevels() const
+{
+    return m_rmsLevels;
+}
+
+QList<qreal> MpvAudioAnalyzer::spectrum() const
+{
+    return m_spectrum;
+}
+
+void MpvAudioAnalyzer::setPlayer(MpvObject *player)
+{
+    if (player == currentPlayer) {
+        return;
+    }
+    for (auto &&connection : qAsConst(m_playerConnections)) {
+        disconnect(connection);
+    }
+    m_playerConnections.clear();
+    currentPlayer = player;
+    if (currentPlayer) {
+        m_playerConnections
+            << connect(currentPlayer, &MpvObject::positionChanged, this,
+                       &MpvAudioAnalyzer::updatePlayerState)
+            << connect(currentPlayer, &MpvObject::playbackStateChanged, this,
+                       &MpvAudioAnalyzer::updatePlayerState)
+            << connect(currentPlayer, &MpvObject::speedChanged, this,
+                       &MpvAudioAnalyzer::updatePlayerState)
+            << connect(currentPlayer, &MpvObject::aidChanged, this,
+                       &MpvAudioAnalyzer::updatePlayerState)
+            << connect(currentPlayer, &MpvObject::sourceChanged, this,
+                       &MpvAudioAnalyzer::updateRunning)
+            << connect(currentPlayer, &QObject::destroyed, this, &MpvAudioAnalyzer::updateRunning);
+    }
+    Q_EMIT playerChanged();
+    updateRunning();
+}
+
+void MpvAudioAnalyzer::setEnabled(const bool enabled)
+{
+    if (enabled == currentEnabled) {
+        return;
+    }
+    currentEnabled = enabled;
+    Q_EMIT enabledChanged();
+    updateRunning();
+}
+
+void MpvAudioAnalyzer::setBandCount(const int bandCount)
+{
+    const int count = qBound(1, bandCount, 256);
+    if (count == currentBandCount) {
+        return;
+    }
+    currentBandCount = count;
+    Q_EMIT bandCountChanged();
+    updateSettings();
+}
+
+void MpvAudioAnalyzer::setUpdateRate(const int updateRate)
+{
+    const int rate = qBound(1, updateRate, 240);
+    if (rate == currentUpdateRate) {
+        return;
+    }
+    currentUpdateRate = rate;
+    Q_EMIT updateRateChanged();
+    updateSettings();
+}
+
+void MpvAudioAnalyzer::setFftSize(const int fftSize)
+{
+    const int size = roundUpToPowerOfTwo(qBound(256, fftSize, 16384));
+    if (size == currentFftSize) {
+        return;
+    }
+    currentFftSize = size;
+    Q_EMIT fftSizeChanged();
+    updateSettings();
+}
+
+void MpvAudioAnalyzer::connectNotify(const QMetaMethod &signal)
+{
+    // May be called from any thread.
+    if (signal == QMetaMethod::fromSignal(&MpvAudioAnalyzer::levelsChanged)) {
+        QMetaObject::invokeMethod(this, &MpvAudioAnalyzer::updateRunning, Qt::QueuedConnection);
+    }
+}
+
+void MpvAudioAnalyzer::disconnectNotify(const QMetaMethod &signal)
+{
+    // "signal" is invalid when everything is disconnected at once.
+    if (!signal.isValid()
+        || (signal == QMetaMethod::fromSignal(&MpvAudioAnalyzer::levelsChanged))) {
+        QMetaObject::invokeMethod(this, &MpvAudioAnalyzer::updateRunning, Qt::QueuedConnection);
+    }
+}
+
+void MpvAudioAnalyzer::updateRunning()
+{
+    const bool shouldRun = currentEnabled && currentPlayer && currentPlayer->source().isValid()
+                           && isSignalConnected(
+                               QMetaMethod::fromSignal(&MpvAudioAnalyzer::levelsChanged));
+    if (shouldRun && m_shared) {
+        // The source may have changed.
+        updatePlayerState();
+        return;
+    }
+    if (!shouldRun && !m_shared) {
+        return;
+    }
+    if (shouldRun) {
+        const auto shared = QSharedPointer<Shared>::create();
+        shared->clock.start();
+        m_shared = shared;
+        updateSettings();
+        updatePlayerState();
+        m_threadPool.start([this, shared]() { runWorker(shared); });
+    } else {
+        m_shared->stopped.storeRelease(1);
+        m_shared.reset();
+        resetLevels();
+    }
+    Q_EMIT runningChanged();
+}
+
+void MpvAudioAnalyzer::updatePlayerState()
+{
+    if (!m_shared || !currentPlayer) {
+        return;
+    }
+    const bool playing = (currentPlayer->playbackState() == MpvObject::PlaybackState::Playing);
+    QMutexLocker locker(&m_shared->mutex);
+    m_shared->source = currentPlayer->source();
+    m_shared->aid = currentPlayer->aid();
+    m_shared->position = currentPlayer->timePos();
+    m_shared->positionTime = m_shared->clock.elapsed();
+    m_shared->playing = playing;
+    m_shared->speed = currentPlayer->speed();
+}
+
+void MpvAudioAnalyzer::updateSettings()
+{
+    if (!m_shared) {
+        return;
+    }
+    QMutexLocker locker(&m_shared->mutex);
+    m_shared->bandCount = currentBandCount;
+    m_shared->updateRate = currentUpdateRate;
+    m_shared->fftSize = currentFftSize;
+}
+
+void MpvAudioAnalyzer::resetLevels()
+{
+    if (m_peakLevels.isEmpty() && m_rmsLevels.isEmpty() && m_spectrum.isEmpty()) {
+        return;
+    }
+    m_peakLevels.clear();
+    m_rmsLevels.clear();
+    m_spectrum.clear();
+    Q_EMIT levelsChanged();
+}
+
+void MpvAudioAnalyzer::applyLevels(const QSharedPointer<Shared> &shared)
+{
+    if (shared != m_shared) {
+        return;
+    }
+    {
+        QMutexLocker locker(&shared->mutex);
+        m_peakLevels = shared->peakLevels;
+        m_rmsLevels = shared->rmsLevels;
+        m_spectrum = shared->spectrum;
+        // Clear it before unlocking, so that no result gets lost.
+        shared->dirty.storeRelease(0);
+    }
+    Q_EMIT levelsChanged();
+}
+
+void MpvAudioAnalyzer::runWorker(const QSharedPointer<Shared> &shared)
+{
+    // Runs in the thread pool.
+    MpvPcmPipe pipe;
+    if (!pipe.open()) {
+        qCWarning(lcMpvHeadless) << "Failed to create the PCM pipe" << pipe.path();
+        return;
+    }
+    MpvHeadlessHandle mpv(analyzerOptions(pipe.path()), &shared->stopped);
+    if (!mpv.isValid()) {
+        return;
+    }
+
+    QUrl loadedSource = QUrl();
+    int loadedAid = 0;
+    bool restarting = false;
+    bool ended = false;
+    qreal readPosition = 0.0; // Position of the newest frame in the ring.
+    FrameRing ring(16384 + m_sampleRate);
+    std::vector<char> readBuffer(16 * 1024);
+    int pendingBytes = 0;
+    QElapsedTimer updateTimer, resyncTimer;
+    updateTimer.start();
+    resyncTimer.start();
+
+    // Scratch buffers, reallocated when the settings change.
+    int fftSize = 0, bandCount = 0;
+    std::vector<float> frames, left, right, window, re, im, power, cosTable, sinTable;
+    std::vector<int> bandEdges;
+    bool silent = false;
+
+    while (shared->stopped.loadAcquire() == 0) {
+        QUrl source = QUrl();
+        int aid = 0, updateRate = 0;
+        qreal target = 0.0;
+        bool playing = false;
+        {
+            QMutexLocker locker(&shared->mutex);
+            source = shared->source;
+            aid = shared->aid;
+            playing = shared->playing;
+            target = shared->position;
+            if (playing) {
+                target += (shared->clock.elapsed() - shared->positionTime) / 1000.0
+                          * shared->speed;
+            }
+            updateRate = shared->updateRate;
+            if (shared->fftSize != fftSize || shared->bandCount != bandCount) {
+                fftSize = shared->fftSize;
+                bandCount = shared->bandCount;
+                frames.assign(static_cast<size_t>(fftSize) * m_channelCount, 0.0f);
+                left.assign(fftSize, 0.0f);
+                right.assign(fftSize, 0.0f);
+                re.assign(fftSize, 0.0f);
+                im.assign(fftSize, 0.0f);
+                power.assign(fftSize / 2 + 1, 0.0f);
+                window.resize(fftSize);
+                cosTable.resize(fftSize / 2);
+                sinTable.resize(fftSize / 2);
+                for (int i = 0; i != fftSize; ++i) {
+                    // Hann window, halved to average the two channels.
+                    window[i] = 0.25f * (1.0f - std::cos(2.0f * float(M_PI) * i / (fftSize - 1)));
+                }
+                for (int i = 0; i != (fftSize / 2); ++i) {
+                    cosTable[i] = std::cos(2.0f * float(M_PI) * i / fftSize);
+                    sinTable[i] = -std::sin(2.0f * float(M_PI) * i / fftSize);
+                }
+                // Logarithmically spaced band edges, in FFT bins.
+                const float nyquist = m_sampleRate / 2.0f;
+                const float binWidth = static_cast<float>(m_sampleRate) / fftSize;
+                bandEdges.resize(bandCount + 1);
+                for (int i = 0; i <= bandCount; ++i) {
+                    const float frequency = m_lowestFrequency
+                                            * std::pow(nyquist / m_lowestFrequency,
+                                                       static_cast<float>(i) / bandCount);
+                    bandEdges[i] = qBound(1, qRound(frequency / binWidth), fftSize / 2);
+                }
+            }
+        }
+
+        if ((source != loadedSource) || (aid != loadedAid)) {
+            loadedSource = source;
+            loadedAid = aid;
+            mpv.setProperty(QString::fromUtf8("start"), QString::number(qMax(target, 0.0)));
+            mpv.setProperty(QString::fromUtf8("aid"),
+                            (aid > 0) ? QString::number(aid) : QString::fromUtf8("auto"));
+            mpv.command(QVariantList{QString::fromUtf8("loadfile"),
+                                     source.isLocalFile()
+                                         ? QDir::toNativeSeparators(source.toLocalFile())
+                                         : source.url()});
+            restarting = true;
+            ended = false;
+            readPosition = qMax(target, 0.0);
+            ring.clear();
+        } else if (!restarting && (resyncTimer.elapsed() >= 1000)
+                   && ((!ended && (target > (readPosition + m_maximumDrift)))
+                       || (target < (readPosition - static_cast<qreal>(ring.size()) / m_sampleRate
+                                     - m_maximumDrift)))) {
+            // The player has seeked (or we can't keep up with it).
+            mpv.command(QVariantList{QString::fromUtf8("seek"),
+                                     qMax(target, 0.0),
+                                     QString::fromUtf8("absolute+exact")});
+            resyncTimer.restart();
+            restarting = true;
+            ended = false;
+            readPosition = qMax(target, 0.0);
+            ring.clear();
+        }
+
+        while (const mpv_event *event = mpv.pollEvent()) {
+            if (event->event_id == MPV_EVENT_NONE) {
+                break;
+            }
+            if (event->event_id == MPV_EVENT_PLAYBACK_RESTART) {
+                restarting = false;
+                pendingBytes = 0;
+            } else if (event->event_id == MPV_EVENT_END_FILE) {
+                ended = true;
+                restarting = false;
+            } else if (event->event_id == MPV_EVENT_SHUTDOWN) {
+                return;
+            }
+        }
+
+        // While restarting, whatever is still in the pipe belongs to the old
+        // position and is thrown away. Only one buffer at a time though, the
+        // restart event has to be noticed before the new audio arrives.
+        bool starved = true;
+        if (restarting) {
+            starved = (pipe.read(readBuffer.data(), static_cast<qint64>(readBuffer.size()), 5)
+                       <= 0);
+        }
+        // Pull the decoded audio up to a little ahead of the player.
+        while (!restarting && (readPosition < (target + m_lookahead))) {
+            const qint64 bytesRead = pipe.read(readBuffer.data() + pendingBytes,
+                                               static_cast<qint64>(readBuffer.size())
+                                                   - pendingBytes,
+                                               0);
+            if (bytesRead <= 0) {
+                break;
+            }
+            starved = false;
+            const auto available = static_cast<int>(pendingBytes + bytesRead);
+            const int frameSize = m_channelCount * static_cast<int>(sizeof(float));
+            const int frameCount = available / frameSize;
+            ring.append(reinterpret_cast<const float *>(readBuffer.data()), frameCount);
+            readPosition += static_cast<qreal>(frameCount) / m_sampleRate;
+            pendingBytes = available - frameCount * frameSize;
+            if (pendingBytes > 0) {
+                std::memmove(readBuffer.data(),
+                             readBuffer.data() + frameCount * frameSize,
+                             static_cast<size_t>(pendingBytes));
+            }
+        }
+
+        const qint64 updateInterval = 1000 / qMax(updateRate, 1);
+        if (updateTimer.elapsed() < updateInterval) {
+            if (starved) {
+                QThread::msleep(static_cast<unsigned long>(
+                    qBound(qint64(1), updateInterval - updateTimer.elapsed(), qint64(5))));
+            }
+            continue;
+        }
+        updateTimer.restart();
+
+        const bool active = playing && !restarting && (ring.size() > 0);
+        if (!active && silent) {
+            continue;
+        }
+        silent = !active;
+        QList<qreal> peakLevels = zeroLevels(m_channelCount);
+        QList<qreal> rmsLevels = zeroLevels(m_channelCount);
+        QList<qreal> spectrum = zeroLevels(bandCount);
+        if (active) {
+            const int endOffset = qMax(qRound((readPosition - target) * m_sampleRate), 0);
+            ring.copy(endOffset, fftSize, frames.data());
+            mpv::kernels::deinterleave_stereo(frames.data(), fftSize, left.data(), right.data());
+            // The meters only look at what has been played since the last update.
+            const int meterFrames = qBound(1, m_sampleRate / qMax(updateRate, 1), fftSize);
+            const float *channels[m_channelCount] = {left.data(), right.data()};
+            for (int c = 0; c != m_channelCount; ++c) {
+                float min = 0.0f, max = 0.0f;
+                double sumSquares = 0.0;
+                mpv::kernels::accumulate_peaks(channels[c] + fftSize - meterFrames,
+                                               meterFrames,
+                                               min,
+                                               max,
+                                               sumSquares);
+                peakLevels[c] = qMin(qMax(-min, max), 1.0f);
+                rmsLevels[c] = qMin(static_cast<float>(std::sqrt(sumSquares / meterFrames)), 1.0f);
+            }
+            mpv::kernels::mix_and_window(left.data(), right.data(), window.data(), re.data(), fftSize);
+            std::fill(im.begin(), im.end(), 0.0f);
+            mpv::kernels::fft_radix2(re.data(), im.data(), fftSize, cosTable.data(), sinTable.data());
+            mpv::kernels::power_spectrum(re.data(), im.data(), power.data(), fftSize / 2 + 1);
+            // A full scale sine wave ends up at 0 dB.
+            const float normalization = 16.0f / (static_cast<float>(fftSize) * fftSize);
+            for (int b = 0; b != bandCount; ++b) {
+                float bandPower = 0.0f;
+                const int last = qMax(bandEdges[b + 1], bandEdges[b] + 1);
+                for (int i = bandEdges[b]; (i < last) && (i <= (fftSize / 2)); ++i) {
+                    bandPower = qMax(bandPower, power[i]);
+                }
+                const float decibels = 10.0f * std::log10(qMax(bandPower * normalization, 1e-12f));
+                spectrum[b] = qBound(0.0f, (decibels + m_dynamicRange) / m_dynamicRange, 1.0f);
+            }
+        }
+        {
+            QMutexLocker locker(&shared->mutex);
+            shared->peakLevels = peakLevels;
+            shared->rmsLevels = rmsLevels;
+            shared->spectrum = spectrum;
+        }
+        // Only one update is queued at a time, later results just replace
+        // the pending one.
+        if (shared->dirty.testAndSetOrdered(0, 1)) {
+            QMetaObject::invokeMethod(
+                this, [this, shared]() { applyLevels(shared); }, Qt::QueuedConnection);
+        }
+    }
+}
@@ -0,0 +1,129 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "mpvobject.h"
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QtQml/qqml.h>
+
+// Live audio levels and spectrum of a MpvObject, eg: for VU meters. mpv
+// doesn't hand out the PCM it plays, so a headless companion handle decodes
+// the same audio track (downmixed to stereo, 48 kHz) into a pipe on a worker
+// thread, paced against the player's position and resynchronized when it
+// seeks. Peak/RMS levels and the FFT are computed with SIMD kernels on that
+// thread; the results are handed to the GUI thread at most once per event
+// loop iteration, however high the update rate is.
+//
+// The companion handle opens the source a second time, so the audio is
+// decoded twice (and, for network streams, downloaded twice). For network and
+// live sources it is a separate connection, so what gets analyzed may not be
+// exactly the audio the player is playing.
+//
+// Nothing runs unless the analyzer is enabled, has a player with a source,
+// and something (a QML binding or a C++ connection) listens to
+// levelsChanged(), so an analyzer that isn't displayed costs nothing.
+class MpvAudioAnalyzer : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_DISABLE_COPY_MOVE(MpvAudioAnalyzer)
+
+    Q_PROPERTY(MpvObject *player READ player WRITE setPlayer NOTIFY playerChanged)
+    Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(int bandCount READ bandCount WRITE setBandCount NOTIFY bandCountChanged)
+    Q_PROPERTY(int updateRate READ updateRate WRITE setUpdateRate NOTIFY updateRateChanged)
+    Q_PROPERTY(int fftSize READ fftSize WRITE setFftSize NOTIFY fftSizeChanged)
+    Q_PROPERTY(bool running READ running NOTIFY runningChanged)
+    Q_PROPERTY(QList<qreal> peakLevels READ peakLevels NOTIFY levelsChanged)
+    Q_PROPERTY(QList<qreal> rmsLevels READ rmsLevels NOTIFY levelsChanged)
+    Q_PROPERTY(QList<qreal> spectrum READ spectrum NOTIFY levelsChanged)
+
+public:
+    explicit MpvAudioAnalyzer(QObject *parent = nullptr);
+    ~MpvAudioAnalyzer() override;
+
+    MpvObject *player() const;
+    bool enabled() const;
+    // Number of logarithmically spaced frequency bands between 20 Hz and
+    // 24 kHz. Defaults to 32.
+    int bandCount() const;
+    // How many times per second the levels are recomputed. Defaults to 30.
+    int updateRate() const;
+    // Number of samples per FFT, rounded to a power of two. Defaults to 2048.
+    int fftSize() const;
+    bool running() const;
+    // One value per channel (left, right), linear, 0.0 - 1.0.
+    QList<qreal> peakLevels() const;
+    QList<qreal> rmsLevels() const;
+    // One value per band, 0.0 (-90 dBFS or less) - 1.0 (0 dBFS).
+    QList<qreal> spectrum() const;
+
+    void setPlayer(MpvObject *player);
+    void setEnabled(const bool enabled);
+    void setBandCount(const int bandCount);
+    void setUpdateRate(const int updateRate);
+    void setFftSize(const int fftSize);
+
+Q_SIGNALS:
+    void playerChanged();
+    void enabledChanged();
+    void bandCountChanged();
+    void updateRateChanged();
+    void fftSizeChanged();
+    void runningChanged();
+    void levelsChanged();
+
+protected:
+    void connectNotify(const QMetaMethod &signal) override;
+    void disconnectNotify(const QMetaMethod &signal) override;
+
+private:
+    struct Shared;
+
+    void updateRunning();
+    void updatePlayerState();
+    void updateSettings();
+    void resetLevels();
+    void applyLevels(const QSharedPointer<Shared> &shared);
+    void runWorker(const QSharedPointer<Shared> &shared);
+
+private:
+    QPointer<MpvObject> currentPlayer;
+    bool currentEnabled = true;
+    int currentBandCount = 32;
+    int currentUpdateRate = 30;
+    int currentFftSize = 2048;
+
+    QThreadPool m_threadPool;
+    QSharedPointer<Shared> m_shared;
+    QList<qreal> m_peakLevels = {};
+    QList<qreal> m_rmsLevels = {};
+    QList<qreal> m_spectrum = {};
+    QList<QMetaObject::Connection> m_playerConnections = {};
+};
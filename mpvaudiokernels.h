@@ -0,0 +1,282 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <QtGlobal>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define WWX190_AUDIO_KERNELS_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define WWX190_AUDIO_KERNELS_NEON
+#endif
+
+// Reduction kernels for 32-bit float PCM data. Every function has a SIMD
+// code path (SSE2 or NEON, whatever the compiler targets) and a plain C++
+// fallback that produces the same results.
+
+namespace mpv {
+
+namespace kernels {
+
+// Min/max and sum of squares of a block of samples. "min" and "max" must be
+// initialized by the caller (eg: to +inf/-inf) so that a bin can be
+// accumulated from several blocks.
+static inline void accumulate_peaks(
+    const float *samples, const int count, float &min, float &max, double &sumSquares)
+{
+    int i = 0;
+#if defined(WWX190_AUDIO_KERNELS_SSE2)
+    if (count >= 8) {
+        __m128 vmin = _mm_set1_ps(min);
+        __m128 vmax = _mm_set1_ps(max);
+        __m128 vsum = _mm_setzero_ps();
+        for (; (i + 4) <= count; i += 4) {
+            const __m128 v = _mm_loadu_ps(samples + i);
+            vmin = _mm_min_ps(vmin, v);
+            vmax = _mm_max_ps(vmax, v);
+            vsum = _mm_add_ps(vsum, _mm_mul_ps(v, v));
+        }
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, vmin);
+        min = qMin(qMin(lanes[0], lanes[1]), qMin(lanes[2], lanes[3]));
+        _mm_store_ps(lanes, vmax);
+        max = qMax(qMax(lanes[0], lanes[1]), qMax(lanes[2], lanes[3]));
+        _mm_store_ps(lanes, vsum);
+        sumSquares += static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+#elif defined(WWX190_AUDIO_KERNELS_NEON)
+    if (count >= 8) {
+        float32x4_t vmin = vdupq_n_f32(min);
+        float32x4_t vmax = vdupq_n_f32(max);
+        float32x4_t vsum = vdupq_n_f32(0.0f);
+        for (; (i + 4) <= count; i += 4) {
+            const float32x4_t v = vld1q_f32(samples + i);
+            vmin = vminq_f32(vmin, v);
+            vmax = vmaxq_f32(vmax, v);
+            vsum = vmlaq_f32(vsum, v, v);
+        }
+        float lanes[4];
+        vst1q_f32(lanes, vmin);
+        min = qMin(qMin(lanes[0], lanes[1]), qMin(lanes[2], lanes[3]));
+        vst1q_f32(lanes, vmax);
+        max = qMax(qMax(lanes[0], lanes[1]), qMax(lanes[2], lanes[3]));
+        vst1q_f32(lanes, vsum);
+        sumSquares += static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+#endif
+    for (; i < count; ++i) {
+        const float v = samples[i];
+        min = qMin(min, v);
+        max = qMax(max, v);
+        sumSquares += static_cast<double>(v) * v;
+    }
+}
+
+// Halves the resolution of an envelope: every output bin covers two input
+// bins. "count" is the number of input bins, the output has count / 2 bins
+// (a trailing odd bin is handled by the caller).
+static inline void reduce_envelope(const float *mins,
+                                   const float *maxs,
+                                   const float *rms,
+                                   const int count,
+                                   float *outMins,
+                                   float *outMaxs,
+                                   float *outRms)
+{
+    const int outCount = count / 2;
+    int i = 0;
+#if defined(WWX190_AUDIO_KERNELS_SSE2)
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; (i + 4) <= outCount; i += 4) {
+        const int j = i * 2;
+        // Split 8 consecutive bins into the even and the odd ones.
+        const __m128 minLo = _mm_loadu_ps(mins + j);
+        const __m128 minHi = _mm_loadu_ps(mins + j + 4);
+        _mm_storeu_ps(outMins + i,
+                      _mm_min_ps(_mm_shuffle_ps(minLo, minHi, _MM_SHUFFLE(2, 0, 2, 0)),
+                                 _mm_shuffle_ps(minLo, minHi, _MM_SHUFFLE(3, 1, 3, 1))));
+        const __m128 maxLo = _mm_loadu_ps(maxs + j);
+        const __m128 maxHi = _mm_loadu_ps(maxs + j + 4);
+        _mm_storeu_ps(outMaxs + i,
+                      _mm_max_ps(_mm_shuffle_ps(maxLo, maxHi, _MM_SHUFFLE(2, 0, 2, 0)),
+                                 _mm_shuffle_ps(maxLo, maxHi, _MM_SHUFFLE(3, 1, 3, 1))));
+        const __m128 rmsLo = _mm_loadu_ps(rms + j);
+        const __m128 rmsHi = _mm_loadu_ps(rms + j + 4);
+        const __m128 even = _mm_shuffle_ps(rmsLo, rmsHi, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 odd = _mm_shuffle_ps(rmsLo, rmsHi, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(outRms + i,
+                      _mm_sqrt_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(even, even),
+                                                        _mm_mul_ps(odd, odd)),
+                                             half)));
+    }
+#elif defined(WWX190_AUDIO_KERNELS_NEON)
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    for (; (i + 4) <= outCount; i += 4) {
+        const int j = i * 2;
+        // vld2q de-interleaves the even and the odd bins for us.
+        const float32x4x2_t minPair = vld2q_f32(mins + j);
+        vst1q_f32(outMins + i, vminq_f32(minPair.val[0], minPair.val[1]));
+        const float32x4x2_t maxPair = vld2q_f32(maxs + j);
+        vst1q_f32(outMaxs + i, vmaxq_f32(maxPair.val[0], maxPair.val[1]));
+        const float32x4x2_t rmsPair = vld2q_f32(rms + j);
+        const float32x4_t meanSquare = vmulq_f32(vmlaq_f32(vmulq_f32(rmsPair.val[0],
+                                                                     rmsPair.val[0]),
+                                                           rmsPair.val[1],
+                                                           rmsPair.val[1]),
+                                                 half);
+        float lanes[4];
+        vst1q_f32(lanes, meanSquare);
+        for (int k = 0; k != 4; ++k) {
+            outRms[i + k] = std::sqrt(lanes[k]);
+        }
+    }
+#endif
+    for (; i < outCount; ++i) {
+        const int j = i * 2;
+        outMins[i] = qMin(mins[j], mins[j + 1]);
+        outMaxs[i] = qMax(maxs[j], maxs[j + 1]);
+        outRms[i] = std::sqrt((rms[j] * rms[j] + rms[j + 1] * rms[j + 1]) * 0.5f);
+    }
+}
+
+// Splits interleaved stereo frames into two planar buffers.
+static inline void deinterleave_stereo(const float *frames,
+                                       const int count,
+                                       float *left,
+                                       float *right)
+{
+    int i = 0;
+#if defined(WWX190_AUDIO_KERNELS_SSE2)
+    for (; (i + 4) <= count; i += 4) {
+        const __m128 lo = _mm_loadu_ps(frames + i * 2);
+        const __m128 hi = _mm_loadu_ps(frames + i * 2 + 4);
+        _mm_storeu_ps(left + i, _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i, _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+#elif defined(WWX190_AUDIO_KERNELS_NEON)
+    for (; (i + 4) <= count; i += 4) {
+        const float32x4x2_t pair = vld2q_f32(frames + i * 2);
+        vst1q_f32(left + i, pair.val[0]);
+        vst1q_f32(right + i, pair.val[1]);
+    }
+#endif
+    for (; i < count; ++i) {
+        left[i] = frames[i * 2];
+        right[i] = frames[i * 2 + 1];
+    }
+}
+
+// out[i] = (a[i] + b[i]) * window[i], ie: a windowed mono downmix (pass the
+// same buffer twice and a pre-halved window for a single channel).
+static inline void mix_and_window(
+    const float *a, const float *b, const float *window, float *out, const int count)
+{
+    int i = 0;
+#if defined(WWX190_AUDIO_KERNELS_SSE2)
+    for (; (i + 4) <= count; i += 4) {
+        _mm_storeu_ps(out + i,
+                      _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)),
+                                 _mm_loadu_ps(window + i)));
+    }
+#elif defined(WWX190_AUDIO_KERNELS_NEON)
+    for (; (i + 4) <= count; i += 4) {
+        vst1q_f32(out + i,
+                  vmulq_f32(vaddq_f32(vld1q_f32(a + i), vld1q_f32(b + i)),
+                            vld1q_f32(window + i)));
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = (a[i] + b[i]) * window[i];
+    }
+}
+
+// power[i] = re[i] * re[i] + im[i] * im[i]
+static inline void power_spectrum(const float *re, const float *im, float *power, const int count)
+{
+    int i = 0;
+#if defined(WWX190_AUDIO_KERNELS_SSE2)
+    for (; (i + 4) <= count; i += 4) {
+        const __m128 r = _mm_loadu_ps(re + i);
+        const __m128 m = _mm_loadu_ps(im + i);
+        _mm_storeu_ps(power + i, _mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m)));
+    }
+#elif defined(WWX190_AUDIO_KERNELS_NEON)
+    for (; (i + 4) <= count; i += 4) {
+        const float32x4_t r = vld1q_f32(re + i);
+        const float32x4_t m = vld1q_f32(im + i);
+        vst1q_f32(power + i, vmlaq_f32(vmulq_f32(r, r), m, m));
+    }
+#endif
+    for (; i < count; ++i) {
+        power[i] = re[i] * re[i] + im[i] * im[i];
+    }
+}
+
+// In-place iterative radix-2 complex FFT. "size" must be a power of two and
+// the tables must hold cos(2 * pi * i / size) and -sin(2 * pi * i / size)
+// for i in [0, size / 2). The butterflies of the later stages work on
+// contiguous runs and are left to the compiler's auto-vectorizer.
+static inline void fft_radix2(
+    float *re, float *im, const int size, const float *cosTable, const float *sinTable)
+{
+    for (int i = 1, j = 0; i < size; ++i) {
+        int bit = size >> 1;
+        for (; (j & bit) != 0; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            qSwap(re[i], re[j]);
+            qSwap(im[i], im[j]);
+        }
+    }
+    for (int length = 2; length <= size; length <<= 1) {
+        const int half = length >> 1;
+        const int step = size / length;
+        for (int begin = 0; begin < size; begin += length) {
+            float *re0 = re + begin;
+            float *im0 = im + begin;
+            float *re1 = re0 + half;
+            float *im1 = im0 + half;
+            for (int k = 0; k < half; ++k) {
+                const float c = cosTable[k * step];
+                const float s = sinTable[k * step];
+                const float tre = re1[k] * c - im1[k] * s;
+                const float tim = re1[k] * s + im1[k] * c;
+                re1[k] = re0[k] - tre;
+                im1[k] = im0[k] - tim;
+                re0[k] += tre;
+                im0[k] += tim;
+            }
+        }
+    }
+}
+
+} // namespace kernels
+
+} // namespace mpv
@@ -0,0 +1,168 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvcachetelemetry.h"
+
+#include <algorithm>
+
+MpvCacheTelemetry::MpvCacheTelemetry(QObject *parent) : QObject(parent) {}
+
+MpvCacheTelemetry::~MpvCacheTelemetry() = default;
+
+qreal MpvCacheTelemetry::cachedDuration() const
+{
+    return m_state.value(QString::fromUtf8("cache-duration")).toReal();
+}
+
+qint64 MpvCacheTelemetry::bytes() const
+{
+    return m_state.value(QString::fromUtf8("total-bytes")).toLongLong();
+}
+
+qint64 MpvCacheTelemetry::forwardBytes() const
+{
+    return m_state.value(QString::fromUtf8("fw-bytes")).toLongLong();
+}
+
+qreal MpvCacheTelemetry::readerPosition() const
+{
+    return m_state.value(QString::fromUtf8("reader-pts")).toReal();
+}
+
+qreal MpvCacheTelemetry::forwardDuration() const
+{
+    return m_forwardDuration;
+}
+
+qreal MpvCacheTelemetry::backwardDuration() const
+{
+    return m_backwardDuration;
+}
+
+QVariantList MpvCacheTelemetry::ranges() const
+{
+    return m_ranges;
+}
+
+qreal MpvCacheTelemetry::inputRate() const
+{
+    return m_state.value(QString::fromUtf8("raw-input-rate")).toReal();
+}
+
+bool MpvCacheTelemetry::endCached() const
+{
+    return m_state.value(QString::fromUtf8("eof-cached")).toBool();
+}
+
+bool MpvCacheTelemetry::idle() const
+{
+    return m_state.value(QString::fromUtf8("idle")).toBool();
+}
+
+bool MpvCacheTelemetry::stalled() const
+{
+    return currentStalled;
+}
+
+int MpvCacheTelemetry::bufferingProgress() const
+{
+    return currentBufferingProgress;
+}
+
+int MpvCacheTelemetry::underrunCount() const
+{
+    return currentUnderrunCount;
+}
+
+void MpvCacheTelemetry::setCacheState(const QVariantMap &state)
+{
+    if (state == m_state) {
+        return;
+    }
+    m_state = state;
+    m_ranges.clear();
+    const QVariantList seekableRanges = m_state.value(QString::fromUtf8("seekable-ranges"))
+                                            .toList();
+    for (auto &&range : qAsConst(seekableRanges)) {
+        const QVariantMap map = range.toMap();
+        m_ranges.append(QVariantMap{{QString::fromUtf8("start"),
+                                     map.value(QString::fromUtf8("start")).toReal()},
+                                    {QString::fromUtf8("end"),
+                                     map.value(QString::fromUtf8("end")).toReal()}});
+    }
+    std::sort(m_ranges.begin(), m_ranges.end(), [](const QVariant &lhs, const QVariant &rhs) {
+        return lhs.toMap().value(QString::fromUtf8("start")).toReal()
+               < rhs.toMap().value(QString::fromUtf8("start")).toReal();
+    });
+    // The range the demuxer is reading in.
+    const qreal reader = readerPosition();
+    m_backwardDuration = 0.0;
+    m_forwardDuration = cachedDuration();
+    for (auto &&range : qAsConst(m_ranges)) {
+        const QVariantMap map = range.toMap();
+        const qreal start = map.value(QString::fromUtf8("start")).toReal();
+        const qreal end = map.value(QString::fromUtf8("end")).toReal();
+        if ((reader >= start) && (reader <= end)) {
+            m_backwardDuration = reader - start;
+            m_forwardDuration = end - reader;
+            break;
+        }
+    }
+    Q_EMIT cacheStateChanged();
+}
+
+void MpvCacheTelemetry::setStalled(const bool stalled)
+{
+    if (stalled == currentStalled) {
+        return;
+    }
+    currentStalled = stalled;
+    Q_EMIT stalledChanged();
+    if (currentStalled) {
+        ++currentUnderrunCount;
+        Q_EMIT underrunCountChanged();
+        Q_EMIT underrun();
+    }
+}
+
+void MpvCacheTelemetry::setBufferingProgress(const int bufferingProgress)
+{
+    const int progress = qBound(0, bufferingProgress, 100);
+    if (progress == currentBufferingProgress) {
+        return;
+    }
+    currentBufferingProgress = progress;
+    Q_EMIT bufferingProgressChanged();
+}
+
+void MpvCacheTelemetry::reset()
+{
+    setCacheState({});
+    setStalled(false);
+    setBufferingProgress(0);
+    if (currentUnderrunCount != 0) {
+        currentUnderrunCount = 0;
+        Q_EMIT underrunCountChanged();
+    }
+}
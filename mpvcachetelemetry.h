@@ -0,0 +1,121 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QtQml/qqml.h>
+
+// The state of the demuxer cache of a MpvObject, kept up to date from the
+// "demuxer-cache-state", "paused-for-cache" and "cache-buffering-state"
+// properties, eg: to draw the buffered ranges on a seek bar or to report
+// rebuffering.
+//
+// Everything but underrunCount describes the current file. underrunCount
+// counts the times playback had to pause to wait for the cache since the
+// current file started (or since reset() was called).
+class MpvCacheTelemetry : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("Provided by MpvObject.")
+    Q_DISABLE_COPY_MOVE(MpvCacheTelemetry)
+
+    Q_PROPERTY(qreal cachedDuration READ cachedDuration NOTIFY cacheStateChanged)
+    Q_PROPERTY(qint64 bytes READ bytes NOTIFY cacheStateChanged)
+    Q_PROPERTY(qint64 forwardBytes READ forwardBytes NOTIFY cacheStateChanged)
+    Q_PROPERTY(qreal readerPosition READ readerPosition NOTIFY cacheStateChanged)
+    Q_PROPERTY(qreal forwardDuration READ forwardDuration NOTIFY cacheStateChanged)
+    Q_PROPERTY(qreal backwardDuration READ backwardDuration NOTIFY cacheStateChanged)
+    Q_PROPERTY(QVariantList ranges READ ranges NOTIFY cacheStateChanged)
+    Q_PROPERTY(qreal inputRate READ inputRate NOTIFY cacheStateChanged)
+    Q_PROPERTY(bool endCached READ endCached NOTIFY cacheStateChanged)
+    Q_PROPERTY(bool idle READ idle NOTIFY cacheStateChanged)
+    Q_PROPERTY(bool stalled READ stalled NOTIFY stalledChanged)
+    Q_PROPERTY(int bufferingProgress READ bufferingProgress NOTIFY bufferingProgressChanged)
+    Q_PROPERTY(int underrunCount READ underrunCount NOTIFY underrunCountChanged)
+
+public:
+    explicit MpvCacheTelemetry(QObject *parent = nullptr);
+    ~MpvCacheTelemetry() override;
+
+    // How much is cached ahead of the playback position, in seconds
+    // ("cache-duration").
+    qreal cachedDuration() const;
+    // Memory used by the cache ("total-bytes") and by what's ahead of the
+    // playback position ("fw-bytes").
+    qint64 bytes() const;
+    qint64 forwardBytes() const;
+    // Where the demuxer reads, in seconds ("reader-pts").
+    qreal readerPosition() const;
+    // Cached ahead of and behind the reader, in seconds, within the range
+    // that contains it.
+    qreal forwardDuration() const;
+    qreal backwardDuration() const;
+    // The cached ranges, sorted by time: one map per range with "start"
+    // and "end", in seconds ("seekable-ranges").
+    QVariantList ranges() const;
+    // How fast data comes in, in bytes per second ("raw-input-rate").
+    qreal inputRate() const;
+    // Whether everything up to the end of the file is cached.
+    bool endCached() const;
+    // Whether the demuxer stopped reading, because the cache is full or the
+    // end has been reached.
+    bool idle() const;
+    // Whether playback is paused to wait for the cache
+    // ("paused-for-cache").
+    bool stalled() const;
+    // 0 - 100, how much of what's needed to resume playback has been
+    // cached while stalled ("cache-buffering-state").
+    int bufferingProgress() const;
+    int underrunCount() const;
+
+    // Called by MpvObject.
+    void setCacheState(const QVariantMap &state);
+    void setStalled(const bool stalled);
+    void setBufferingProgress(const int bufferingProgress);
+
+public Q_SLOTS:
+    // Forgets the current file, including the underruns.
+    void reset();
+
+Q_SIGNALS:
+    void cacheStateChanged();
+    void stalledChanged();
+    void bufferingProgressChanged();
+    void underrunCountChanged();
+    // Emitted each time playback has to pause to wait for the cache.
+    void underrun();
+
+private:
+    QVariantMap m_state = {};
+    QVariantList m_ranges = {};
+    qreal m_backwardDuration = 0.0;
+    qreal m_forwardDuration = 0.0;
+    bool currentStalled = false;
+    int currentBufferingProgress = 0;
+    int currentUnderrunCount = 0;
+};
@@ -0,0 +1,424 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvcore.h"
+#include "mpveventdispatcher.h"
+#include "mpvhandlepool.h"
+#include "mpvtracer.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFileInfo>
+#include <QPointer>
+#include <QThreadPool>
+
+Q_LOGGING_CATEGORY(lcMpvCommand, "libmpv.command.general")
+Q_LOGGING_CATEGORY(lcMpvProperty, "libmpv.property.general")
+Q_LOGGING_CATEGORY(lcMpvMisc, "libmpv.misc.general")
+
+MpvCore::MpvCore(QObject *parent) : QObject(parent) {}
+
+MpvCore::~MpvCore()
+{
+    if (!m_mpv) {
+        return;
+    }
+    if (m_dispatcher) {
+        m_dispatcher->unregisterCore(this);
+    }
+    if (MpvHandlePool *pool = MpvHandlePool::instance()) {
+        pool->release(m_mpv, m_changedOptions);
+    } else {
+        mpv::qt::terminate_destroy(m_mpv);
+    }
+}
+
+mpv_handle *MpvCore::handle() const
+{
+    return m_mpv;
+}
+
+bool MpvCore::ready() const
+{
+    return (m_mpv != nullptr);
+}
+
+bool MpvCore::autoInitialize() const
+{
+    return currentAutoInitialize;
+}
+
+bool MpvCore::videoOutput() const
+{
+    return currentVideoOutput;
+}
+
+bool MpvCore::asynchronousCalls() const
+{
+    return currentAsynchronousCalls;
+}
+
+bool MpvCore::quiet() const
+{
+    return currentQuiet;
+}
+
+qint64 MpvCore::queueOverflows() const
+{
+    return m_queueOverflows;
+}
+
+void MpvCore::setAutoInitialize(const bool autoInitialize)
+{
+    if (autoInitialize == currentAutoInitialize) {
+        return;
+    }
+    currentAutoInitialize = autoInitialize;
+    Q_EMIT autoInitializeChanged();
+}
+
+void MpvCore::setVideoOutput(const bool videoOutput)
+{
+    if (videoOutput == currentVideoOutput) {
+        return;
+    }
+    currentVideoOutput = videoOutput;
+    Q_EMIT videoOutputChanged();
+}
+
+void MpvCore::setAsynchronousCalls(const bool asynchronousCalls)
+{
+    if (asynchronousCalls == currentAsynchronousCalls) {
+        return;
+    }
+    currentAsynchronousCalls = asynchronousCalls;
+    Q_EMIT asynchronousCallsChanged();
+}
+
+void MpvCore::setQuiet(const bool quiet)
+{
+    if (quiet == currentQuiet) {
+        return;
+    }
+    currentQuiet = quiet;
+    Q_EMIT quietChanged();
+}
+
+bool MpvCore::initialize()
+{
+    if (m_mpv) {
+        return true;
+    }
+    if (m_initializing) {
+        return false;
+    }
+    mpv::qt::libmpv_init(mpv::qt::libmpv_path());
+    // The handle comes initialized, with all our properties observed
+    // already, see MpvHandlePool::createHandle().
+    MpvHandlePool *pool = MpvHandlePool::instance();
+    setHandle(pool ? pool->acquire() : MpvHandlePool::createHandle());
+    return (m_mpv != nullptr);
+}
+
+void MpvCore::initializeAsynchronously()
+{
+    if (m_mpv || m_initializing) {
+        return;
+    }
+    m_initializing = true;
+    MpvHandlePool *pool = MpvHandlePool::instance();
+    const QPointer<MpvCore> guard(this);
+    QThreadPool::globalInstance()->start([guard, pool]() {
+        // Loading libmpv and mpv_initialize() are the expensive parts.
+        mpv::qt::libmpv_init(mpv::qt::libmpv_path());
+        mpv_handle *mpv = pool ? pool->acquire() : MpvHandlePool::createHandle();
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [guard, mpv]() {
+                if (guard) {
+                    guard->setHandle(mpv);
+                } else if (MpvHandlePool *pool = MpvHandlePool::instance()) {
+                    // The core has been destroyed in the meantime.
+                    pool->release(mpv, {});
+                } else if (mpv) {
+                    mpv::qt::terminate_destroy(mpv);
+                }
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+void MpvCore::setHandle(mpv_handle *mpv)
+{
+    m_initializing = false;
+    if (!mpv) {
+        qCWarning(lcMpvMisc) << "Failed to create the mpv handle.";
+        return;
+    }
+    m_mpv = mpv;
+    // From this point on, the events are delivered by the dispatcher of
+    // this thread, including the ones that are already queued.
+    m_dispatcher = MpvEventDispatcher::instance();
+    m_dispatcher->registerCore(this);
+
+    // Before anything else, so that the video output can still be changed.
+    setMpvProperty(QString::fromUtf8("vo"),
+                   currentVideoOutput ? QString::fromUtf8("libmpv") : QString::fromUtf8("null"));
+    const QVector<std::function<void()>> pendingCalls = m_pendingCalls;
+    m_pendingCalls.clear();
+    m_pendingProperties.clear();
+    for (auto &&call : qAsConst(pendingCalls)) {
+        call();
+    }
+
+    Q_EMIT readyChanged();
+}
+
+bool MpvCore::command(const QVariant &arguments)
+{
+    if (arguments.isNull() || !arguments.isValid()) {
+        return false;
+    }
+    if (!m_mpv && (!currentAutoInitialize || !initialize())) {
+        m_pendingCalls.append([this, arguments]() { command(arguments); });
+        return true;
+    }
+    if (!currentQuiet) {
+        qCDebug(lcMpvCommand).noquote() << arguments;
+    }
+    int errorCode = 0;
+    if (currentAsynchronousCalls) {
+        errorCode = mpv::qt::command_async(m_mpv, arguments, 0);
+    } else {
+        errorCode = mpv::qt::get_error(mpv::qt::command(m_mpv, arguments));
+    }
+    if ((errorCode < 0) && !currentQuiet) {
+        qCWarning(lcMpvCommand).noquote()
+            << "Failed to send command" << arguments << ':' << mpv::qt::error_string(errorCode);
+    }
+    return (errorCode >= 0);
+}
+
+bool MpvCore::setMpvProperty(const QString &name, const QVariant &value)
+{
+    if (name.isEmpty() || value.isNull() || !value.isValid()) {
+        return false;
+    }
+    if (!currentQuiet) {
+        qCDebug(lcMpvProperty).noquote() << name << "-->" << value;
+    }
+    // Restored to its default when the handle goes back to the pool.
+    m_changedOptions.insert(name);
+    if (!m_mpv && (!currentAutoInitialize || !initialize())) {
+        m_pendingCalls.append([this, name, value]() { setMpvProperty(name, value); });
+        m_pendingProperties.insert(name, value);
+        return true;
+    }
+    // The cached value is outdated now, until the change notification
+    // arrives mpvProperty() has to ask mpv.
+    m_cache.remove(name);
+    int errorCode = 0;
+    if (currentAsynchronousCalls) {
+        errorCode = mpv::qt::set_property_async(m_mpv, name, value, 0);
+    } else {
+        errorCode = mpv::qt::set_property(m_mpv, name, value);
+    }
+    if ((errorCode < 0) && !currentQuiet) {
+        qCWarning(lcMpvProperty).noquote() << "Failed to change property" << name << "to" << value
+                                           << ':' << mpv::qt::error_string(errorCode);
+    }
+    return (errorCode >= 0);
+}
+
+QVariant MpvCore::mpvProperty(const QString &name, const bool silent, bool *ok) const
+{
+    if (ok) {
+        *ok = false;
+    }
+    if (name.isEmpty()) {
+        return QVariant();
+    }
+    if (!m_mpv) {
+        // Answer with what has been requested so far.
+        if (m_pendingProperties.contains(name)) {
+            if (ok) {
+                *ok = true;
+            }
+            return m_pendingProperties.value(name);
+        }
+        return QVariant();
+    }
+    const auto cached = m_cache.constFind(name);
+    if (cached != m_cache.constEnd()) {
+        if (ok) {
+            *ok = true;
+        }
+        return cached.value();
+    }
+    const QVariant result = mpv::qt::get_property(m_mpv, name);
+    const int errorCode = mpv::qt::get_error(result);
+    if (result.isNull() || !result.isValid() || (errorCode < 0)) {
+        if (!silent && !currentQuiet) {
+            qCWarning(lcMpvProperty).noquote()
+                << "Failed to query property" << name << ':' << mpv::qt::error_string(errorCode);
+        }
+    } else if (ok) {
+        *ok = true;
+    }
+    return result;
+}
+
+bool MpvCore::loadConfigFile(const QString &path)
+{
+    if (path.isEmpty() || !QFileInfo::exists(path)) {
+        return false;
+    }
+    if (!m_mpv && (!currentAutoInitialize || !initialize())) {
+        m_pendingCalls.append([this, path]() { loadConfigFile(path); });
+        return true;
+    }
+    const int errorCode = mpv::qt::load_config_file(m_mpv, path);
+    if ((errorCode < 0) && !currentQuiet) {
+        qCWarning(lcMpvMisc).noquote()
+            << "Failed to load the config file" << path << ':' << mpv::qt::error_string(errorCode);
+    }
+    return (errorCode >= 0);
+}
+
+bool MpvCore::requestLogMessages(const QString &level)
+{
+    if (level.isEmpty()) {
+        return false;
+    }
+    if (!m_mpv && (!currentAutoInitialize || !initialize())) {
+        m_pendingCalls.append([this, level]() { requestLogMessages(level); });
+        return true;
+    }
+    const int errorCode = mpv::qt::request_log_messages(m_mpv, level);
+    if ((errorCode < 0) && !currentQuiet) {
+        qCWarning(lcMpvMisc).noquote()
+            << "Failed to request log messages" << level << ':' << mpv::qt::error_string(errorCode);
+    }
+    return (errorCode >= 0);
+}
+
+QVariant MpvCore::eventValue(const mpv_event_property *property)
+{
+    switch (property->format) {
+    case MPV_FORMAT_NODE:
+        return mpv::qt::node_to_variant(static_cast<const mpv_node *>(property->data));
+    case MPV_FORMAT_DOUBLE:
+        return *static_cast<const double *>(property->data);
+    case MPV_FORMAT_INT64:
+        return static_cast<qlonglong>(*static_cast<const int64_t *>(property->data));
+    case MPV_FORMAT_FLAG:
+        return (*static_cast<const int *>(property->data) != 0);
+    case MPV_FORMAT_STRING:
+        return QString::fromUtf8(*static_cast<const char *const *>(property->data));
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+void MpvCore::handleEvents()
+{
+    const MpvTraceScope trace("handleEvents", "core");
+    qint64 count = 0;
+    bool overflowed = false;
+    // Process all events, until the event queue is empty.
+    while (m_mpv) {
+        // Never block: the dispatcher drains the other handles in the same
+        // pass.
+        const mpv_event *event = mpv::qt::wait_event(m_mpv, 0);
+        // Nothing happened. Happens on sporadic wakeups.
+        if (event->event_id == MPV_EVENT_NONE) {
+            break;
+        }
+        ++count;
+        if (event->event_id == MPV_EVENT_QUEUE_OVERFLOW) {
+            ++m_queueOverflows;
+            overflowed = true;
+        }
+        if (event->event_id != MPV_EVENT_PROPERTY_CHANGE) {
+            MpvTraceScope dispatch("event", "core");
+            if (dispatch.isActive()) {
+                dispatch.setDetail(mpv::qt::event_name(event->event_id));
+            }
+            Q_EMIT eventReceived(event);
+            continue;
+        }
+        const auto property = static_cast<const mpv_event_property *>(event->data);
+        MpvTraceScope dispatch("propertyChange", "core");
+        dispatch.setDetail(property->name);
+        const QString name = QString::fromUtf8(property->name);
+        const QVariant value = eventValue(property);
+        if (property->format == MPV_FORMAT_NONE) {
+            m_cache.remove(name);
+        } else {
+            m_cache.insert(name, value);
+        }
+        Q_EMIT propertyChanged(name, value);
+    }
+    if (trace.isActive()) {
+        MpvTracer::counter("eventBatch", count);
+    }
+    // Only once the queue is empty, or the notifications that were still
+    // queued would overwrite the fresh values with older ones.
+    if (overflowed) {
+        if (!currentQuiet) {
+            qCWarning(lcMpvMisc) << "The event queue overflowed, resynchronizing the properties.";
+        }
+        Q_EMIT queueOverflowsChanged();
+        resync();
+    }
+}
+
+void MpvCore::resync()
+{
+    if (!m_mpv) {
+        return;
+    }
+    const MpvTraceScope trace("resync", "core");
+    const QHash<QString, mpv_format> properties = MpvHandlePool::observedProperties();
+    auto iterator = properties.cbegin();
+    while (m_mpv && (iterator != properties.cend())) {
+        const QString &name = iterator.key();
+        QVariant value = {};
+        // The others are queried again by whoever is notified.
+        if (iterator.value() != MPV_FORMAT_NONE) {
+            const QVariant result = mpv::qt::get_property(m_mpv, name);
+            if (!mpv::qt::is_error(result)) {
+                value = result;
+            }
+        }
+        if (value.isValid()) {
+            m_cache.insert(name, value);
+        } else {
+            m_cache.remove(name);
+        }
+        Q_EMIT propertyChanged(name, value);
+        ++iterator;
+    }
+}
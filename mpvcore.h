@@ -0,0 +1,177 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+// Don't use any deprecated APIs from MPV.
+#ifdef MPV_ENABLE_DEPRECATED
+#undef MPV_ENABLE_DEPRECATED
+#endif
+
+#define MPV_ENABLE_DEPRECATED 0
+
+#include "mpvqthelper.hpp"
+#include <QLoggingCategory>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QVariantHash>
+#include <QVector>
+#include <functional>
+
+Q_DECLARE_LOGGING_CATEGORY(lcMpvCommand)
+Q_DECLARE_LOGGING_CATEGORY(lcMpvProperty)
+Q_DECLARE_LOGGING_CATEGORY(lcMpvMisc)
+
+// A mpv handle and everything needed to drive it, without anything to show
+// the video: it works with a QCoreApplication, eg: for audio-only services
+// or server-side processing. MpvObject is a view on top of one.
+//
+// The handle comes from MpvHandlePool, initialized and with every property
+// MpvObject needs observed, and goes back to it when the core is
+// destroyed. It can be created synchronously, on first use, or on a worker
+// thread; until it exists, property changes and commands are queued and
+// replayed in order.
+//
+// Events are pumped on the thread the core lives in, by the
+// MpvEventDispatcher shared with every other core of that thread, and the
+// values mpv
+// sends along with property change notifications (see
+// MpvObject::propertyFormats) are cached, so reading them doesn't query
+// mpv again.
+class MpvEventDispatcher;
+
+class MpvCore : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(MpvCore)
+
+    Q_PROPERTY(bool ready READ ready NOTIFY readyChanged)
+    Q_PROPERTY(bool autoInitialize READ autoInitialize WRITE setAutoInitialize NOTIFY
+                   autoInitializeChanged)
+    Q_PROPERTY(bool videoOutput READ videoOutput WRITE setVideoOutput NOTIFY videoOutputChanged)
+    Q_PROPERTY(bool asynchronousCalls READ asynchronousCalls WRITE setAsynchronousCalls NOTIFY
+                   asynchronousCallsChanged)
+    Q_PROPERTY(bool quiet READ quiet WRITE setQuiet NOTIFY quietChanged)
+    Q_PROPERTY(qint64 queueOverflows READ queueOverflows NOTIFY queueOverflowsChanged)
+
+public:
+    explicit MpvCore(QObject *parent = nullptr);
+    ~MpvCore() override;
+
+    // Null until the core is ready.
+    mpv_handle *handle() const;
+    // Whether the mpv handle exists.
+    bool ready() const;
+    // Create the handle synchronously on first use (enabled by default).
+    // Otherwise calls are queued until initialize() or
+    // initializeAsynchronously() is called.
+    bool autoInitialize() const;
+    // Whether the video is rendered through the render API (vo=libmpv), by
+    // a view such as MpvObject. Otherwise the video is decoded but thrown
+    // away (vo=null), so no window is ever created. Disabled by default,
+    // only has an effect before the core is ready.
+    bool videoOutput() const;
+    // Use mpv_command_async() and mpv_set_property_async() instead of their
+    // synchronous counterparts.
+    bool asynchronousCalls() const;
+    // Don't log commands, property changes and failures.
+    bool quiet() const;
+    // How many times the event queue of the handle overflowed. libmpv's
+    // queue holds 1000 events and can't be resized, events that don't fit
+    // are lost, which is made up for with resync().
+    qint64 queueOverflows() const;
+
+    void setAutoInitialize(const bool autoInitialize);
+    void setVideoOutput(const bool videoOutput);
+    void setAsynchronousCalls(const bool asynchronousCalls);
+    void setQuiet(const bool quiet);
+
+    // Creates the handle now, if it doesn't exist and isn't being created.
+    // Returns whether it exists.
+    bool initialize();
+    // Creates the handle on a worker thread, readyChanged() is emitted once
+    // it's done.
+    void initializeAsynchronously();
+
+    bool command(const QVariant &arguments);
+    bool setMpvProperty(const QString &name, const QVariant &value);
+    // Before the core is ready, answers with the values that have been
+    // requested so far.
+    QVariant mpvProperty(const QString &name, const bool silent = false, bool *ok = nullptr) const;
+    // Loads and parses the config file, and sets every entry in the config
+    // file's default section as if mpv_set_option_string() is called.
+    bool loadConfigFile(const QString &path);
+    // See mpv_request_log_messages().
+    bool requestLogMessages(const QString &level);
+    // Reads every observed property again and notifies them as if they had
+    // changed. Done automatically when the event queue overflows, since the
+    // change notifications that were lost would leave stale values behind.
+    void resync();
+
+    // The value sent along with a property change notification, invalid
+    // if the property is unavailable or has been observed without format.
+    static QVariant eventValue(const mpv_event_property *property);
+
+Q_SIGNALS:
+    void readyChanged();
+    void autoInitializeChanged();
+    void videoOutputChanged();
+    void asynchronousCallsChanged();
+    void quietChanged();
+    void queueOverflowsChanged();
+
+    // Every event but property changes, the event is only valid during the
+    // emission.
+    void eventReceived(const mpv_event *event);
+    // The value is only valid if mpv sent it along with the notification,
+    // see eventValue().
+    void propertyChanged(const QString &name, const QVariant &value);
+
+private:
+    friend class MpvEventDispatcher;
+
+    // Drains the event queue of the handle, called by the dispatcher.
+    void handleEvents();
+    // Takes ownership of the handle and replays the pending calls.
+    void setHandle(mpv_handle *mpv);
+
+private:
+    mpv_handle *m_mpv = nullptr;
+    // The dispatcher the handle has been registered with.
+    QPointer<MpvEventDispatcher> m_dispatcher = nullptr;
+    bool currentAutoInitialize = true;
+    bool currentVideoOutput = false;
+    bool currentAsynchronousCalls = false;
+    bool currentQuiet = false;
+    bool m_initializing = false;
+    qint64 m_queueOverflows = 0;
+    // Every option/property that has been set through setMpvProperty().
+    QSet<QString> m_changedOptions = {};
+    // Everything that has been requested before the handle existed.
+    QVector<std::function<void()>> m_pendingCalls = {};
+    QVariantHash m_pendingProperties = {};
+    // The values mpv sent along with the change notifications.
+    QVariantHash m_cache = {};
+};
@@ -0,0 +1,147 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpveventdispatcher.h"
+#include "mpvcore.h"
+
+#include <QThreadStorage>
+
+MpvEventDispatcher *MpvEventDispatcher::instance()
+{
+    // Deleted when the thread finishes.
+    static QThreadStorage<MpvEventDispatcher *> dispatchers;
+    if (!dispatchers.hasLocalData()) {
+        dispatchers.setLocalData(new MpvEventDispatcher());
+    }
+    return dispatchers.localData();
+}
+
+MpvEventDispatcher::MpvEventDispatcher(QObject *parent) : QObject(parent) {}
+
+MpvEventDispatcher::~MpvEventDispatcher()
+{
+    // Cores that are still around won't receive their events anymore, but
+    // mpv must not call us either.
+    for (auto &&client : qAsConst(m_clients)) {
+        mpv::qt::set_wakeup_callback(client->mpv, nullptr, nullptr);
+        delete client;
+    }
+    m_clients.clear();
+}
+
+void MpvEventDispatcher::registerCore(MpvCore *core)
+{
+    Q_ASSERT(core && core->handle());
+    if (!core || !core->handle() || m_clients.contains(core)) {
+        return;
+    }
+    auto client = new Client;
+    client->dispatcher = this;
+    client->core = core;
+    client->mpv = core->handle();
+    m_clients.insert(core, client);
+    mpv::qt::set_wakeup_callback(client->mpv, wakeup, client);
+    // Events that have been queued before the callback was installed won't
+    // trigger it.
+    wakeup(client);
+}
+
+void MpvEventDispatcher::unregisterCore(MpvCore *core)
+{
+    Client *client = m_clients.take(core);
+    if (!client) {
+        return;
+    }
+    // Once this returns, the callback can't be running anymore: mpv calls
+    // it with the same lock held.
+    mpv::qt::set_wakeup_callback(client->mpv, nullptr, nullptr);
+    client->core = nullptr;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_ready.removeAll(client);
+    }
+    if (m_dispatching) {
+        // The current pass may still hold it.
+        m_retired.append(client);
+    } else {
+        delete client;
+    }
+}
+
+quint64 MpvEventDispatcher::passes() const
+{
+    return m_passes;
+}
+
+quint64 MpvEventDispatcher::drains() const
+{
+    return m_drains;
+}
+
+void MpvEventDispatcher::wakeup(void *ctx)
+{
+    // This callback is invoked from any mpv thread (but possibly also
+    // recursively from a thread that is calling the mpv API), so it only
+    // marks the handle as ready and returns as quickly as possible.
+    const auto client = static_cast<Client *>(ctx);
+    if (!client->queued.testAndSetOrdered(0, 1)) {
+        // Already in the ready set.
+        return;
+    }
+    MpvEventDispatcher *dispatcher = client->dispatcher;
+    bool schedule = false;
+    {
+        QMutexLocker locker(&dispatcher->m_mutex);
+        dispatcher->m_ready.append(client);
+        schedule = !dispatcher->m_scheduled;
+        dispatcher->m_scheduled = true;
+    }
+    if (schedule) {
+        QMetaObject::invokeMethod(dispatcher, &MpvEventDispatcher::dispatch, Qt::QueuedConnection);
+    }
+}
+
+void MpvEventDispatcher::dispatch()
+{
+    QVector<Client *> ready = {};
+    {
+        QMutexLocker locker(&m_mutex);
+        ready.swap(m_ready);
+        m_scheduled = false;
+    }
+    ++m_passes;
+    m_dispatching = true;
+    for (auto &&client : qAsConst(ready)) {
+        // Wakeups that happen while draining put the client back in the set
+        // for the next pass.
+        client->queued.storeRelease(0);
+        if (client->core) {
+            ++m_drains;
+            client->core->handleEvents();
+        }
+    }
+    m_dispatching = false;
+    qDeleteAll(m_retired);
+    m_retired.clear();
+}
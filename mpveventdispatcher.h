@@ -0,0 +1,103 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+// Don't use any deprecated APIs from MPV.
+#ifdef MPV_ENABLE_DEPRECATED
+#undef MPV_ENABLE_DEPRECATED
+#endif
+
+#define MPV_ENABLE_DEPRECATED 0
+
+#include "mpvqthelper.hpp"
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QVector>
+
+class MpvCore;
+
+// Multiplexes the events of every mpv handle used on a thread. Instead of
+// one queued call per wakeup and per handle, the wakeup callback only adds
+// the handle to a ready set, and the first handle that becomes ready
+// schedules a single dispatch pass. That pass drains every ready handle,
+// each one in a single go, so a video wall with dozens of players costs one
+// metacall per event loop iteration instead of one per wakeup.
+//
+// There's one dispatcher per thread, cores register with the one of the
+// thread they live in.
+class MpvEventDispatcher : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(MpvEventDispatcher)
+
+public:
+    // The dispatcher of the current thread, created on first use.
+    static MpvEventDispatcher *instance();
+
+    ~MpvEventDispatcher() override;
+
+    // Starts delivering the events of the handle of the core. The events
+    // that are already queued are delivered in the next pass.
+    void registerCore(MpvCore *core);
+    // After this returns, the wakeup callback of the handle is removed and
+    // the core won't be called anymore.
+    void unregisterCore(MpvCore *core);
+
+    // Number of dispatch passes, and of handles drained by them, eg: to
+    // check how well the wakeups are batched.
+    quint64 passes() const;
+    quint64 drains() const;
+
+private:
+    struct Client
+    {
+        MpvEventDispatcher *dispatcher = nullptr;
+        MpvCore *core = nullptr;
+        mpv_handle *mpv = nullptr;
+        // Whether the client is in the ready set already.
+        QAtomicInt queued = 0;
+    };
+
+    explicit MpvEventDispatcher(QObject *parent = nullptr);
+
+    // Called by mpv, from any thread.
+    static void wakeup(void *ctx);
+    void dispatch();
+
+private:
+    QMutex m_mutex;
+    // Guarded by m_mutex, filled by the wakeup callbacks.
+    QVector<Client *> m_ready = {};
+    bool m_scheduled = false;
+
+    QHash<MpvCore *, Client *> m_clients = {};
+    // Unregistered during a pass, deleted once it's over.
+    QVector<Client *> m_retired = {};
+    bool m_dispatching = false;
+    quint64 m_passes = 0;
+    quint64 m_drains = 0;
+};
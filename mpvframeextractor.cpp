@@ -0,0 +1,400 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvframeextractor.h"
+#include "mpvheadlesshandle.h"
+
+#include <QDir>
+#include <QThread>
+#include <algorithm>
+
+struct MpvFrameExtractor::Job
+{
+    QUrl source = QUrl();
+    QString outputDirectory = QString();
+    QString imageFormat = QString();
+    QAtomicInt cancelled = 0;
+    // Only touched on the thread the extractor lives in.
+    int pendingShards = 0;
+};
+
+namespace {
+
+// Don't spin up a whole mpv instance for just a handful of frames.
+const int m_minimumFramesPerShard = 4;
+
+QVariantMap extractorOptions(const QString &imageFormat, const int decoderThreads)
+{
+    return QVariantMap{{QString::fromUtf8("pause"), true},
+                       {QString::fromUtf8("hr-seek"), QString::fromUtf8("yes")},
+                       {QString::fromUtf8("hr-seek-framedrop"), false},
+                       {QString::fromUtf8("aid"), QString::fromUtf8("no")},
+                       {QString::fromUtf8("sid"), QString::fromUtf8("no")},
+                       {QString::fromUtf8("vd-lavc-threads"), decoderThreads},
+                       {QString::fromUtf8("screenshot-format"), imageFormat}};
+}
+
+// "screenshot-raw" returns a map with the picture's size, stride, pixel
+// format and raw data. Only "bgr0" is produced by current mpv versions,
+// which matches QImage::Format_RGB32 on little endian machines.
+QImage imageFromRawScreenshot(const QVariant &screenshot)
+{
+    const QVariantMap map = screenshot.toMap();
+    const int width = map.value(QString::fromUtf8("w")).toInt();
+    const int height = map.value(QString::fromUtf8("h")).toInt();
+    const int stride = map.value(QString::fromUtf8("stride")).toInt();
+    const QByteArray data = map.value(QString::fromUtf8("data")).toByteArray();
+    if ((width <= 0) || (height <= 0) || (stride < (width * 4))
+        || (data.size() < (stride * height))
+        || (map.value(QString::fromUtf8("format")).toString() != QString::fromUtf8("bgr0"))) {
+        return QImage();
+    }
+    return QImage(reinterpret_cast<const uchar *>(data.constData()),
+                  width,
+                  height,
+                  stride,
+                  QImage::Format_RGB32)
+        .copy();
+}
+
+} // namespace
+
+MpvFrameExtractor::MpvFrameExtractor(QObject *parent) : QObject(parent)
+{
+    currentThreadCount = qMax(QThread::idealThreadCount(), 1);
+    m_threadPool.setMaxThreadCount(currentThreadCount);
+}
+
+MpvFrameExtractor::~MpvFrameExtractor()
+{
+    cancel();
+    m_threadPool.waitForDone();
+}
+
+QUrl MpvFrameExtractor::source() const
+{
+    return currentSource;
+}
+
+int MpvFrameExtractor::threadCount() const
+{
+    return currentThreadCount;
+}
+
+QString MpvFrameExtractor::outputDirectory() const
+{
+    return currentOutputDirectory;
+}
+
+QString MpvFrameExtractor::imageFormat() const
+{
+    return currentImageFormat;
+}
+
+bool MpvFrameExtractor::running() const
+{
+    return !m_job.isNull();
+}
+
+int MpvFrameExtractor::frameCount() const
+{
+    return m_frameCount;
+}
+
+int MpvFrameExtractor::extractedCount() const
+{
+    return m_extractedCount;
+}
+
+int MpvFrameExtractor::failedCount() const
+{
+    return m_failedCount;
+}
+
+qreal MpvFrameExtractor::progress() const
+{
+    return (m_frameCount > 0) ? (static_cast<qreal>(m_extractedCount) / m_frameCount) : 0.0;
+}
+
+qreal MpvFrameExtractor::throughput() const
+{
+    const qint64 elapsed = running() ? m_elapsedTimer.elapsed() : m_elapsedTime;
+    return (elapsed > 0) ? (m_extractedCount * 1000.0 / elapsed) : 0.0;
+}
+
+void MpvFrameExtractor::setSource(const QUrl &source)
+{
+    if (source == currentSource) {
+        return;
+    }
+    currentSource = source;
+    Q_EMIT sourceChanged();
+}
+
+void MpvFrameExtractor::setThreadCount(const int threadCount)
+{
+    const int count = qMax(threadCount, 1);
+    if (count == currentThreadCount) {
+        return;
+    }
+    currentThreadCount = count;
+    m_threadPool.setMaxThreadCount(currentThreadCount);
+    Q_EMIT threadCountChanged();
+}
+
+void MpvFrameExtractor::setOutputDirectory(const QString &outputDirectory)
+{
+    if (outputDirectory == currentOutputDirectory) {
+        return;
+    }
+    currentOutputDirectory = outputDirectory;
+    Q_EMIT outputDirectoryChanged();
+}
+
+void MpvFrameExtractor::setImageFormat(const QString &imageFormat)
+{
+    if (imageFormat.isEmpty() || (imageFormat == currentImageFormat)) {
+        return;
+    }
+    currentImageFormat = imageFormat;
+    Q_EMIT imageFormatChanged();
+}
+
+QImage MpvFrameExtractor::frame(const int index) const
+{
+    return m_frames.value(index);
+}
+
+bool MpvFrameExtractor::extract(const QList<qreal> &timestamps)
+{
+    if (timestamps.isEmpty()) {
+        return false;
+    }
+    const QSharedPointer<Job> job = createJob();
+    if (!job) {
+        return false;
+    }
+    dispatch(job, timestamps);
+    return true;
+}
+
+bool MpvFrameExtractor::extractEvery(const qreal interval)
+{
+    if (interval <= 0.0) {
+        return false;
+    }
+    const QSharedPointer<Job> job = createJob();
+    if (!job) {
+        return false;
+    }
+    // We need the duration before the work can be sharded, and opening the
+    // file may take a while (network streams), so probe it in the pool.
+    m_threadPool.start([this, job, interval]() {
+        qreal duration = 0.0;
+        {
+            MpvHeadlessHandle mpv(extractorOptions(job->imageFormat, 1), &job->cancelled);
+            if (mpv.isValid() && mpv.loadFile(job->source)) {
+                duration = mpv.getProperty(QString::fromUtf8("duration")).toReal();
+            }
+        }
+        QMetaObject::invokeMethod(
+            this,
+            [this, job, interval, duration]() {
+                if (job != m_job) {
+                    return;
+                }
+                QList<qreal> timestamps = {};
+                const auto count = static_cast<int>(duration / interval);
+                for (int i = 0; i <= count; ++i) {
+                    const qreal timestamp = i * interval;
+                    if (timestamp < duration) {
+                        timestamps.append(timestamp);
+                    }
+                }
+                if (timestamps.isEmpty() || (job->cancelled.loadAcquire() != 0)) {
+                    finishJob(job);
+                    return;
+                }
+                dispatch(job, timestamps);
+            },
+            Qt::QueuedConnection);
+    });
+    return true;
+}
+
+void MpvFrameExtractor::cancel()
+{
+    if (m_job) {
+        m_job->cancelled.storeRelease(1);
+    }
+}
+
+void MpvFrameExtractor::clear()
+{
+    m_frames.clear();
+}
+
+QSharedPointer<MpvFrameExtractor::Job> MpvFrameExtractor::createJob()
+{
+    if (running() || !currentSource.isValid()) {
+        return {};
+    }
+    if (!currentOutputDirectory.isEmpty() && !QDir().mkpath(currentOutputDirectory)) {
+        return {};
+    }
+    const auto job = QSharedPointer<Job>::create();
+    job->source = currentSource;
+    job->outputDirectory = currentOutputDirectory;
+    job->imageFormat = currentImageFormat;
+    m_job = job;
+    m_frames.clear();
+    m_frameCount = 0;
+    m_extractedCount = 0;
+    m_failedCount = 0;
+    m_elapsedTime = 0;
+    m_elapsedTimer.start();
+    Q_EMIT runningChanged();
+    Q_EMIT frameCountChanged();
+    Q_EMIT progressChanged();
+    Q_EMIT started();
+    return job;
+}
+
+void MpvFrameExtractor::dispatch(const QSharedPointer<Job> &job, const QList<qreal> &timestamps)
+{
+    QVector<Request> requests = {};
+    requests.reserve(timestamps.size());
+    for (int i = 0; i != timestamps.size(); ++i) {
+        requests.append({i, qMax(timestamps.at(i), 0.0)});
+    }
+    // Every shard seeks forward only, which keeps the demuxer work minimal.
+    std::stable_sort(requests.begin(), requests.end(), [](const Request &a, const Request &b) {
+        return a.timestamp < b.timestamp;
+    });
+
+    m_frameCount = static_cast<int>(requests.size());
+    Q_EMIT frameCountChanged();
+    Q_EMIT progressChanged();
+
+    const int shardCount = qBound(1,
+                                  m_frameCount / m_minimumFramesPerShard,
+                                  currentThreadCount);
+    const int shardSize = (m_frameCount + shardCount - 1) / shardCount;
+    // Share the remaining cores between the decoders.
+    const int decoderThreads = qMax(QThread::idealThreadCount() / shardCount, 1);
+    job->pendingShards = 0;
+    for (int begin = 0; begin < m_frameCount; begin += shardSize) {
+        const QVector<Request> shard = requests.mid(begin, shardSize);
+        ++job->pendingShards;
+        m_threadPool.start(
+            [this, job, shard, decoderThreads]() { runShard(job, shard, decoderThreads); });
+    }
+}
+
+void MpvFrameExtractor::runShard(const QSharedPointer<Job> &job,
+                                 const QVector<Request> &shard,
+                                 const int decoderThreads)
+{
+    // Runs in the thread pool.
+    const bool toFile = !job->outputDirectory.isEmpty();
+    MpvHeadlessHandle mpv(extractorOptions(job->imageFormat, decoderThreads), &job->cancelled);
+    const bool loaded = mpv.isValid() && mpv.loadFile(job->source);
+    for (auto &&request : qAsConst(shard)) {
+        if (job->cancelled.loadAcquire() != 0) {
+            break;
+        }
+        QString filePath = QString();
+        QImage image = QImage();
+        bool success = loaded && mpv.seek(request.timestamp);
+        if (success) {
+            if (toFile) {
+                filePath = QDir(job->outputDirectory)
+                               .absoluteFilePath(QString::fromUtf8("frame-%1.%2")
+                                                     .arg(request.index, 6, 10, QChar::fromLatin1('0'))
+                                                     .arg(job->imageFormat));
+                success = mpv.command(QVariantList{QString::fromUtf8("screenshot-to-file"),
+                                                   QDir::toNativeSeparators(filePath),
+                                                   QString::fromUtf8("video")});
+            } else {
+                image = imageFromRawScreenshot(mpv.commandWithResult(
+                    QVariantList{QString::fromUtf8("screenshot-raw"), QString::fromUtf8("video")}));
+                success = !image.isNull();
+            }
+        }
+        QMetaObject::invokeMethod(
+            this,
+            [this, job, request, filePath, image, success]() {
+                handleFrame(job, request, filePath, image, success);
+            },
+            Qt::QueuedConnection);
+    }
+    QMetaObject::invokeMethod(
+        this, [this, job]() { handleShardFinished(job); }, Qt::QueuedConnection);
+}
+
+void MpvFrameExtractor::handleFrame(const QSharedPointer<Job> &job,
+                                    const Request &request,
+                                    const QString &filePath,
+                                    const QImage &image,
+                                    const bool success)
+{
+    if (job != m_job) {
+        return;
+    }
+    ++m_extractedCount;
+    if (!success) {
+        ++m_failedCount;
+        Q_EMIT frameFailed(request.index, request.timestamp);
+    } else if (image.isNull()) {
+        Q_EMIT frameExtracted(request.index, request.timestamp, filePath);
+    } else {
+        m_frames.insert(request.index, image);
+        Q_EMIT frameReady(request.index, request.timestamp, image);
+    }
+    Q_EMIT progressChanged();
+}
+
+void MpvFrameExtractor::handleShardFinished(const QSharedPointer<Job> &job)
+{
+    if (job != m_job) {
+        return;
+    }
+    if (--job->pendingShards <= 0) {
+        finishJob(job);
+    }
+}
+
+void MpvFrameExtractor::finishJob(const QSharedPointer<Job> &job)
+{
+    if (job != m_job) {
+        return;
+    }
+    const bool success = (job->cancelled.loadAcquire() == 0) && (m_failedCount == 0)
+                         && (m_extractedCount == m_frameCount) && (m_frameCount > 0);
+    m_elapsedTime = m_elapsedTimer.elapsed();
+    m_job.reset();
+    Q_EMIT runningChanged();
+    Q_EMIT progressChanged();
+    Q_EMIT finished(success);
+}
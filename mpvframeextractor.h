@@ -0,0 +1,159 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QUrl>
+#include <QtQml/qqml.h>
+
+// Extracts many frames of a single file in one go. The sorted timestamp list
+// is split into contiguous shards, and every shard is handled by its own
+// headless mpv handle on a worker thread, so that each handle only ever
+// seeks forward and the work scales with the number of CPU cores instead of
+// blocking the player that is visible on screen.
+class MpvFrameExtractor : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_DISABLE_COPY_MOVE(MpvFrameExtractor)
+
+    Q_PROPERTY(QUrl source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(int threadCount READ threadCount WRITE setThreadCount NOTIFY threadCountChanged)
+    Q_PROPERTY(QString outputDirectory READ outputDirectory WRITE setOutputDirectory NOTIFY
+                   outputDirectoryChanged)
+    Q_PROPERTY(QString imageFormat READ imageFormat WRITE setImageFormat NOTIFY imageFormatChanged)
+    Q_PROPERTY(bool running READ running NOTIFY runningChanged)
+    Q_PROPERTY(int frameCount READ frameCount NOTIFY frameCountChanged)
+    Q_PROPERTY(int extractedCount READ extractedCount NOTIFY progressChanged)
+    Q_PROPERTY(int failedCount READ failedCount NOTIFY progressChanged)
+    Q_PROPERTY(qreal progress READ progress NOTIFY progressChanged)
+    Q_PROPERTY(qreal throughput READ throughput NOTIFY progressChanged)
+
+public:
+    explicit MpvFrameExtractor(QObject *parent = nullptr);
+    ~MpvFrameExtractor() override;
+
+    // The media file to extract the frames from.
+    QUrl source() const;
+    // How many headless mpv handles can be used in parallel. Defaults to the
+    // number of CPU cores.
+    int threadCount() const;
+    // Where to save the extracted frames. The file names are generated from
+    // the index of the requested timestamp, eg: "frame-000042.png". If it's
+    // empty, the frames are kept in memory and can be retrieved through
+    // frame() or the frameReady() signal instead.
+    QString outputDirectory() const;
+    // Image file type used when saving to disk: "png" (default) or "jpg".
+    QString imageFormat() const;
+    bool running() const;
+    // Number of frames requested by the current (or the last) job.
+    int frameCount() const;
+    // Number of frames that have been processed, including the failed ones.
+    int extractedCount() const;
+    int failedCount() const;
+    // 0.0 - 1.0
+    qreal progress() const;
+    // Extracted frames per second since the job was started.
+    qreal throughput() const;
+
+    void setSource(const QUrl &source);
+    void setThreadCount(const int threadCount);
+    void setOutputDirectory(const QString &outputDirectory);
+    void setImageFormat(const QString &imageFormat);
+
+    // Returns the in-memory frame of the given index (the index of its
+    // timestamp in the list passed to extract()), or a null image if it's not
+    // available (yet).
+    Q_INVOKABLE QImage frame(const int index) const;
+
+public Q_SLOTS:
+    // Extract the frames at the given positions, in seconds. The list doesn't
+    // need to be sorted. Returns false if a job is already running.
+    bool extract(const QList<qreal> &timestamps);
+    // Extract one frame every "interval" seconds, from the beginning to the
+    // end of the file.
+    bool extractEvery(const qreal interval);
+    void cancel();
+    // Release all in-memory frames.
+    void clear();
+
+Q_SIGNALS:
+    void started();
+    void finished(bool success);
+    // Emitted for every frame saved to disk.
+    void frameExtracted(int index, qreal timestamp, const QString &filePath);
+    // Emitted for every frame kept in memory.
+    void frameReady(int index, qreal timestamp, const QImage &image);
+    void frameFailed(int index, qreal timestamp);
+
+    void sourceChanged();
+    void threadCountChanged();
+    void outputDirectoryChanged();
+    void imageFormatChanged();
+    void runningChanged();
+    void frameCountChanged();
+    void progressChanged();
+
+private:
+    struct Job;
+    struct Request
+    {
+        int index = -1;
+        qreal timestamp = 0.0;
+    };
+
+    QSharedPointer<Job> createJob();
+    void dispatch(const QSharedPointer<Job> &job, const QList<qreal> &timestamps);
+    void runShard(const QSharedPointer<Job> &job,
+                  const QVector<Request> &shard,
+                  const int decoderThreads);
+    void handleFrame(const QSharedPointer<Job> &job,
+                     const Request &request,
+                     const QString &filePath,
+                     const QImage &image,
+                     const bool success);
+    void handleShardFinished(const QSharedPointer<Job> &job);
+    void finishJob(const QSharedPointer<Job> &job);
+
+private:
+    QUrl currentSource = QUrl();
+    int currentThreadCount = 1;
+    QString currentOutputDirectory = QString();
+    QString currentImageFormat = QString::fromUtf8("png");
+
+    QThreadPool m_threadPool;
+    QSharedPointer<Job> m_job;
+    QElapsedTimer m_elapsedTimer;
+    qint64 m_elapsedTime = 0;
+    int m_frameCount = 0;
+    int m_extractedCount = 0;
+    int m_failedCount = 0;
+    QHash<int, QImage> m_frames = {};
+};
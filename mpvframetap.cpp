@@ -0,0 +1,344 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvframetap.h"
+
+#include <QAtomicInteger>
+#include <QDeadlineTimer>
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+struct MpvFrameTapSlot
+{
+    std::vector<uchar> data = {};
+    int width = 0;
+    int height = 0;
+    int stride = 0;
+    qreal pts = 0.0;
+    quint64 sequenceNumber = 0;
+    // A slot is either free, being written by the renderer, waiting in the
+    // ready queue or owned by a consumer.
+    bool writing = false;
+    bool queued = false;
+    bool acquired = false;
+};
+
+struct MpvFrameTap::State
+{
+    QMutex mutex;
+    QWaitCondition frameArrived;
+    QVector<MpvFrameTapSlot> ring = {};
+    std::deque<int> readyQueue = {};
+    PixelFormat pixelFormat = PixelFormat::Bgra;
+    QAtomicInt interval = 1;
+    QAtomicInt frameCounter = 0;
+    quint64 sequenceNumber = 0;
+    QAtomicInteger<quint64> deliveredFrames = 0;
+    QAtomicInteger<quint64> droppedFrames = 0;
+};
+
+struct MpvFrameTap::Frame::Handle
+{
+    Q_DISABLE_COPY_MOVE(Handle)
+
+    Handle(const QSharedPointer<MpvFrameTap::State> &state, const int index)
+        : state(state), index(index)
+    {}
+    ~Handle()
+    {
+        QMutexLocker locker(&state->mutex);
+        state->ring[index].acquired = false;
+    }
+
+    QSharedPointer<MpvFrameTap::State> state;
+    int index = -1;
+};
+
+namespace {
+
+// Flips the picture if needed and swaps the R and B channels.
+void convertRgbaToBgra(const uchar *src,
+                       const int width,
+                       const int height,
+                       const bool bottomUp,
+                       uchar *dst)
+{
+    const int stride = width * 4;
+    for (int y = 0; y != height; ++y) {
+        const uchar *srcRow = src + (bottomUp ? (height - 1 - y) : y) * stride;
+        uchar *dstRow = dst + y * stride;
+        for (int x = 0; x != stride; x += 4) {
+            dstRow[x] = srcRow[x + 2];
+            dstRow[x + 1] = srcRow[x + 1];
+            dstRow[x + 2] = srcRow[x];
+            dstRow[x + 3] = srcRow[x + 3];
+        }
+    }
+}
+
+// BT.601 limited range, fixed point. Width and height must be even.
+void convertRgbaToNv12(const uchar *src,
+                       const int width,
+                       const int height,
+                       const bool bottomUp,
+                       uchar *dst)
+{
+    const int srcStride = width * 4;
+    uchar *yPlane = dst;
+    uchar *uvPlane = dst + width * height;
+    for (int y = 0; y != height; ++y) {
+        const uchar *srcRow = src + (bottomUp ? (height - 1 - y) : y) * srcStride;
+        uchar *yRow = yPlane + y * width;
+        for (int x = 0; x != width; ++x) {
+            const int r = srcRow[x * 4];
+            const int g = srcRow[x * 4 + 1];
+            const int b = srcRow[x * 4 + 2];
+            yRow[x] = static_cast<uchar>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        }
+        if ((y % 2) != 0) {
+            continue;
+        }
+        uchar *uvRow = uvPlane + (y / 2) * width;
+        for (int x = 0; x != width; x += 2) {
+            // Subsample from the top left pixel of every 2x2 block, that's
+            // good enough for analysis purposes and a lot cheaper.
+            const int r = srcRow[x * 4];
+            const int g = srcRow[x * 4 + 1];
+            const int b = srcRow[x * 4 + 2];
+            uvRow[x] = static_cast<uchar>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            uvRow[x + 1] = static_cast<uchar>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
+
+} // namespace
+
+bool MpvFrameTap::Frame::isValid() const
+{
+    return !d.isNull();
+}
+
+MpvFrameTap::PixelFormat MpvFrameTap::Frame::pixelFormat() const
+{
+    return d ? d->state->pixelFormat : PixelFormat::Bgra;
+}
+
+int MpvFrameTap::Frame::width() const
+{
+    return d ? d->state->ring.at(d->index).width : 0;
+}
+
+int MpvFrameTap::Frame::height() const
+{
+    return d ? d->state->ring.at(d->index).height : 0;
+}
+
+int MpvFrameTap::Frame::stride() const
+{
+    return d ? d->state->ring.at(d->index).stride : 0;
+}
+
+const uchar *MpvFrameTap::Frame::constData() const
+{
+    return d ? d->state->ring.at(d->index).data.data() : nullptr;
+}
+
+int MpvFrameTap::Frame::byteCount() const
+{
+    return d ? static_cast<int>(d->state->ring.at(d->index).data.size()) : 0;
+}
+
+qreal MpvFrameTap::Frame::pts() const
+{
+    return d ? d->state->ring.at(d->index).pts : 0.0;
+}
+
+quint64 MpvFrameTap::Frame::sequenceNumber() const
+{
+    return d ? d->state->ring.at(d->index).sequenceNumber : 0;
+}
+
+MpvFrameTap::MpvFrameTap(const PixelFormat pixelFormat, const int capacity, const int interval)
+    : d(QSharedPointer<State>::create())
+{
+    d->pixelFormat = pixelFormat;
+    d->ring.resize(qMax(capacity, 1));
+    d->interval.storeRelaxed(qMax(interval, 1));
+}
+
+MpvFrameTap::~MpvFrameTap() = default;
+
+MpvFrameTap::PixelFormat MpvFrameTap::pixelFormat() const
+{
+    return d->pixelFormat;
+}
+
+int MpvFrameTap::capacity() const
+{
+    return d->ring.size();
+}
+
+int MpvFrameTap::interval() const
+{
+    return d->interval.loadRelaxed();
+}
+
+void MpvFrameTap::setInterval(const int interval)
+{
+    d->interval.storeRelaxed(qMax(interval, 1));
+}
+
+MpvFrameTap::Frame MpvFrameTap::tryAcquireFrame()
+{
+    return waitForFrame(0);
+}
+
+MpvFrameTap::Frame MpvFrameTap::waitForFrame(const int timeout)
+{
+    Frame frame;
+    QMutexLocker locker(&d->mutex);
+    if (d->readyQueue.empty() && (timeout != 0)) {
+        const QDeadlineTimer deadline = (timeout < 0) ? QDeadlineTimer(QDeadlineTimer::Forever)
+                                                      : QDeadlineTimer(timeout);
+        while (d->readyQueue.empty()) {
+            if (!d->frameArrived.wait(&d->mutex, deadline)) {
+                break;
+            }
+        }
+    }
+    if (d->readyQueue.empty()) {
+        return frame;
+    }
+    const int index = d->readyQueue.front();
+    d->readyQueue.pop_front();
+    MpvFrameTapSlot &slot = d->ring[index];
+    slot.queued = false;
+    slot.acquired = true;
+    frame.d = QSharedPointer<Frame::Handle>::create(d, index);
+    return frame;
+}
+
+quint64 MpvFrameTap::deliveredFrames() const
+{
+    return d->deliveredFrames.loadRelaxed();
+}
+
+quint64 MpvFrameTap::droppedFrames() const
+{
+    return d->droppedFrames.loadRelaxed();
+}
+
+bool MpvFrameTap::wantsFrame()
+{
+    return (d->frameCounter.fetchAndAddRelaxed(1) % d->interval.loadRelaxed()) == 0;
+}
+
+void MpvFrameTap::pushRgbaFrame(const uchar *pixels,
+                                const int width,
+                                const int height,
+                                const bool bottomUp,
+                                const qreal pts)
+{
+    if (!pixels || (width <= 0) || (height <= 0)) {
+        return;
+    }
+    const bool nv12 = (d->pixelFormat == PixelFormat::Nv12);
+    const int frameWidth = nv12 ? (width & ~1) : width;
+    const int frameHeight = nv12 ? (height & ~1) : height;
+    if ((frameWidth <= 0) || (frameHeight <= 0)) {
+        return;
+    }
+    const int stride = nv12 ? frameWidth : (frameWidth * 4);
+    const auto byteCount = static_cast<size_t>(nv12 ? (stride * frameHeight * 3 / 2)
+                                                    : (stride * frameHeight));
+
+    int index = -1;
+    quint64 sequenceNumber = 0;
+    {
+        QMutexLocker locker(&d->mutex);
+        sequenceNumber = ++d->sequenceNumber;
+        for (int i = 0; i != d->ring.size(); ++i) {
+            const MpvFrameTapSlot &slot = d->ring.at(i);
+            if (!slot.writing && !slot.queued && !slot.acquired) {
+                index = i;
+                break;
+            }
+        }
+        if ((index < 0) && !d->readyQueue.empty()) {
+            // The consumer is lagging behind, recycle its oldest frame.
+            index = d->readyQueue.front();
+            d->readyQueue.pop_front();
+            d->ring[index].queued = false;
+            d->droppedFrames.fetchAndAddRelaxed(1);
+        }
+        if (index < 0) {
+            // Every buffer is held by the consumer, drop this one.
+            d->droppedFrames.fetchAndAddRelaxed(1);
+            return;
+        }
+        d->ring[index].writing = true;
+    }
+
+    // Nobody else touches a slot while it's being written, so the expensive
+    // part happens without holding the lock.
+    MpvFrameTapSlot &slot = d->ring[index];
+    if (slot.data.size() != byteCount) {
+        slot.data.resize(byteCount);
+    }
+    if (nv12) {
+        // Cropping to even sizes only drops the last row/column.
+        if ((frameWidth != width) || (frameHeight != height)) {
+            std::vector<uchar> cropped(static_cast<size_t>(frameWidth) * frameHeight * 4);
+            for (int y = 0; y != frameHeight; ++y) {
+                const int srcY = bottomUp ? (y + height - frameHeight) : y;
+                std::memcpy(cropped.data() + y * frameWidth * 4,
+                            pixels + srcY * width * 4,
+                            static_cast<size_t>(frameWidth) * 4);
+            }
+            convertRgbaToNv12(cropped.data(), frameWidth, frameHeight, bottomUp, slot.data.data());
+        } else {
+            convertRgbaToNv12(pixels, frameWidth, frameHeight, bottomUp, slot.data.data());
+        }
+    } else {
+        convertRgbaToBgra(pixels, frameWidth, frameHeight, bottomUp, slot.data.data());
+    }
+    slot.width = frameWidth;
+    slot.height = frameHeight;
+    slot.stride = stride;
+    slot.pts = pts;
+    slot.sequenceNumber = sequenceNumber;
+
+    {
+        QMutexLocker locker(&d->mutex);
+        slot.writing = false;
+        slot.queued = true;
+        d->readyQueue.push_back(index);
+    }
+    d->deliveredFrames.fetchAndAddRelaxed(1);
+    d->frameArrived.wakeAll();
+}
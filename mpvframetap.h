@@ -0,0 +1,131 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <QSharedPointer>
+
+// Delivers copies of the frames rendered by a MpvObject to C++ code running
+// on any thread. The frames are stored in a fixed ring of buffers which is
+// only (re)allocated when the video size changes. If the consumer is too
+// slow and the ring is full, the oldest pending frame is dropped: the
+// renderer never waits for the consumer.
+//
+// These are the frames as rendered into the item, not as decoded: they are
+// scaled to the item's size (times its render scale), with subtitles, OSD
+// and video filters applied. Since they come from the render loop, nothing
+// is delivered while the item isn't rendering, eg: when it's hidden or its
+// window is minimized. The GPU readback is asynchronous, so a frame arrives
+// one tapped frame after it has been rendered.
+//
+// Usage:
+//     auto tap = QSharedPointer<MpvFrameTap>::create(MpvFrameTap::PixelFormat::Nv12);
+//     mpvObject->setFrameTap(tap);
+//     // On a worker thread:
+//     while (running) {
+//         const MpvFrameTap::Frame frame = tap->waitForFrame(100);
+//         if (frame.isValid()) {
+//             analyze(frame.constData(), frame.width(), frame.height(), frame.pts());
+//         }
+//     }
+class MpvFrameTap
+{
+    Q_DISABLE_COPY_MOVE(MpvFrameTap)
+
+    struct State;
+
+public:
+    enum class PixelFormat {
+        // 4 bytes per pixel: B, G, R, A.
+        Bgra,
+        // Full resolution Y plane followed by a half resolution interleaved
+        // UV plane (BT.601, limited range). Odd sizes are cropped to even.
+        Nv12
+    };
+
+    // A reference to one buffer of the ring. The buffer is handed back to
+    // the ring once the last copy of the Frame is destroyed, so don't hold
+    // on to it longer than necessary.
+    class Frame
+    {
+    public:
+        Frame() = default;
+
+        bool isValid() const;
+        PixelFormat pixelFormat() const;
+        int width() const;
+        int height() const;
+        // Bytes per row. For NV12, the UV plane uses the same stride and
+        // starts right after the Y plane.
+        int stride() const;
+        const uchar *constData() const;
+        int byteCount() const;
+        // Playback position of the frame, in seconds.
+        qreal pts() const;
+        // Increases by one for every frame offered to the tap, so gaps tell
+        // how many frames have been dropped in between.
+        quint64 sequenceNumber() const;
+
+    private:
+        friend class MpvFrameTap;
+        struct Handle;
+        QSharedPointer<Handle> d;
+    };
+
+    explicit MpvFrameTap(const PixelFormat pixelFormat = PixelFormat::Bgra,
+                         const int capacity = 4,
+                         const int interval = 1);
+    ~MpvFrameTap();
+
+    PixelFormat pixelFormat() const;
+    // Number of buffers in the ring.
+    int capacity() const;
+    // Only every n-th rendered frame is delivered.
+    int interval() const;
+    void setInterval(const int interval);
+
+    // Takes the oldest pending frame, or returns an invalid frame if there
+    // is none.
+    Frame tryAcquireFrame();
+    // Same as tryAcquireFrame(), but waits up to "timeout" milliseconds (or
+    // forever if it's negative) for a frame to arrive.
+    Frame waitForFrame(const int timeout = -1);
+
+    quint64 deliveredFrames() const;
+    quint64 droppedFrames() const;
+
+    // Called by the renderer for every rendered frame. Returns whether the
+    // next frame should be read back at all.
+    bool wantsFrame();
+    // Called by the renderer with the RGBA pixels read back from the GPU.
+    // The conversion to the tap's pixel format happens in here.
+    void pushRgbaFrame(const uchar *pixels,
+                       const int width,
+                       const int height,
+                       const bool bottomUp,
+                       const qreal pts);
+
+private:
+    QSharedPointer<State> d;
+};
@@ -0,0 +1,317 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvhandlepool.h"
+#include "mpvobject.h"
+#include "mpvstreamprotocol.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QJSEngine>
+#include <QPointer>
+
+Q_LOGGING_CATEGORY(lcMpvPool, "libmpv.pool.general")
+
+namespace {
+
+// Applied to every handle before mpv_initialize(), and restored on reset.
+QVariantMap baseOptions()
+{
+    return QVariantMap{{QString::fromUtf8("input-default-bindings"), false},
+                       {QString::fromUtf8("input-vo-keyboard"), false},
+                       {QString::fromUtf8("input-cursor"), false},
+                       {QString::fromUtf8("cursor-autohide"), false},
+                       // Smooth transitions between the items of a playlist.
+                       {QString::fromUtf8("gapless-audio"), QString::fromUtf8("yes")},
+                       {QString::fromUtf8("prefetch-playlist"), true}};
+}
+
+// A reset handle is considered clean once no event has arrived for this
+// long, in seconds.
+const double m_quietPeriod = 0.05;
+
+} // namespace
+
+MpvHandlePool *MpvHandlePool::instance()
+{
+    static QPointer<MpvHandlePool> pool;
+    if (!pool && QCoreApplication::instance() && !QCoreApplication::closingDown()) {
+        // Deleted together with the application object.
+        pool = new MpvHandlePool(QCoreApplication::instance());
+    }
+    return pool;
+}
+
+MpvHandlePool *MpvHandlePool::create(QQmlEngine *qmlEngine, QJSEngine *jsEngine)
+{
+    Q_UNUSED(qmlEngine)
+    Q_UNUSED(jsEngine)
+    MpvHandlePool *pool = instance();
+    QJSEngine::setObjectOwnership(pool, QJSEngine::CppOwnership);
+    return pool;
+}
+
+MpvHandlePool::MpvHandlePool(QObject *parent) : QObject(parent)
+{
+    // Loading libmpv is left to createHandle(), so that it happens in the
+    // background as well.
+    m_threadPool.setMaxThreadCount(2);
+    refill();
+}
+
+MpvHandlePool::~MpvHandlePool()
+{
+    m_threadPool.waitForDone();
+    QMutexLocker locker(&m_mutex);
+    for (auto &&mpv : qAsConst(m_handles)) {
+        mpv::qt::terminate_destroy(mpv);
+    }
+    m_handles.clear();
+}
+
+int MpvHandlePool::capacity() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_capacity;
+}
+
+int MpvHandlePool::available() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_handles.size();
+}
+
+int MpvHandlePool::hits() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+int MpvHandlePool::misses() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
+
+qreal MpvHandlePool::hitRate() const
+{
+    QMutexLocker locker(&m_mutex);
+    const int total = m_hits + m_misses;
+    return (total > 0) ? (static_cast<qreal>(m_hits) / total) : 0.0;
+}
+
+void MpvHandlePool::setCapacity(const int capacity)
+{
+    QVector<mpv_handle *> surplus = {};
+    {
+        QMutexLocker locker(&m_mutex);
+        const int newCapacity = qMax(capacity, 0);
+        if (newCapacity == m_capacity) {
+            return;
+        }
+        m_capacity = newCapacity;
+        while (m_handles.size() > m_capacity) {
+            surplus.append(m_handles.takeLast());
+        }
+    }
+    if (!surplus.isEmpty()) {
+        m_threadPool.start([surplus]() {
+            for (auto &&mpv : qAsConst(surplus)) {
+                mpv::qt::terminate_destroy(mpv);
+            }
+        });
+    }
+    Q_EMIT capacityChanged();
+    notifyStatisticsChanged();
+    refill();
+}
+
+mpv_handle *MpvHandlePool::acquire()
+{
+    mpv_handle *mpv = nullptr;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_handles.isEmpty()) {
+            mpv = m_handles.takeLast();
+            ++m_hits;
+        } else {
+            ++m_misses;
+        }
+    }
+    if (!mpv) {
+        qCDebug(lcMpvPool) << "The pool is empty, creating a new handle synchronously.";
+        mpv = createHandle();
+    }
+    notifyStatisticsChanged();
+    refill();
+    return mpv;
+}
+
+void MpvHandlePool::release(mpv_handle *mpv, const QSet<QString> &changedOptions)
+{
+    if (!mpv) {
+        return;
+    }
+    // The owner is about to be destroyed.
+    mpv::qt::set_wakeup_callback(mpv, nullptr, nullptr);
+    bool keep = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        keep = ((m_handles.size() + m_pending) < m_capacity);
+        if (keep) {
+            ++m_pending;
+        }
+    }
+    if (!keep) {
+        // mpv_terminate_destroy() waits for the playback to stop.
+        m_threadPool.start([mpv]() { mpv::qt::terminate_destroy(mpv); });
+        return;
+    }
+    m_threadPool.start([this, mpv, changedOptions]() {
+        resetHandle(mpv, changedOptions);
+        bool stored = false;
+        {
+            QMutexLocker locker(&m_mutex);
+            --m_pending;
+            if (m_handles.size() < m_capacity) {
+                m_handles.append(mpv);
+                stored = true;
+            }
+        }
+        if (!stored) {
+            mpv::qt::terminate_destroy(mpv);
+        }
+        notifyStatisticsChanged();
+    });
+}
+
+QHash<QString, mpv_format> MpvHandlePool::observedProperties()
+{
+    static const QHash<QString, mpv_format> properties = []() {
+        QHash<QString, mpv_format> result = {};
+        auto iterator = MpvObject::properties.cbegin();
+        while (iterator != MpvObject::properties.cend()) {
+            result.insert(iterator.key(),
+                          MpvObject::propertyFormats.value(iterator.key(), MPV_FORMAT_NONE));
+            ++iterator;
+        }
+        return result;
+    }();
+    return properties;
+}
+
+mpv_handle *MpvHandlePool::createHandle()
+{
+    mpv::qt::libmpv_init(mpv::qt::libmpv_path());
+
+    mpv_handle *mpv = mpv::qt::create();
+    if (!mpv) {
+        qCWarning(lcMpvPool) << "Failed to create a mpv handle.";
+        return nullptr;
+    }
+
+    // So that "qrc:" URLs and in-memory media can be played.
+    MpvStreamProtocol::install(mpv);
+
+    const QVariantMap options = baseOptions();
+    auto optionIterator = options.cbegin();
+    while (optionIterator != options.cend()) {
+        mpv::qt::set_property(mpv, optionIterator.key(), optionIterator.value());
+        ++optionIterator;
+    }
+
+    const QHash<QString, mpv_format> properties = observedProperties();
+    auto propertyIterator = properties.cbegin();
+    while (propertyIterator != properties.cend()) {
+        if (mpv::qt::observe_property(mpv, propertyIterator.key(), 0, propertyIterator.value())
+            < 0) {
+            qCWarning(lcMpvPool) << "Failed to observe property" << propertyIterator.key();
+        }
+        ++propertyIterator;
+    }
+
+    const int mpvInitResult = mpv::qt::initialize(mpv);
+    if (mpvInitResult < 0) {
+        qCWarning(lcMpvPool).noquote()
+            << "Failed to initialize the mpv handle:" << mpv::qt::error_string(mpvInitResult);
+        mpv::qt::terminate_destroy(mpv);
+        return nullptr;
+    }
+    return mpv;
+}
+
+void MpvHandlePool::resetHandle(mpv_handle *mpv, const QSet<QString> &changedOptions)
+{
+    // Runs in the thread pool.
+    mpv::qt::command(mpv, QVariantList{QString::fromUtf8("stop")});
+    const QVariantMap options = baseOptions();
+    for (auto &&name : qAsConst(changedOptions)) {
+        if (options.contains(name)) {
+            mpv::qt::set_property(mpv, name, options.value(name));
+            continue;
+        }
+        const QVariant defaultValue = mpv::qt::get_property(
+            mpv, QString::fromUtf8("option-info/%1/default-value").arg(name));
+        // Properties that are not options (eg: "time-pos") have no default
+        // value, there's nothing to restore for them anyway.
+        if (mpv::qt::is_error(defaultValue) || !defaultValue.isValid()) {
+            continue;
+        }
+        mpv::qt::set_property(mpv, name, defaultValue);
+    }
+    mpv::qt::request_log_messages(mpv, QString::fromUtf8("no"));
+    // Throw away everything the old owner would have received, including
+    // the notifications caused by the reset itself.
+    while (mpv::qt::wait_event(mpv, m_quietPeriod)->event_id != MPV_EVENT_NONE) {
+    }
+}
+
+void MpvHandlePool::refill()
+{
+    QMutexLocker locker(&m_mutex);
+    while ((m_handles.size() + m_pending) < m_capacity) {
+        ++m_pending;
+        m_threadPool.start([this]() {
+            mpv_handle *mpv = createHandle();
+            {
+                QMutexLocker locker(&m_mutex);
+                --m_pending;
+                if (mpv && (m_handles.size() < m_capacity)) {
+                    m_handles.append(mpv);
+                    mpv = nullptr;
+                }
+            }
+            if (mpv) {
+                mpv::qt::terminate_destroy(mpv);
+            }
+            notifyStatisticsChanged();
+        });
+    }
+}
+
+void MpvHandlePool::notifyStatisticsChanged()
+{
+    // May be called from any thread.
+    QMetaObject::invokeMethod(this, &MpvHandlePool::statisticsChanged, Qt::QueuedConnection);
+}
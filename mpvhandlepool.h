@@ -0,0 +1,139 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+// Don't use any deprecated APIs from MPV.
+#ifdef MPV_ENABLE_DEPRECATED
+#undef MPV_ENABLE_DEPRECATED
+#endif
+
+#define MPV_ENABLE_DEPRECATED 0
+
+#include "mpvqthelper.hpp"
+#include <QHash>
+#include <QLoggingCategory>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QThreadPool>
+#include <QVector>
+#include <QtQml/qqml.h>
+
+Q_DECLARE_LOGGING_CATEGORY(lcMpvPool)
+
+QT_BEGIN_NAMESPACE
+class QQmlEngine;
+class QJSEngine;
+QT_END_NAMESPACE
+
+// Process-wide pool of initialized mpv handles, so that creating a MpvObject
+// (eg: in a ListView delegate) doesn't have to pay for mpv_create(),
+// mpv_initialize() and the property observations on the GUI thread. Handles
+// are created, reset and destroyed on a background thread: a returned
+// handle is stopped and every option its owner changed is restored to its
+// default value before it can be handed out again.
+//
+// The pool starts warming up as soon as it's first used. Call
+// MpvHandlePool::instance() early in main() to have handles ready before
+// the first player is created.
+//
+// Render contexts are not pooled: they belong to the OpenGL context of the
+// window the player is shown in, and have to be created and freed on its
+// render thread.
+class MpvHandlePool : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
+    Q_DISABLE_COPY_MOVE(MpvHandlePool)
+
+    Q_PROPERTY(int capacity READ capacity WRITE setCapacity NOTIFY capacityChanged)
+    Q_PROPERTY(int available READ available NOTIFY statisticsChanged)
+    Q_PROPERTY(int hits READ hits NOTIFY statisticsChanged)
+    Q_PROPERTY(int misses READ misses NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal hitRate READ hitRate NOTIFY statisticsChanged)
+
+public:
+    // Returns null once the application is shutting down.
+    static MpvHandlePool *instance();
+    static MpvHandlePool *create(QQmlEngine *qmlEngine, QJSEngine *jsEngine);
+
+    ~MpvHandlePool() override;
+
+    // How many idle handles are kept ready. Defaults to 2, 0 disables the
+    // pool.
+    int capacity() const;
+    // Idle handles that are ready to be handed out right now.
+    int available() const;
+    // Number of acquire() calls that got a pooled handle.
+    int hits() const;
+    // Number of acquire() calls that had to create a handle synchronously.
+    int misses() const;
+    // 0.0 - 1.0
+    qreal hitRate() const;
+
+    void setCapacity(const int capacity);
+
+    // Returns an initialized handle, never blocks on mpv_initialize() unless
+    // the pool is empty. Thread-safe.
+    mpv_handle *acquire();
+    // Gives the handle back to the pool. "changedOptions" are the names of
+    // the options/properties the owner has changed, they are restored to
+    // their defaults. The wakeup callback is removed before this returns, so
+    // the owner can be destroyed right away. Thread-safe.
+    void release(mpv_handle *mpv, const QSet<QString> &changedOptions);
+
+    // The properties every handle observes, and the format their value is
+    // sent along with the change notifications in (MPV_FORMAT_NONE if it
+    // isn't).
+    static QHash<QString, mpv_format> observedProperties();
+
+    // Creates a handle with the options and observations MpvObject needs,
+    // bypassing the pool.
+    static mpv_handle *createHandle();
+
+Q_SIGNALS:
+    void capacityChanged();
+    void statisticsChanged();
+
+private:
+    explicit MpvHandlePool(QObject *parent = nullptr);
+
+    // Brings a used handle back to the state createHandle() left it in.
+    static void resetHandle(mpv_handle *mpv, const QSet<QString> &changedOptions);
+
+    void refill();
+    void notifyStatisticsChanged();
+
+private:
+    mutable QMutex m_mutex;
+    QVector<mpv_handle *> m_handles = {};
+    int m_capacity = 2;
+    // Handles that are being created or reset in the background.
+    int m_pending = 0;
+    int m_hits = 0;
+    int m_misses = 0;
+    QThreadPool m_threadPool;
+};
@@ -0,0 +1,235 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvheadlesshandle.h"
+#include "mpvstreamprotocol.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+
+Q_LOGGING_CATEGORY(lcMpvHeadless, "libmpv.headless.general")
+
+namespace {
+
+// How long a single mpv_wait_event() call may block, in seconds. Keep it
+// short so that cancellation requests are honored quickly.
+const double m_waitEventInterval = 0.05;
+
+QVariantMap defaultOptions()
+{
+    return QVariantMap{{QString::fromUtf8("vo"), QString::fromUtf8("null")},
+                       {QString::fromUtf8("ao"), QString::fromUtf8("null")},
+                       {QString::fromUtf8("config"), false},
+                       {QString::fromUtf8("terminal"), false},
+                       {QString::fromUtf8("load-scripts"), false},
+                       {QString::fromUtf8("ytdl"), false},
+                       {QString::fromUtf8("input-default-bindings"), false},
+                       {QString::fromUtf8("input-vo-keyboard"), false},
+                       {QString::fromUtf8("idle"), true},
+                       {QString::fromUtf8("keep-open"), QString::fromUtf8("always")}};
+}
+
+} // namespace
+
+MpvHeadlessHandle::MpvHeadlessHandle(const QVariantMap &options, const QAtomicInt *cancelled)
+    : m_cancelled(cancelled)
+{
+    mpv::qt::libmpv_init(mpv::qt::libmpv_path());
+
+    m_mpv = mpv::qt::create();
+    if (!m_mpv) {
+        qCWarning(lcMpvHeadless) << "Failed to create a headless mpv handle.";
+        return;
+    }
+    MpvStreamProtocol::install(m_mpv);
+
+    QVariantMap allOptions = defaultOptions();
+    auto iterator = options.cbegin();
+    while (iterator != options.cend()) {
+        allOptions.insert(iterator.key(), iterator.value());
+        ++iterator;
+    }
+    iterator = allOptions.cbegin();
+    while (iterator != allOptions.cend()) {
+        setProperty(iterator.key(), iterator.value());
+        ++iterator;
+    }
+
+    const int mpvInitResult = mpv::qt::initialize(m_mpv);
+    if (mpvInitResult < 0) {
+        qCWarning(lcMpvHeadless).noquote() << "Failed to initialize the headless mpv handle:"
+                                           << mpv::qt::error_string(mpvInitResult);
+        mpv::qt::terminate_destroy(m_mpv);
+        m_mpv = nullptr;
+    }
+}
+
+MpvHeadlessHandle::~MpvHeadlessHandle()
+{
+    if (m_mpv) {
+        mpv::qt::terminate_destroy(m_mpv);
+    }
+}
+
+bool MpvHeadlessHandle::isValid() const
+{
+    return m_mpv;
+}
+
+bool MpvHeadlessHandle::isCancelled() const
+{
+    return m_cancelled && (m_cancelled->loadAcquire() != 0);
+}
+
+mpv_handle *MpvHeadlessHandle::handle() const
+{
+    return m_mpv;
+}
+
+bool MpvHeadlessHandle::command(const QVariant &arguments)
+{
+    bool ok = false;
+    commandWithResult(arguments, &ok);
+    return ok;
+}
+
+QVariant MpvHeadlessHandle::commandWithResult(const QVariant &arguments, bool *ok)
+{
+    if (ok) {
+        *ok = false;
+    }
+    if (!m_mpv || arguments.isNull() || !arguments.isValid()) {
+        return QVariant();
+    }
+    const QVariant result = mpv::qt::command(m_mpv, arguments);
+    const int errorCode = mpv::qt::get_error(result);
+    if (errorCode < 0) {
+        qCWarning(lcMpvHeadless).noquote()
+            << "Failed to send command" << arguments << ':' << mpv::qt::error_string(errorCode);
+        return QVariant();
+    }
+    if (ok) {
+        *ok = true;
+    }
+    return result;
+}
+
+bool MpvHeadlessHandle::setProperty(const QString &name, const QVariant &value)
+{
+    if (!m_mpv || name.isEmpty() || value.isNull() || !value.isValid()) {
+        return false;
+    }
+    const int errorCode = mpv::qt::set_property(m_mpv, name, value);
+    if (errorCode < 0) {
+        qCWarning(lcMpvHeadless).noquote() << "Failed to change property" << name << "to" << value
+                                           << ':' << mpv::qt::error_string(errorCode);
+    }
+    return (errorCode >= 0);
+}
+
+QVariant MpvHeadlessHandle::getProperty(const QString &name, bool *ok) const
+{
+    if (ok) {
+        *ok = false;
+    }
+    if (!m_mpv || name.isEmpty()) {
+        return QVariant();
+    }
+    const QVariant result = mpv::qt::get_property(m_mpv, name);
+    if (mpv::qt::is_error(result) || !result.isValid()) {
+        return QVariant();
+    }
+    if (ok) {
+        *ok = true;
+    }
+    return result;
+}
+
+bool MpvHeadlessHandle::loadFile(const QUrl &url, const int timeout)
+{
+    if (!m_mpv || !url.isValid()) {
+        return false;
+    }
+    const bool result = command(
+        QVariantList{QString::fromUtf8("loadfile"),
+                     url.isLocalFile() ? QDir::toNativeSeparators(url.toLocalFile()) : url.url()});
+    if (!result) {
+        return false;
+    }
+    // Wait for the initial playback restart as well, otherwise it would be
+    // mistaken for the completion of the first seek request.
+    return waitForEvent(MPV_EVENT_FILE_LOADED, timeout)
+           && waitForEvent(MPV_EVENT_PLAYBACK_RESTART, timeout);
+}
+
+bool MpvHeadlessHandle::seek(const qreal position, const bool exact, const int timeout)
+{
+    if (!m_mpv) {
+        return false;
+    }
+    const bool result = command(QVariantList{QString::fromUtf8("seek"),
+                                             qMax(position, 0.0),
+                                             exact ? QString::fromUtf8("absolute+exact")
+                                                   : QString::fromUtf8("absolute+keyframes")});
+    return result && waitForEvent(MPV_EVENT_PLAYBACK_RESTART, timeout);
+}
+
+bool MpvHeadlessHandle::waitForEvent(const mpv_event_id id, const int timeout)
+{
+    if (!m_mpv) {
+        return false;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    while (!isCancelled() && (timer.elapsed() < timeout)) {
+        const auto event = mpv::qt::wait_event(m_mpv, m_waitEventInterval);
+        if (event->event_id == id) {
+            return true;
+        }
+        switch (event->event_id) {
+        case MPV_EVENT_SHUTDOWN:
+            return false;
+        case MPV_EVENT_END_FILE: {
+            const auto e = static_cast<mpv_event_end_file *>(event->data);
+            if (e->reason == MPV_END_FILE_REASON_ERROR) {
+                qCWarning(lcMpvHeadless).noquote()
+                    << "Failed to play the file:" << mpv::qt::error_string(e->error);
+            }
+            return false;
+        }
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+mpv_event *MpvHeadlessHandle::pollEvent(const int timeout)
+{
+    if (!m_mpv) {
+        return nullptr;
+    }
+    return mpv::qt::wait_event(m_mpv, static_cast<double>(qMax(timeout, 0)) / 1000.0);
+}
@@ -0,0 +1,86 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+// Don't use any deprecated APIs from MPV.
+#ifdef MPV_ENABLE_DEPRECATED
+#undef MPV_ENABLE_DEPRECATED
+#endif
+
+#define MPV_ENABLE_DEPRECATED 0
+
+#include "mpvqthelper.hpp"
+#include <QAtomicInt>
+#include <QLoggingCategory>
+#include <QUrl>
+
+Q_DECLARE_LOGGING_CATEGORY(lcMpvHeadless)
+
+// A GUI-less mpv handle that is driven synchronously. It never installs a
+// wakeup callback, the owner pumps the event queue itself by blocking in
+// waitForEvent(), so it is meant to be used from worker threads only (frame
+// extraction, audio analysis, indexing, etc). Never use it on the GUI thread.
+class MpvHeadlessHandle
+{
+    Q_DISABLE_COPY_MOVE(MpvHeadlessHandle)
+
+public:
+    // The given options are applied before mpv_initialize(), on top of a
+    // minimal set of defaults (no video/audio output, no scripts, no config
+    // files, no input handling). "cancelled" is polled while waiting for
+    // events, a non-zero value aborts the current wait as soon as possible.
+    explicit MpvHeadlessHandle(const QVariantMap &options = {},
+                               const QAtomicInt *cancelled = nullptr);
+    ~MpvHeadlessHandle();
+
+    bool isValid() const;
+    bool isCancelled() const;
+    mpv_handle *handle() const;
+
+    bool command(const QVariant &arguments);
+    QVariant commandWithResult(const QVariant &arguments, bool *ok = nullptr);
+    bool setProperty(const QString &name, const QVariant &value);
+    QVariant getProperty(const QString &name, bool *ok = nullptr) const;
+
+    // Loads the given url and blocks until the first frame after loading is
+    // ready (MPV_EVENT_PLAYBACK_RESTART). Returns false on errors, timeouts
+    // and cancellation.
+    bool loadFile(const QUrl &url, const int timeout = 30000);
+    // Seeks to an absolute position, in seconds, and blocks until playback
+    // has been restarted at the new position.
+    bool seek(const qreal position, const bool exact = true, const int timeout = 30000);
+    // Blocks until the given event is received. Returns false if the file
+    // ended (unless that's what we are waiting for), the player is shutting
+    // down, the timeout (in milliseconds) expires or the job is cancelled.
+    bool waitForEvent(const mpv_event_id id, const int timeout);
+    // Returns the next event, waiting up to "timeout" milliseconds for it
+    // (MPV_EVENT_NONE if there is none). For callers that need to interleave
+    // the event queue with other blocking work.
+    mpv_event *pollEvent(const int timeout = 0);
+
+private:
+    mpv_handle *m_mpv = nullptr;
+    const QAtomicInt *m_cancelled = nullptr;
+};
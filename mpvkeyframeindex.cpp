@@ -0,0 +1,394 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvkeyframeindex.h"
+#include "mpvheadlesshandle.h"
+#include "mpvmediacache.h"
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <algorithm>
+
+struct MpvKeyframeIndex::Job
+{
+    QUrl source = QUrl();
+    bool cacheEnabled = true;
+    QAtomicInt cancelled = 0;
+};
+
+namespace {
+
+const QString m_cacheSuffix = QString::fromUtf8("keyframes");
+const quint32 m_cacheFormatVersion = 1;
+
+// A relative keyframe seek by a positive amount goes to the first keyframe
+// after the target, so this finds the one right after the current one.
+const qreal m_seekStep = 0.001;
+const int m_seekTimeout = 30000;
+const int m_progressInterval = 250;
+
+QVariantMap indexOptions()
+{
+    return QVariantMap{{QString::fromUtf8("aid"), QString::fromUtf8("no")},
+                       {QString::fromUtf8("sid"), QString::fromUtf8("no")},
+                       {QString::fromUtf8("pause"), true},
+                       {QString::fromUtf8("hr-seek"), QString::fromUtf8("no")},
+                       {QString::fromUtf8("hwdec"), QString::fromUtf8("no")},
+                       // Nothing but the keyframe we land on is decoded, and
+                       // nobody looks at it.
+                       {QString::fromUtf8("vd-lavc-skipframe"), QString::fromUtf8("nonkey")},
+                       {QString::fromUtf8("vd-lavc-skiploopfilter"), QString::fromUtf8("all")},
+                       {QString::fromUtf8("vd-lavc-fast"), true},
+                       {QString::fromUtf8("vd-lavc-threads"), 1},
+                       // Reading ahead is wasted on every seek, and makes the
+                       // byte offsets less accurate.
+                       {QString::fromUtf8("cache"), QString::fromUtf8("no")},
+                       {QString::fromUtf8("demuxer-readahead-secs"), 0.0}};
+}
+
+// Seeks to the keyframe after the current one. Returns false at the end of
+// the file, on errors and on cancellation.
+bool seekToNextKeyframe(MpvHeadlessHandle &mpv)
+{
+    if (!mpv.command(QVariantList{QString::fromUtf8("seek"),
+                                  m_seekStep,
+                                  QString::fromUtf8("relative+keyframes")})) {
+        return false;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    while (!mpv.isCancelled() && (timer.elapsed() < m_seekTimeout)) {
+        const mpv_event *event = mpv.pollEvent(50);
+        if (!event) {
+            return false;
+        }
+        switch (event->event_id) {
+        case MPV_EVENT_PLAYBACK_RESTART:
+            return true;
+        case MPV_EVENT_SHUTDOWN:
+        case MPV_EVENT_END_FILE:
+            return false;
+        case MPV_EVENT_NONE:
+            // There was no keyframe left to seek to, and the player stopped
+            // at the end instead (keep-open).
+            if (mpv.getProperty(QString::fromUtf8("eof-reached")).toBool()) {
+                return false;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+MpvKeyframeIndex::MpvKeyframeIndex(QObject *parent) : QObject(parent)
+{
+    m_threadPool.setMaxThreadCount(1);
+}
+
+MpvKeyframeIndex::~MpvKeyframeIndex()
+{
+    cancel();
+    m_threadPool.waitForDone();
+}
+
+QUrl MpvKeyframeIndex::source() const
+{
+    return currentSource;
+}
+
+bool MpvKeyframeIndex::cacheEnabled() const
+{
+    return currentCacheEnabled;
+}
+
+bool MpvKeyframeIndex::running() const
+{
+    return !m_job.isNull();
+}
+
+bool MpvKeyframeIndex::ready() const
+{
+    return !m_index.timestamps.isEmpty();
+}
+
+qreal MpvKeyframeIndex::progress() const
+{
+    return currentProgress;
+}
+
+int MpvKeyframeIndex::count() const
+{
+    return m_index.timestamps.size();
+}
+
+QUrl MpvKeyframeIndex::indexedSource() const
+{
+    return m_index.source;
+}
+
+void MpvKeyframeIndex::setSource(const QUrl &source)
+{
+    if (source == currentSource) {
+        return;
+    }
+    currentSource = source;
+    Q_EMIT sourceChanged();
+}
+
+void MpvKeyframeIndex::setCacheEnabled(const bool cacheEnabled)
+{
+    if (cacheEnabled == currentCacheEnabled) {
+        return;
+    }
+    currentCacheEnabled = cacheEnabled;
+    Q_EMIT cacheEnabledChanged();
+}
+
+qreal MpvKeyframeIndex::timestamp(const int index) const
+{
+    return m_index.timestamps.value(index);
+}
+
+qint64 MpvKeyframeIndex::byteOffset(const int index) const
+{
+    return m_index.byteOffsets.value(index, -1);
+}
+
+int MpvKeyframeIndex::nearestIndex(const qreal position) const
+{
+    const QVector<double> &timestamps = m_index.timestamps;
+    if (timestamps.isEmpty()) {
+        return -1;
+    }
+    const auto next = std::lower_bound(timestamps.cbegin(), timestamps.cend(), position);
+    if (next == timestamps.cbegin()) {
+        return 0;
+    }
+    const auto previous = next - 1;
+    if ((next == timestamps.cend()) || ((position - *previous) <= (*next - position))) {
+        return static_cast<int>(previous - timestamps.cbegin());
+    }
+    return static_cast<int>(next - timestamps.cbegin());
+}
+
+qreal MpvKeyframeIndex::nearestKeyframe(const qreal position) const
+{
+    const int index = nearestIndex(position);
+    return (index >= 0) ? m_index.timestamps.at(index) : position;
+}
+
+qreal MpvKeyframeIndex::previousKeyframe(const qreal position) const
+{
+    const QVector<double> &timestamps = m_index.timestamps;
+    const auto next = std::upper_bound(timestamps.cbegin(), timestamps.cend(), position);
+    return (next == timestamps.cbegin()) ? nearestKeyframe(position) : *(next - 1);
+}
+
+qreal MpvKeyframeIndex::nextKeyframe(const qreal position) const
+{
+    const QVector<double> &timestamps = m_index.timestamps;
+    const auto next = std::lower_bound(timestamps.cbegin(), timestamps.cend(), position);
+    return (next == timestamps.cend()) ? nearestKeyframe(position) : *next;
+}
+
+QList<qreal> MpvKeyframeIndex::keyframes() const
+{
+    QList<qreal> result = {};
+    result.reserve(m_index.timestamps.size());
+    for (auto &&timestamp : qAsConst(m_index.timestamps)) {
+        result.append(timestamp);
+    }
+    return result;
+}
+
+bool MpvKeyframeIndex::build()
+{
+    if (running() || !currentSource.isValid()) {
+        return false;
+    }
+    const auto job = QSharedPointer<Job>::create();
+    job->source = currentSource;
+    job->cacheEnabled = currentCacheEnabled;
+    m_job = job;
+    currentProgress = 0.0;
+    Q_EMIT runningChanged();
+    Q_EMIT progressChanged();
+    Q_EMIT started();
+    m_threadPool.start([this, job]() { runJob(job); });
+    return true;
+}
+
+void MpvKeyframeIndex::cancel()
+{
+    if (m_job) {
+        m_job->cancelled.storeRelease(1);
+    }
+}
+
+void MpvKeyframeIndex::clear()
+{
+    if (m_index.timestamps.isEmpty()) {
+        return;
+    }
+    m_index = {};
+    Q_EMIT indexChanged();
+}
+
+QByteArray MpvKeyframeIndex::serialize(const Index &index)
+{
+    if (index.timestamps.isEmpty()) {
+        return {};
+    }
+    const int count = index.timestamps.size();
+    QByteArray data = {};
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << m_cacheFormatVersion << qint32(count);
+    // Raw native values: the cache never leaves this machine.
+    stream.writeRawData(reinterpret_cast<const char *>(index.timestamps.constData()),
+                        static_cast<int>(count * sizeof(double)));
+    stream.writeRawData(reinterpret_cast<const char *>(index.byteOffsets.constData()),
+                        static_cast<int>(count * sizeof(qint64)));
+    return data;
+}
+
+bool MpvKeyframeIndex::deserialize(const QByteArray &data, Index &index)
+{
+    if (data.isEmpty()) {
+        return false;
+    }
+    QDataStream stream(data);
+    quint32 version = 0;
+    qint32 count = 0;
+    stream >> version >> count;
+    if ((stream.status() != QDataStream::Ok) || (version != m_cacheFormatVersion)
+        || (count <= 0)) {
+        return false;
+    }
+    index.timestamps.resize(count);
+    index.byteOffsets.resize(count);
+    const auto timestampBytes = static_cast<int>(count * sizeof(double));
+    const auto offsetBytes = static_cast<int>(count * sizeof(qint64));
+    return (stream.readRawData(reinterpret_cast<char *>(index.timestamps.data()), timestampBytes)
+            == timestampBytes)
+           && (stream.readRawData(reinterpret_cast<char *>(index.byteOffsets.data()), offsetBytes)
+               == offsetBytes)
+           && std::is_sorted(index.timestamps.cbegin(), index.timestamps.cend());
+}
+
+void MpvKeyframeIndex::runJob(const QSharedPointer<Job> &job)
+{
+    // Runs in the thread pool.
+    Index index = {};
+    bool success = false;
+    if (job->cacheEnabled) {
+        success = deserialize(MpvMediaCache::load(job->source, m_cacheSuffix), index);
+    }
+    if (!success) {
+        index = {};
+        success = scan(job, index);
+        if (success && job->cacheEnabled
+            && !MpvMediaCache::save(job->source, m_cacheSuffix, serialize(index))) {
+            qCWarning(lcMpvHeadless) << "Failed to cache the keyframe index of" << job->source;
+        }
+    }
+    index.source = job->source;
+    QMetaObject::invokeMethod(
+        this,
+        [this, job, index, success]() { finishJob(job, index, success); },
+        Qt::QueuedConnection);
+}
+
+bool MpvKeyframeIndex::scan(const QSharedPointer<Job> &job, Index &index)
+{
+    // Runs in the thread pool.
+    MpvHeadlessHandle mpv(indexOptions(), &job->cancelled);
+    if (!mpv.isValid() || !mpv.loadFile(job->source)) {
+        return false;
+    }
+    if (mpv.getProperty(QString::fromUtf8("vid")).toInt() <= 0) {
+        qCWarning(lcMpvHeadless) << "There's no video to index in" << job->source;
+        return false;
+    }
+    const qreal duration = mpv.getProperty(QString::fromUtf8("duration")).toReal();
+    QElapsedTimer progressTimer;
+    progressTimer.start();
+    // Loading stops on the first frame, which is a keyframe as well.
+    do {
+        bool ok = false;
+        const double position = mpv.getProperty(QString::fromUtf8("time-pos"), &ok).toDouble();
+        // The demuxer went back instead: there's no keyframe left.
+        if (!ok || (!index.timestamps.isEmpty() && (position <= index.timestamps.constLast()))) {
+            break;
+        }
+        const QVariant offset = mpv.getProperty(QString::fromUtf8("stream-pos"), &ok);
+        index.timestamps.append(position);
+        index.byteOffsets.append(ok ? offset.toLongLong() : -1);
+        if ((duration > 0.0) && (progressTimer.elapsed() >= m_progressInterval)) {
+            progressTimer.restart();
+            const qreal progress = qBound(0.0, position / duration, 1.0);
+            QMetaObject::invokeMethod(
+                this,
+                [this, job, progress]() {
+                    if ((job != m_job) || qFuzzyCompare(progress, currentProgress)) {
+                        return;
+                    }
+                    currentProgress = progress;
+                    Q_EMIT progressChanged();
+                },
+                Qt::QueuedConnection);
+        }
+    } while (seekToNextKeyframe(mpv));
+    if (mpv.isCancelled()) {
+        return false;
+    }
+    if (index.timestamps.isEmpty()) {
+        qCWarning(lcMpvHeadless) << "No keyframe has been found in" << job->source;
+        return false;
+    }
+    index.timestamps.squeeze();
+    index.byteOffsets.squeeze();
+    return true;
+}
+
+void MpvKeyframeIndex::finishJob(const QSharedPointer<Job> &job,
+                                 const Index &index,
+                                 const bool success)
+{
+    if (job != m_job) {
+        return;
+    }
+    m_job.reset();
+    if (success) {
+        m_index = index;
+        currentProgress = 1.0;
+        Q_EMIT indexChanged();
+    }
+    Q_EMIT runningChanged();
+    Q_EMIT progressChanged();
+    Q_EMIT finished(success);
+}
@@ -0,0 +1,135 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QUrl>
+#include <QVector>
+#include <QtQml/qqml.h>
+
+// Finds the keyframes of a file, so that a seek bar can choose between a
+// fast keyframe seek and a slow exact one, see MpvObject::keyframeIndex.
+// libmpv doesn't hand out demuxed packets, so a headless mpv handle walks
+// the file with forward keyframe seeks on a worker thread: each one lands
+// on the next seek point of the demuxer, and only that keyframe gets
+// decoded (no audio, no output, no loop filter). The result is a compact
+// sorted array that is cached alongside the media.
+class MpvKeyframeIndex : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_DISABLE_COPY_MOVE(MpvKeyframeIndex)
+
+    Q_PROPERTY(QUrl source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(bool cacheEnabled READ cacheEnabled WRITE setCacheEnabled NOTIFY cacheEnabledChanged)
+    Q_PROPERTY(bool running READ running NOTIFY runningChanged)
+    Q_PROPERTY(bool ready READ ready NOTIFY indexChanged)
+    Q_PROPERTY(qreal progress READ progress NOTIFY progressChanged)
+    Q_PROPERTY(int count READ count NOTIFY indexChanged)
+
+public:
+    explicit MpvKeyframeIndex(QObject *parent = nullptr);
+    ~MpvKeyframeIndex() override;
+
+    QUrl source() const;
+    // Load the index from (and save it to) the cache. Defaults to true.
+    bool cacheEnabled() const;
+    bool running() const;
+    bool ready() const;
+    // 0.0 - 1.0
+    qreal progress() const;
+    // Number of keyframes.
+    int count() const;
+    // The source the current index was built for, which stays valid until
+    // another one has been built or clear() is called.
+    QUrl indexedSource() const;
+
+    void setSource(const QUrl &source);
+    void setCacheEnabled(const bool cacheEnabled);
+
+    // Timestamp of the given keyframe, in seconds.
+    Q_INVOKABLE qreal timestamp(const int index) const;
+    // Where the demuxer was reading when the given keyframe was reached, in
+    // bytes. An upper bound of the keyframe's offset rather than the exact
+    // one, as the demuxer reads ahead a little. -1 if libmpv didn't tell.
+    Q_INVOKABLE qint64 byteOffset(const int index) const;
+    // Index of the keyframe closest to the given position (in seconds), -1
+    // if there's none.
+    Q_INVOKABLE int nearestIndex(const qreal position) const;
+    // Timestamp of the keyframe closest to the given position, or the
+    // position itself if there are no keyframes.
+    Q_INVOKABLE qreal nearestKeyframe(const qreal position) const;
+    // Timestamp of the last keyframe at or before the given position.
+    Q_INVOKABLE qreal previousKeyframe(const qreal position) const;
+    // Timestamp of the first keyframe at or after the given position.
+    Q_INVOKABLE qreal nextKeyframe(const qreal position) const;
+    Q_INVOKABLE QList<qreal> keyframes() const;
+
+public Q_SLOTS:
+    // Starts indexing the current source. Returns false if a job is already
+    // running.
+    bool build();
+    void cancel();
+    // Release the index.
+    void clear();
+
+Q_SIGNALS:
+    void started();
+    void finished(bool success);
+
+    void sourceChanged();
+    void cacheEnabledChanged();
+    void runningChanged();
+    void progressChanged();
+    void indexChanged();
+
+private:
+    struct Job;
+    struct Index
+    {
+        QUrl source = QUrl();
+        // Both sorted by timestamp, same size.
+        QVector<double> timestamps = {};
+        QVector<qint64> byteOffsets = {};
+    };
+
+    static QByteArray serialize(const Index &index);
+    static bool deserialize(const QByteArray &data, Index &index);
+
+    void runJob(const QSharedPointer<Job> &job);
+    bool scan(const QSharedPointer<Job> &job, Index &index);
+    void finishJob(const QSharedPointer<Job> &job, const Index &index, const bool success);
+
+private:
+    QUrl currentSource = QUrl();
+    bool currentCacheEnabled = true;
+    qreal currentProgress = 0.0;
+
+    QThreadPool m_threadPool;
+    QSharedPointer<Job> m_job;
+    Index m_index = {};
+};
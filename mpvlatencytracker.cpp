@@ -0,0 +1,292 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvlatencytracker.h"
+
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// How long to wait for the first frame after a restart, in milliseconds.
+const int m_firstFrameTimeout = 1000;
+
+} // namespace
+
+MpvLatencyTracker::MpvLatencyTracker(QObject *parent) : QObject(parent)
+{
+    m_frameTimeout.setSingleShot(true);
+    m_frameTimeout.setInterval(m_firstFrameTimeout);
+    connect(&m_frameTimeout, &QTimer::timeout, this, &MpvLatencyTracker::completeAtRestart);
+}
+
+MpvLatencyTracker::~MpvLatencyTracker() = default;
+
+int MpvLatencyTracker::windowSize() const
+{
+    return currentWindowSize;
+}
+
+QVariantMap MpvLatencyTracker::openToLoaded() const
+{
+    return m_openToLoaded.statistics();
+}
+
+QVariantMap MpvLatencyTracker::openToFirstFrame() const
+{
+    return m_openToFirstFrame.statistics();
+}
+
+QVariantMap MpvLatencyTracker::seekToRestart() const
+{
+    return m_seekToRestart.statistics();
+}
+
+QVariantMap MpvLatencyTracker::seekToFirstFrame() const
+{
+    return m_seekToFirstFrame.statistics();
+}
+
+void MpvLatencyTracker::setWindowSize(const int windowSize)
+{
+    const int newWindowSize = qMax(windowSize, 1);
+    if (newWindowSize == currentWindowSize) {
+        return;
+    }
+    currentWindowSize = newWindowSize;
+    // Simpler than shrinking the rings in place.
+    reset();
+    Q_EMIT windowSizeChanged();
+}
+
+void MpvLatencyTracker::openStarted()
+{
+    m_open = {now(), -1};
+    m_seek = {};
+    m_frameRequested.storeRelease(0);
+    m_frameTimeout.stop();
+}
+
+void MpvLatencyTracker::fileStarted()
+{
+    // The next entry of a playlist.
+    if (m_open.start < 0) {
+        openStarted();
+    }
+}
+
+void MpvLatencyTracker::fileLoaded()
+{
+    if (m_open.start >= 0) {
+        m_open.milestone = now();
+    }
+}
+
+bool MpvLatencyTracker::seekStarted()
+{
+    // Seeks mpv does on its own only have MPV_EVENT_SEEK, ours are started
+    // earlier, when the command is sent.
+    if (m_seek.milestone >= 0) {
+        // Still waiting for the frame of the previous seek.
+        completeAtRestart();
+    }
+    if (m_seek.start >= 0) {
+        return false;
+    }
+    m_seek = {now(), -1};
+    return true;
+}
+
+void MpvLatencyTracker::cancelSeek()
+{
+    m_seek = {};
+}
+
+void MpvLatencyTracker::playbackRestarted(const bool hasVideo)
+{
+    const qint64 timestamp = now();
+    bool pending = (m_open.start >= 0) && (m_open.milestone >= 0);
+    if (m_seek.start >= 0) {
+        m_seek.milestone = timestamp;
+        pending = true;
+    }
+    if (!pending) {
+        return;
+    }
+    if (hasVideo) {
+        m_restartedAt = timestamp;
+        m_frameRequested.storeRelease(1);
+        m_frameTimeout.start();
+    } else {
+        complete(timestamp);
+    }
+}
+
+void MpvLatencyTracker::fileEnded()
+{
+    // "loadfile" ends the current file first, the new one is still being
+    // opened then.
+    if (m_open.milestone >= 0) {
+        m_open = {};
+    }
+    m_seek = {};
+    m_frameRequested.storeRelease(0);
+    m_frameTimeout.stop();
+}
+
+bool MpvLatencyTracker::wantsFrame() const
+{
+    return m_frameRequested.loadAcquire() != 0;
+}
+
+void MpvLatencyTracker::frameRendered()
+{
+    // Runs on the render thread.
+    if (m_frameRequested.loadAcquire() == 0) {
+        return;
+    }
+    const qint64 renderedAt = now();
+    m_renderedAt.storeRelease(renderedAt);
+    if (!m_frameRequested.testAndSetOrdered(1, 0)) {
+        return;
+    }
+    QMetaObject::invokeMethod(
+        this, [this, renderedAt]() { complete(renderedAt); }, Qt::QueuedConnection);
+}
+
+qreal MpvLatencyTracker::percentile(const QString &metric, const qreal percent) const
+{
+    const Metric *selected = this->metric(metric);
+    return selected ? selected->percentile(percent) : -1.0;
+}
+
+void MpvLatencyTracker::reset()
+{
+    m_openToLoaded = {};
+    m_openToFirstFrame = {};
+    m_seekToRestart = {};
+    m_seekToFirstFrame = {};
+    Q_EMIT openStatisticsChanged();
+    Q_EMIT seekStatisticsChanged();
+}
+
+void MpvLatencyTracker::Metric::add(const qreal value, const int windowSize)
+{
+    if (samples.size() < windowSize) {
+        samples.append(value);
+    } else {
+        samples[next] = value;
+        next = (next + 1) % windowSize;
+    }
+    ++count;
+    last = value;
+}
+
+QVariantMap MpvLatencyTracker::Metric::statistics() const
+{
+    if (samples.isEmpty()) {
+        return QVariantMap{{QString::fromUtf8("count"), 0}};
+    }
+    return QVariantMap{{QString::fromUtf8("count"), count},
+                       {QString::fromUtf8("last"), last},
+                       {QString::fromUtf8("min"), *std::min_element(samples.cbegin(),
+                                                                    samples.cend())},
+                       {QString::fromUtf8("max"), *std::max_element(samples.cbegin(),
+                                                                    samples.cend())},
+                       {QString::fromUtf8("p50"), percentile(50.0)},
+                       {QString::fromUtf8("p95"), percentile(95.0)},
+                       {QString::fromUtf8("p99"), percentile(99.0)}};
+}
+
+qreal MpvLatencyTracker::Metric::percentile(const qreal percent) const
+{
+    if (samples.isEmpty()) {
+        return -1.0;
+    }
+    // Nearest rank, the windows are small enough to sort every time.
+    QVector<qreal> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    const int rank = static_cast<int>(std::ceil(qBound(0.0, percent, 100.0) / 100.0
+                                                * sorted.size()));
+    return sorted.at(qBound(0, rank - 1, sorted.size() - 1));
+}
+
+qint64 MpvLatencyTracker::now()
+{
+    static const QElapsedTimer timer = []() {
+        QElapsedTimer elapsedTimer;
+        elapsedTimer.start();
+        return elapsedTimer;
+    }();
+    return timer.nsecsElapsed();
+}
+
+void MpvLatencyTracker::complete(const qint64 renderedAt)
+{
+    m_frameTimeout.stop();
+    if ((m_open.start >= 0) && (m_open.milestone >= 0)) {
+        const qreal toLoaded = (m_open.milestone - m_open.start) / 1000000.0;
+        const qreal toFirstFrame = (renderedAt - m_open.start) / 1000000.0;
+        m_open = {};
+        m_openToLoaded.add(toLoaded, currentWindowSize);
+        m_openToFirstFrame.add(toFirstFrame, currentWindowSize);
+        Q_EMIT openStatisticsChanged();
+        Q_EMIT openCompleted(toLoaded, toFirstFrame);
+    }
+    if ((m_seek.start >= 0) && (m_seek.milestone >= 0)) {
+        const qreal toRestart = (m_seek.milestone - m_seek.start) / 1000000.0;
+        const qreal toFirstFrame = (renderedAt - m_seek.start) / 1000000.0;
+        m_seek = {};
+        m_seekToRestart.add(toRestart, currentWindowSize);
+        m_seekToFirstFrame.add(toFirstFrame, currentWindowSize);
+        Q_EMIT seekStatisticsChanged();
+        Q_EMIT seekCompleted(toRestart, toFirstFrame);
+    }
+}
+
+void MpvLatencyTracker::completeAtRestart()
+{
+    // If the renderer got there first, its completion is still queued, the
+    // frame's timestamp is already there though.
+    complete(m_frameRequested.testAndSetOrdered(1, 0) ? m_restartedAt
+                                                      : m_renderedAt.loadAcquire());
+}
+
+const MpvLatencyTracker::Metric *MpvLatencyTracker::metric(const QString &name) const
+{
+    if (name == QString::fromUtf8("openToLoaded")) {
+        return &m_openToLoaded;
+    }
+    if (name == QString::fromUtf8("openToFirstFrame")) {
+        return &m_openToFirstFrame;
+    }
+    if (name == QString::fromUtf8("seekToRestart")) {
+        return &m_seekToRestart;
+    }
+    if (name == QString::fromUtf8("seekToFirstFrame")) {
+        return &m_seekToFirstFrame;
+    }
+    return nullptr;
+}
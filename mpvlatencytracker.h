@@ -0,0 +1,146 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QObject>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
+#include <QtQml/qqml.h>
+
+// How long opening a file and seeking take for a MpvObject, to compare
+// hr-seek, cache and hardware settings objectively. Every operation is
+// timed in milliseconds up to two points:
+//
+// - Opening: from "loadfile" (or the start of the next playlist entry) to
+//   MPV_EVENT_FILE_LOADED ("openToLoaded"), and to the first frame that is
+//   rendered after playback starts ("openToFirstFrame").
+// - Seeking: from the first seek that's still pending (a burst of seeks
+//   while scrubbing counts as one) to MPV_EVENT_PLAYBACK_RESTART
+//   ("seekToRestart"), and to the first frame rendered after that
+//   ("seekToFirstFrame").
+//
+// Each metric keeps its last "windowSize" samples and is published as a
+// map of "count" (all operations since the last reset()), "last", "min",
+// "max", "p50", "p95" and "p99" over the window. Audio-only files complete
+// at the restart, as nothing is rendered for them. So does an operation
+// whose first frame doesn't arrive within a second (the item is hidden, for
+// example) or that is followed by another seek before it arrives.
+class MpvLatencyTracker : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("Provided by MpvObject.")
+    Q_DISABLE_COPY_MOVE(MpvLatencyTracker)
+
+    Q_PROPERTY(int windowSize READ windowSize WRITE setWindowSize NOTIFY windowSizeChanged)
+    Q_PROPERTY(QVariantMap openToLoaded READ openToLoaded NOTIFY openStatisticsChanged)
+    Q_PROPERTY(QVariantMap openToFirstFrame READ openToFirstFrame NOTIFY openStatisticsChanged)
+    Q_PROPERTY(QVariantMap seekToRestart READ seekToRestart NOTIFY seekStatisticsChanged)
+    Q_PROPERTY(QVariantMap seekToFirstFrame READ seekToFirstFrame NOTIFY seekStatisticsChanged)
+
+public:
+    explicit MpvLatencyTracker(QObject *parent = nullptr);
+    ~MpvLatencyTracker() override;
+
+    // Defaults to 100.
+    int windowSize() const;
+    QVariantMap openToLoaded() const;
+    QVariantMap openToFirstFrame() const;
+    QVariantMap seekToRestart() const;
+    QVariantMap seekToFirstFrame() const;
+
+    void setWindowSize(const int windowSize);
+
+    // Called by MpvObject.
+    void openStarted();
+    void fileStarted();
+    void fileLoaded();
+    // Returns false if a seek was pending already.
+    bool seekStarted();
+    void cancelSeek();
+    void playbackRestarted(const bool hasVideo);
+    void fileEnded();
+    // Called by the renderer, from the render thread.
+    bool wantsFrame() const;
+    void frameRendered();
+
+    // The percentile (0 - 100) of a metric over the window, -1 if it has
+    // no samples.
+    Q_INVOKABLE qreal percentile(const QString &metric, const qreal percent) const;
+
+public Q_SLOTS:
+    // Forgets every sample.
+    void reset();
+
+Q_SIGNALS:
+    void windowSizeChanged();
+    void openStatisticsChanged();
+    void seekStatisticsChanged();
+    // Emitted for each completed operation, in milliseconds.
+    void openCompleted(qreal toLoaded, qreal toFirstFrame);
+    void seekCompleted(qreal toRestart, qreal toFirstFrame);
+
+private:
+    struct Metric
+    {
+        QVector<qreal> samples = {};
+        int next = 0;
+        int count = 0;
+        qreal last = -1.0;
+
+        void add(const qreal value, const int windowSize);
+        QVariantMap statistics() const;
+        qreal percentile(const qreal percent) const;
+    };
+
+    struct Operation
+    {
+        // In nanoseconds, -1 if not reached yet.
+        qint64 start = -1;
+        qint64 milestone = -1;
+    };
+
+    static qint64 now();
+    void complete(const qint64 renderedAt);
+    void completeAtRestart();
+    const Metric *metric(const QString &name) const;
+
+private:
+    int currentWindowSize = 100;
+    Metric m_openToLoaded;
+    Metric m_openToFirstFrame;
+    Metric m_seekToRestart;
+    Metric m_seekToFirstFrame;
+    Operation m_open;
+    Operation m_seek;
+    QAtomicInt m_frameRequested = 0;
+    // Written by the render thread before it clears m_frameRequested.
+    QAtomicInteger<qint64> m_renderedAt = -1;
+    qint64 m_restartedAt = -1;
+    QTimer m_frameTimeout;
+};
@@ -0,0 +1,369 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvlogsink.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <cstring>
+
+Q_LOGGING_CATEGORY(lcMpvLog, "libmpv.log.general")
+
+namespace {
+
+QVector<QByteArray> toModules(const QStringList &modules)
+{
+    QVector<QByteArray> result = {};
+    for (auto &&module : qAsConst(modules)) {
+        if (!module.isEmpty()) {
+            result.append(module.toUtf8());
+        }
+    }
+    return result;
+}
+
+QStringList fromModules(const QVector<QByteArray> &modules)
+{
+    QStringList result = {};
+    for (auto &&module : qAsConst(modules)) {
+        result.append(QString::fromUtf8(module));
+    }
+    return result;
+}
+
+// Reuses the buffer of the slot once it's big enough.
+void assign(QByteArray &destination, const char *source, const int length)
+{
+    destination.resize(length);
+    std::memcpy(destination.data(), source, length);
+}
+
+} // namespace
+
+MpvLogSink::MpvLogSink(QObject *parent) : QObject(parent)
+{
+    m_rateWindow.start();
+    m_counterTimer.setSingleShot(true);
+    m_counterTimer.setInterval(0);
+    connect(&m_counterTimer, &QTimer::timeout, this, &MpvLogSink::notifyCounters);
+}
+
+MpvLogSink::~MpvLogSink() = default;
+
+MpvLogSink::Level MpvLogSink::minimumLevel() const
+{
+    return currentMinimumLevel;
+}
+
+QStringList MpvLogSink::modules() const
+{
+    return fromModules(m_modules);
+}
+
+QStringList MpvLogSink::excludedModules() const
+{
+    return fromModules(m_excludedModules);
+}
+
+int MpvLogSink::capacity() const
+{
+    return currentCapacity;
+}
+
+int MpvLogSink::rateLimit() const
+{
+    return currentRateLimit;
+}
+
+bool MpvLogSink::forwardToQtLogging() const
+{
+    return currentForwardToQtLogging;
+}
+
+int MpvLogSink::count() const
+{
+    return m_count;
+}
+
+qint64 MpvLogSink::droppedCount() const
+{
+    return m_droppedCount;
+}
+
+qint64 MpvLogSink::repeatedCount() const
+{
+    return m_repeatedCount;
+}
+
+void MpvLogSink::setMinimumLevel(const MpvLogSink::Level minimumLevel)
+{
+    if (minimumLevel == currentMinimumLevel) {
+        return;
+    }
+    currentMinimumLevel = minimumLevel;
+    Q_EMIT minimumLevelChanged();
+}
+
+void MpvLogSink::setModules(const QStringList &modules)
+{
+    const QVector<QByteArray> newModules = toModules(modules);
+    if (newModules == m_modules) {
+        return;
+    }
+    m_modules = newModules;
+    Q_EMIT modulesChanged();
+}
+
+void MpvLogSink::setExcludedModules(const QStringList &excludedModules)
+{
+    const QVector<QByteArray> newModules = toModules(excludedModules);
+    if (newModules == m_excludedModules) {
+        return;
+    }
+    m_excludedModules = newModules;
+    Q_EMIT excludedModulesChanged();
+}
+
+void MpvLogSink::setCapacity(const int capacity)
+{
+    const int newCapacity = qMax(capacity, 1);
+    if (newCapacity == currentCapacity) {
+        return;
+    }
+    // Keep the most recent records.
+    const QVector<Record> kept = records(newCapacity);
+    currentCapacity = newCapacity;
+    m_records = kept;
+    m_next = m_records.size() % currentCapacity;
+    const bool countChanged = (m_count != m_records.size());
+    m_count = m_records.size();
+    Q_EMIT capacityChanged();
+    if (countChanged) {
+        Q_EMIT this->countChanged();
+    }
+}
+
+void MpvLogSink::setRateLimit(const int rateLimit)
+{
+    const int newRateLimit = qMax(rateLimit, 0);
+    if (newRateLimit == currentRateLimit) {
+        return;
+    }
+    currentRateLimit = newRateLimit;
+    Q_EMIT rateLimitChanged();
+}
+
+void MpvLogSink::setForwardToQtLogging(const bool forwardToQtLogging)
+{
+    if (forwardToQtLogging == currentForwardToQtLogging) {
+        return;
+    }
+    currentForwardToQtLogging = forwardToQtLogging;
+    Q_EMIT forwardToQtLoggingChanged();
+}
+
+void MpvLogSink::add(const int level, const char *prefix, const char *text)
+{
+    if (!prefix || !text || !accepts(level, prefix)) {
+        return;
+    }
+    const int prefixLength = static_cast<int>(std::strlen(prefix));
+    int textLength = static_cast<int>(std::strlen(text));
+    // The messages of libmpv end with a new line.
+    while ((textLength > 0) && ((text[textLength - 1] == '\n') || (text[textLength - 1] == '\r'))) {
+        --textLength;
+    }
+
+    if (m_count > 0) {
+        Record &last = m_records[(m_next + currentCapacity - 1) % currentCapacity];
+        if ((static_cast<int>(last.level) == level) && (last.prefix.size() == prefixLength)
+            && (last.text.size() == textLength)
+            && (std::memcmp(last.prefix.constData(), prefix, prefixLength) == 0)
+            && (std::memcmp(last.text.constData(), text, textLength) == 0)) {
+            ++last.repeats;
+            ++m_repeatedCount;
+            m_repeatedCountChanged = true;
+            if (!m_counterTimer.isActive()) {
+                m_counterTimer.start();
+            }
+            return;
+        }
+    }
+
+    if (m_rateWindow.elapsed() >= 1000) {
+        m_rateWindow.restart();
+        m_rateWindowCount = 0;
+    }
+    // Errors are never dropped.
+    if ((currentRateLimit > 0) && (m_rateWindowCount >= currentRateLimit)
+        && (level > MPV_LOG_LEVEL_ERROR)) {
+        ++m_droppedCount;
+        m_droppedCountChanged = true;
+        if (!m_counterTimer.isActive()) {
+            m_counterTimer.start();
+        }
+        return;
+    }
+    ++m_rateWindowCount;
+
+    if (m_records.size() < currentCapacity) {
+        m_records.append(Record{});
+    }
+    Record &record = m_records[m_next];
+    m_next = (m_next + 1) % currentCapacity;
+    record.timestamp = QDateTime::currentMSecsSinceEpoch();
+    record.level = static_cast<Level>(level);
+    assign(record.prefix, prefix, prefixLength);
+    assign(record.text, text, textLength);
+    record.repeats = 0;
+    const bool countChanged = (m_count < currentCapacity);
+    m_count = qMin(m_count + 1, currentCapacity);
+
+    if (currentForwardToQtLogging) {
+        forward(record);
+    }
+    if (countChanged) {
+        Q_EMIT this->countChanged();
+    }
+    Q_EMIT messageLogged(record.level);
+    if (level == MPV_LOG_LEVEL_FATAL) {
+        Q_EMIT fatalError(QString::fromUtf8(record.prefix), QString::fromUtf8(record.text));
+    }
+}
+
+QVector<MpvLogSink::Record> MpvLogSink::records(const int max) const
+{
+    const int size = (max < 0) ? m_count : qMin(max, m_count);
+    QVector<Record> result = {};
+    result.reserve(size);
+    // The oldest record is at m_next once the ring is full.
+    const int first = (m_next + currentCapacity - size) % currentCapacity;
+    for (int i = 0; i != size; ++i) {
+        result.append(m_records.at((first + i) % currentCapacity));
+    }
+    return result;
+}
+
+QVariantList MpvLogSink::recent(const int max) const
+{
+    QVariantList result = {};
+    const QVector<Record> records = this->records(max);
+    for (auto &&record : qAsConst(records)) {
+        result.append(QVariantMap{{QString::fromUtf8("timestamp"), record.timestamp},
+                                  {QString::fromUtf8("level"), static_cast<int>(record.level)},
+                                  {QString::fromUtf8("prefix"), QString::fromUtf8(record.prefix)},
+                                  {QString::fromUtf8("text"), QString::fromUtf8(record.text)},
+                                  {QString::fromUtf8("repeats"), record.repeats}});
+    }
+    return result;
+}
+
+void MpvLogSink::clear()
+{
+    m_records.clear();
+    m_next = 0;
+    if (m_count != 0) {
+        m_count = 0;
+        Q_EMIT countChanged();
+    }
+}
+
+bool MpvLogSink::accepts(const int level, const char *prefix) const
+{
+    // Fatal messages are never filtered out, see fatalError().
+    if (level == MPV_LOG_LEVEL_FATAL) {
+        return true;
+    }
+    if (level > static_cast<int>(currentMinimumLevel)) {
+        return false;
+    }
+    if (!m_modules.isEmpty() && !contains(m_modules, prefix)) {
+        return false;
+    }
+    return !contains(m_excludedModules, prefix);
+}
+
+bool MpvLogSink::contains(const QVector<QByteArray> &modules, const char *prefix)
+{
+    for (auto &&module : qAsConst(modules)) {
+        if (std::strcmp(module.constData(), prefix) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MpvLogSink::notifyCounters()
+{
+    if (m_droppedCountChanged) {
+        m_droppedCountChanged = false;
+        Q_EMIT droppedCountChanged();
+    }
+    if (m_repeatedCountChanged) {
+        m_repeatedCountChanged = false;
+        Q_EMIT repeatedCountChanged();
+    }
+}
+
+void MpvLogSink::forward(const MpvLogSink::Record &record) const
+{
+    QtMsgType type = QtDebugMsg;
+    switch (record.level) {
+    case Level::Verbose:
+    case Level::Debug:
+    case Level::Trace:
+        type = QtDebugMsg;
+        break;
+    case Level::Warning:
+        type = QtWarningMsg;
+        break;
+    case Level::Error:
+    case Level::Fatal:
+        type = QtCriticalMsg;
+        break;
+    case Level::Info:
+        type = QtInfoMsg;
+        break;
+    }
+    // Most of mpv's output is verbose, don't build strings nobody will see.
+    if (!lcMpvLog().isEnabled(type)) {
+        return;
+    }
+    const QString message = QString::fromUtf8(record.prefix) + QString::fromUtf8(": ")
+                            + QString::fromUtf8(record.text);
+    switch (type) {
+    case QtWarningMsg:
+        qCWarning(lcMpvLog).noquote() << message;
+        break;
+    case QtCriticalMsg:
+        qCCritical(lcMpvLog).noquote() << message;
+        break;
+    case QtInfoMsg:
+        qCInfo(lcMpvLog).noquote() << message;
+        break;
+    default:
+        qCDebug(lcMpvLog).noquote() << message;
+        break;
+    }
+}
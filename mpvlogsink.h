@@ -0,0 +1,183 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+// Don't use any deprecated APIs from MPV.
+#ifdef MPV_ENABLE_DEPRECATED
+#undef MPV_ENABLE_DEPRECATED
+#endif
+
+#define MPV_ENABLE_DEPRECATED 0
+
+#include "mpvqthelper.hpp"
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include <QVariantList>
+#include <QVector>
+#include <QtQml/qqml.h>
+
+Q_DECLARE_LOGGING_CATEGORY(lcMpvLog)
+
+// Where the log messages of libmpv go. At "v" level libmpv sends thousands
+// of messages per second, so they are filtered by level and module (the
+// prefix, eg: "cplayer", "vd", "ffmpeg/demuxer") before anything is
+// allocated, repeats of the last message are folded into it, and at most
+// "rateLimit" messages per second are kept (errors are always kept). What
+// passes is stored in a ring of the last "capacity" records, available to
+// C++ with records() and to QML with recent(), and forwarded to the
+// "libmpv.log.general" logging category unless forwardToQtLogging is off.
+//
+// Fatal messages don't abort the application, fatalError() is emitted
+// instead.
+class MpvLogSink : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("Provided by MpvObject.")
+    Q_DISABLE_COPY_MOVE(MpvLogSink)
+
+    Q_PROPERTY(Level minimumLevel READ minimumLevel WRITE setMinimumLevel NOTIFY
+                   minimumLevelChanged)
+    Q_PROPERTY(QStringList modules READ modules WRITE setModules NOTIFY modulesChanged)
+    Q_PROPERTY(QStringList excludedModules READ excludedModules WRITE setExcludedModules NOTIFY
+                   excludedModulesChanged)
+    Q_PROPERTY(int capacity READ capacity WRITE setCapacity NOTIFY capacityChanged)
+    Q_PROPERTY(int rateLimit READ rateLimit WRITE setRateLimit NOTIFY rateLimitChanged)
+    Q_PROPERTY(bool forwardToQtLogging READ forwardToQtLogging WRITE setForwardToQtLogging NOTIFY
+                   forwardToQtLoggingChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(qint64 droppedCount READ droppedCount NOTIFY droppedCountChanged)
+    Q_PROPERTY(qint64 repeatedCount READ repeatedCount NOTIFY repeatedCountChanged)
+
+public:
+    // Same values as mpv_log_level.
+    enum class Level {
+        Fatal = MPV_LOG_LEVEL_FATAL,
+        Error = MPV_LOG_LEVEL_ERROR,
+        Warning = MPV_LOG_LEVEL_WARN,
+        Info = MPV_LOG_LEVEL_INFO,
+        Verbose = MPV_LOG_LEVEL_V,
+        Debug = MPV_LOG_LEVEL_DEBUG,
+        Trace = MPV_LOG_LEVEL_TRACE
+    };
+    Q_ENUM(Level)
+
+    struct Record
+    {
+        // Milliseconds since the epoch.
+        qint64 timestamp = 0;
+        Level level = Level::Info;
+        QByteArray prefix = {};
+        // Without the trailing new line.
+        QByteArray text = {};
+        // How many times it was repeated right after.
+        int repeats = 0;
+    };
+
+    explicit MpvLogSink(QObject *parent = nullptr);
+    ~MpvLogSink() override;
+
+    // The most verbose level that's kept, defaults to Trace: the level
+    // requested from libmpv (MpvObject::logLevel) is the first filter.
+    Level minimumLevel() const;
+    // Only these modules are kept if it's not empty.
+    QStringList modules() const;
+    QStringList excludedModules() const;
+    // Defaults to 512 records.
+    int capacity() const;
+    // Messages per second, 0 for no limit. Defaults to 200.
+    int rateLimit() const;
+    // Defaults to true.
+    bool forwardToQtLogging() const;
+    int count() const;
+    // Dropped by the rate limit.
+    qint64 droppedCount() const;
+    // Folded into the previous record.
+    qint64 repeatedCount() const;
+
+    void setMinimumLevel(const Level minimumLevel);
+    void setModules(const QStringList &modules);
+    void setExcludedModules(const QStringList &excludedModules);
+    void setCapacity(const int capacity);
+    void setRateLimit(const int rateLimit);
+    void setForwardToQtLogging(const bool forwardToQtLogging);
+
+    // Called by MpvObject, with the fields of mpv_event_log_message.
+    void add(const int level, const char *prefix, const char *text);
+
+    // The last "max" records (all of them if it's negative), oldest first.
+    QVector<Record> records(const int max = -1) const;
+    // The same, as maps with "timestamp", "level", "prefix", "text" and
+    // "repeats".
+    Q_INVOKABLE QVariantList recent(const int max = -1) const;
+
+public Q_SLOTS:
+    void clear();
+
+Q_SIGNALS:
+    void minimumLevelChanged();
+    void modulesChanged();
+    void excludedModulesChanged();
+    void capacityChanged();
+    void rateLimitChanged();
+    void forwardToQtLoggingChanged();
+    void countChanged();
+    void droppedCountChanged();
+    void repeatedCountChanged();
+    // Emitted for each record that's stored.
+    void messageLogged(Level level);
+    // libmpv can't continue, the handle should be destroyed.
+    void fatalError(const QString &prefix, const QString &message);
+
+private:
+    bool accepts(const int level, const char *prefix) const;
+    static bool contains(const QVector<QByteArray> &modules, const char *prefix);
+    void forward(const Record &record) const;
+    void notifyCounters();
+
+private:
+    Level currentMinimumLevel = Level::Trace;
+    QVector<QByteArray> m_modules = {};
+    QVector<QByteArray> m_excludedModules = {};
+    int currentCapacity = 512;
+    int currentRateLimit = 200;
+    bool currentForwardToQtLogging = true;
+    // A ring, the slots are reused so that their buffers are as well.
+    QVector<Record> m_records = {};
+    int m_next = 0;
+    int m_count = 0;
+    qint64 m_droppedCount = 0;
+    qint64 m_repeatedCount = 0;
+    QElapsedTimer m_rateWindow;
+    int m_rateWindowCount = 0;
+    // droppedCountChanged() and repeatedCountChanged() are emitted once per
+    // event loop iteration, not once per message.
+    QTimer m_counterTimer;
+    bool m_droppedCountChanged = false;
+    bool m_repeatedCountChanged = false;
+};
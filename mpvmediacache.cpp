@@ -0,0 +1,152 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvmediacache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+
+const quint32 m_cacheMagic = 0x4D505643; // "MPVC"
+const quint32 m_cacheVersion = 1;
+
+QByteArray readEntry(const QString &filePath, const QByteArray &fingerprint)
+{
+    if (filePath.isEmpty()) {
+        return {};
+    }
+    QFile file(filePath);
+    if (!file.open(QFile::ReadOnly)) {
+        return {};
+    }
+    QDataStream stream(&file);
+    quint32 magic = 0, version = 0;
+    QByteArray storedFingerprint = {}, payload = {};
+    stream >> magic >> version;
+    if ((magic != m_cacheMagic) || (version != m_cacheVersion)) {
+        return {};
+    }
+    stream >> storedFingerprint >> payload;
+    if ((stream.status() != QDataStream::Ok) || (storedFingerprint != fingerprint)) {
+        return {};
+    }
+    return payload;
+}
+
+bool writeEntry(const QString &filePath, const QByteArray &fingerprint, const QByteArray &payload)
+{
+    if (filePath.isEmpty()) {
+        return false;
+    }
+    QSaveFile file(filePath);
+    if (!file.open(QFile::WriteOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream << m_cacheMagic << m_cacheVersion << fingerprint << payload;
+    if (stream.status() != QDataStream::Ok) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+} // namespace
+
+QByteArray MpvMediaCache::fingerprint(const QUrl &source)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (source.isLocalFile()) {
+        const QFileInfo fileInfo(source.toLocalFile());
+        hash.addData(fileInfo.absoluteFilePath().toUtf8());
+        hash.addData(QByteArray::number(fileInfo.size()));
+        hash.addData(QByteArray::number(fileInfo.lastModified().toMSecsSinceEpoch()));
+    } else {
+        hash.addData(source.toString(QUrl::FullyEncoded).toUtf8());
+    }
+    return hash.result().toHex();
+}
+
+QByteArray MpvMediaCache::load(const QUrl &source, const QString &suffix)
+{
+    if (!source.isValid() || suffix.isEmpty()) {
+        return {};
+    }
+    const QByteArray key = fingerprint(source);
+    const QByteArray payload = readEntry(sidecarPath(source, suffix), key);
+    if (!payload.isEmpty()) {
+        return payload;
+    }
+    return readEntry(cachePath(source, suffix), key);
+}
+
+bool MpvMediaCache::save(const QUrl &source, const QString &suffix, const QByteArray &payload)
+{
+    if (!source.isValid() || suffix.isEmpty() || payload.isEmpty()) {
+        return false;
+    }
+    const QByteArray key = fingerprint(source);
+    if (writeEntry(sidecarPath(source, suffix), key, payload)) {
+        return true;
+    }
+    const QString fallbackPath = cachePath(source, suffix);
+    if (fallbackPath.isEmpty() || !QDir().mkpath(QFileInfo(fallbackPath).absolutePath())) {
+        return false;
+    }
+    return writeEntry(fallbackPath, key, payload);
+}
+
+QString MpvMediaCache::sidecarPath(const QUrl &source, const QString &suffix)
+{
+    if (!source.isLocalFile()) {
+        return {};
+    }
+    const QFileInfo fileInfo(source.toLocalFile());
+    if (!fileInfo.exists()) {
+        return {};
+    }
+    return fileInfo.absoluteDir().filePath(fileInfo.fileName() + QLatin1Char('.') + suffix);
+}
+
+QString MpvMediaCache::cachePath(const QUrl &source, const QString &suffix)
+{
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (cacheDir.isEmpty()) {
+        return {};
+    }
+    // The fingerprint changes with the content, so hash the location alone
+    // here to make the new entry overwrite the stale one.
+    const QByteArray name = QCryptographicHash::hash(source.toString(QUrl::FullyEncoded).toUtf8(),
+                                                     QCryptographicHash::Sha1)
+                                .toHex();
+    return QDir(cacheDir).filePath(QString::fromUtf8("libmpv/%1.%2")
+                                       .arg(QString::fromUtf8(name), suffix));
+}
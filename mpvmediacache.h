@@ -0,0 +1,54 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QUrl>
+
+// Persists the results of expensive media analysis (waveforms, indexes,
+// etc) so that they are computed only once per file. Local files get a
+// sidecar file right next to them, eg: "movie.mkv.peaks", and everything
+// else (remote streams, read-only media) goes to the user's cache directory.
+// Every entry records the fingerprint of the media it was computed from and
+// is ignored once the media changes.
+class MpvMediaCache
+{
+public:
+    // Identifies the content of the given source: path, size and
+    // modification time for local files, the url for everything else.
+    static QByteArray fingerprint(const QUrl &source);
+
+    // Returns the payload stored for the given source under the given
+    // suffix, or an empty byte array if there is none or it's stale.
+    static QByteArray load(const QUrl &source, const QString &suffix);
+    // Writes the payload atomically, next to the media if possible,
+    // otherwise into the cache directory.
+    static bool save(const QUrl &source, const QString &suffix, const QByteArray &payload);
+
+private:
+    static QString sidecarPath(const QUrl &source, const QString &suffix);
+    static QString cachePath(const QUrl &source, const QString &suffix);
+};
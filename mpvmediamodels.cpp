@@ -0,0 +1,322 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvmediamodels.h"
+
+#include <QSet>
+#include <algorithm>
+
+namespace {
+
+// "demux-channel-count" -> "demuxChannelCount"
+QByteArray toRoleName(const QString &key)
+{
+    QString name = {};
+    name.reserve(key.size());
+    bool upper = false;
+    for (auto &&c : key) {
+        if (c == QLatin1Char('-')) {
+            upper = true;
+            continue;
+        }
+        name.append(upper ? c.toUpper() : c);
+        upper = false;
+    }
+    return name.toUtf8();
+}
+
+} // namespace
+
+MpvVariantListModel::MpvVariantListModel(const QStringList &keys, QObject *parent)
+    : QAbstractListModel(parent), m_keys(keys)
+{}
+
+MpvVariantListModel::~MpvVariantListModel() = default;
+
+int MpvVariantListModel::count() const
+{
+    return m_rows.size();
+}
+
+QList<QVariantHash> MpvVariantListModel::rows() const
+{
+    return m_rows;
+}
+
+QVariantMap MpvVariantListModel::get(const int row) const
+{
+    if ((row < 0) || (row >= m_rows.size())) {
+        return {};
+    }
+    QVariantMap map = {};
+    const QVariantHash &hash = m_rows.at(row);
+    for (auto &&key : qAsConst(m_keys)) {
+        if (hash.contains(key)) {
+            map.insert(QString::fromUtf8(toRoleName(key)), hash.value(key));
+        }
+    }
+    return map;
+}
+
+int MpvVariantListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+QVariant MpvVariantListModel::data(const QModelIndex &index, const int role) const
+{
+    if (!index.isValid() || (index.row() >= m_rows.size())) {
+        return QVariant();
+    }
+    const int keyIndex = role - Qt::UserRole - 1;
+    if ((keyIndex < 0) || (keyIndex >= m_keys.size())) {
+        return QVariant();
+    }
+    return m_rows.at(index.row()).value(m_keys.at(keyIndex));
+}
+
+QHash<int, QByteArray> MpvVariantListModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = {};
+    for (int i = 0; i != m_keys.size(); ++i) {
+        roles.insert(Qt::UserRole + 1 + i, toRoleName(m_keys.at(i)));
+    }
+    return roles;
+}
+
+bool MpvVariantListModel::setRows(const QList<QVariantHash> &rows, const QString &key)
+{
+    const int oldCount = m_rows.size();
+    bool changed = false;
+    // Replaces a row that is still there, if it differs.
+    const auto updateRow = [this, &rows, &changed](const int row, const int newRow) {
+        const QVariantHash &oldData = m_rows.at(row);
+        const QVariantHash &newData = rows.at(newRow);
+        if (oldData == newData) {
+            return;
+        }
+        QVector<int> roles = {};
+        for (int i = 0; i != m_keys.size(); ++i) {
+            if (oldData.value(m_keys.at(i)) != newData.value(m_keys.at(i))) {
+                roles.append(Qt::UserRole + 1 + i);
+            }
+        }
+        m_rows[row] = newData;
+        changed = true;
+        const QModelIndex modelIndex = index(row);
+        Q_EMIT dataChanged(modelIndex, modelIndex, roles);
+    };
+
+    if (key.isEmpty()) {
+        const int common = qMin(oldCount, rows.size());
+        for (int row = 0; row != common; ++row) {
+            updateRow(row, row);
+        }
+        if (rows.size() > oldCount) {
+            beginInsertRows(QModelIndex(), oldCount, rows.size() - 1);
+            m_rows.append(rows.mid(oldCount));
+            endInsertRows();
+        } else if (rows.size() < oldCount) {
+            beginRemoveRows(QModelIndex(), rows.size(), oldCount - 1);
+            m_rows.erase(m_rows.begin() + rows.size(), m_rows.end());
+            endRemoveRows();
+        }
+    } else {
+        QSet<QString> newKeys = {};
+        newKeys.reserve(rows.size());
+        for (auto &&row : qAsConst(rows)) {
+            newKeys.insert(row.value(key).toString());
+        }
+        // Removals first, in blocks, from the end so the rows don't shift.
+        int row = m_rows.size() - 1;
+        while (row >= 0) {
+            if (newKeys.contains(m_rows.at(row).value(key).toString())) {
+                --row;
+                continue;
+            }
+            int first = row;
+            while ((first > 0) && !newKeys.contains(m_rows.at(first - 1).value(key).toString())) {
+                --first;
+            }
+            beginRemoveRows(QModelIndex(), first, row);
+            m_rows.erase(m_rows.begin() + first, m_rows.begin() + row + 1);
+            endRemoveRows();
+            changed = true;
+            row = first - 1;
+        }
+        QSet<QString> oldKeys = {};
+        oldKeys.reserve(m_rows.size());
+        for (auto &&oldRow : qAsConst(m_rows)) {
+            oldKeys.insert(oldRow.value(key).toString());
+        }
+        for (int i = 0; i < rows.size(); ++i) {
+            const QString rowKey = rows.at(i).value(key).toString();
+            if ((i < m_rows.size()) && (m_rows.at(i).value(key).toString() == rowKey)) {
+                updateRow(i, i);
+                continue;
+            }
+            if (oldKeys.contains(rowKey)) {
+                // Tracks, chapters and tags don't get reordered in practice,
+                // don't bother finding the smallest set of moves.
+                beginResetModel();
+                m_rows = rows;
+                endResetModel();
+                changed = true;
+                break;
+            }
+            int last = i;
+            while (((last + 1) < rows.size())
+                   && !oldKeys.contains(rows.at(last + 1).value(key).toString())) {
+                ++last;
+            }
+            beginInsertRows(QModelIndex(), i, last);
+            for (int newRow = i; newRow <= last; ++newRow) {
+                m_rows.insert(newRow, rows.at(newRow));
+            }
+            endInsertRows();
+            changed = true;
+            i = last;
+        }
+    }
+    if (m_rows.size() != oldCount) {
+        Q_EMIT countChanged();
+        changed = true;
+    }
+    return changed;
+}
+
+MpvTrackModel::MpvTrackModel(QObject *parent)
+    : MpvVariantListModel(QStringList{QString::fromUtf8("id"),
+                                      QString::fromUtf8("type"),
+                                      QString::fromUtf8("src-id"),
+                                      QString::fromUtf8("title"),
+                                      QString::fromUtf8("lang"),
+                                      QString::fromUtf8("default"),
+                                      QString::fromUtf8("forced"),
+                                      QString::fromUtf8("codec"),
+                                      QString::fromUtf8("external"),
+                                      QString::fromUtf8("external-filename"),
+                                      QString::fromUtf8("selected"),
+                                      QString::fromUtf8("decoder-desc"),
+                                      QString::fromUtf8("albumart"),
+                                      QString::fromUtf8("demux-w"),
+                                      QString::fromUtf8("demux-h"),
+                                      QString::fromUtf8("demux-fps"),
+                                      QString::fromUtf8("demux-channel-count"),
+                                      QString::fromUtf8("demux-channels"),
+                                      QString::fromUtf8("demux-samplerate")},
+                          parent)
+{}
+
+MpvTrackModel::~MpvTrackModel() = default;
+
+bool MpvTrackModel::setTracks(const QList<QVariantHash> &tracks)
+{
+    // Track ids are unique per type.
+    return setRows(tracks, QString::fromUtf8("id"));
+}
+
+MpvChapterModel::MpvChapterModel(QObject *parent)
+    : MpvVariantListModel(QStringList{QString::fromUtf8("title"), QString::fromUtf8("time")},
+                          parent)
+{}
+
+MpvChapterModel::~MpvChapterModel() = default;
+
+int MpvChapterModel::currentIndex() const
+{
+    return m_currentIndex;
+}
+
+int MpvChapterModel::indexAt(const qreal position) const
+{
+    const auto iterator = std::upper_bound(m_times.cbegin(), m_times.cend(), position);
+    return static_cast<int>(iterator - m_times.cbegin()) - 1;
+}
+
+bool MpvChapterModel::setChapters(const QList<QVariantHash> &chapters)
+{
+    QList<QVariantHash> sortedChapters = chapters;
+    const auto time = [](const QVariantHash &chapter) {
+        return chapter.value(QString::fromUtf8("time")).toReal();
+    };
+    std::stable_sort(sortedChapters.begin(),
+                     sortedChapters.end(),
+                     [&time](const QVariantHash &lhs, const QVariantHash &rhs) {
+                         return time(lhs) < time(rhs);
+                     });
+    m_times.clear();
+    m_times.reserve(sortedChapters.size());
+    for (auto &&chapter : qAsConst(sortedChapters)) {
+        m_times.append(time(chapter));
+    }
+    // Chapters have no identity other than their position.
+    const bool changed = setRows(sortedChapters);
+    updateCurrentIndex();
+    return changed;
+}
+
+void MpvChapterModel::setPosition(const qreal position)
+{
+    m_position = position;
+    updateCurrentIndex();
+}
+
+void MpvChapterModel::updateCurrentIndex()
+{
+    const int currentIndex = indexAt(m_position);
+    if (currentIndex == m_currentIndex) {
+        return;
+    }
+    m_currentIndex = currentIndex;
+    Q_EMIT currentIndexChanged();
+}
+
+MpvMetadataModel::MpvMetadataModel(QObject *parent)
+    : MpvVariantListModel(QStringList{QString::fromUtf8("key"), QString::fromUtf8("value")},
+                          parent)
+{}
+
+MpvMetadataModel::~MpvMetadataModel() = default;
+
+QVariantHash MpvMetadataModel::metadata() const
+{
+    return m_metadata;
+}
+
+bool MpvMetadataModel::setMetadata(const QVariantMap &metadata)
+{
+    QList<QVariantHash> rows = {};
+    rows.reserve(metadata.size());
+    m_metadata.clear();
+    // QVariantMap is sorted by key already.
+    auto iterator = metadata.cbegin();
+    while (iterator != metadata.cend()) {
+        rows.append(QVariantHash{{QString::fromUtf8("key"), iterator.key()},
+                                 {QString::fromUtf8("value"), iterator.value()}});
+        m_metadata.insert(iterator.key(), iterator.value());
+        ++iterator;
+    }
+    return setRows(rows, QString::fromUtf8("key"));
+}
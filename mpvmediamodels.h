@@ -0,0 +1,147 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <QAbstractListModel>
+#include <QStringList>
+#include <QVector>
+#include <QtQml/qqml.h>
+
+// Base of the list models MpvObject keeps up to date from the properties it
+// observes. Every row is a QVariantHash, and each of its keys is exposed as
+// a role, in camel case (eg: "demux-w" becomes "demuxW"). New rows are
+// matched against the current ones, so only the rows that actually changed
+// are signaled to the views.
+class MpvVariantListModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ANONYMOUS
+    Q_DISABLE_COPY_MOVE(MpvVariantListModel)
+
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    ~MpvVariantListModel() override;
+
+    int count() const;
+    // Shares the data of the model, no conversion involved.
+    QList<QVariantHash> rows() const;
+    // The row as a JavaScript object, eg: for menus.
+    Q_INVOKABLE QVariantMap get(const int row) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, const int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+Q_SIGNALS:
+    void countChanged();
+
+protected:
+    explicit MpvVariantListModel(const QStringList &keys, QObject *parent = nullptr);
+
+    // Rows are matched by the value of the given key, or by position if
+    // there's none. Returns whether anything changed.
+    bool setRows(const QList<QVariantHash> &rows, const QString &key = QString());
+
+private:
+    // Role Qt::UserRole + 1 + i is keys[i].
+    QStringList m_keys = {};
+    QList<QVariantHash> m_rows = {};
+};
+
+// The video, audio or subtitle tracks of the current file.
+class MpvTrackModel : public MpvVariantListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("Provided by MpvObject.")
+    Q_DISABLE_COPY_MOVE(MpvTrackModel)
+
+public:
+    explicit MpvTrackModel(QObject *parent = nullptr);
+    ~MpvTrackModel() override;
+
+    // The tracks of the "track-list" property, already filtered by type.
+    bool setTracks(const QList<QVariantHash> &tracks);
+};
+
+// The chapters of the current file, sorted by time.
+class MpvChapterModel : public MpvVariantListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("Provided by MpvObject.")
+    Q_DISABLE_COPY_MOVE(MpvChapterModel)
+
+    Q_PROPERTY(int currentIndex READ currentIndex NOTIFY currentIndexChanged)
+
+public:
+    explicit MpvChapterModel(QObject *parent = nullptr);
+    ~MpvChapterModel() override;
+
+    // The chapter being played, -1 before the first one (or if there are
+    // no chapters).
+    int currentIndex() const;
+    // The chapter a position (in seconds) belongs to, found with a binary
+    // search.
+    Q_INVOKABLE int indexAt(const qreal position) const;
+
+    bool setChapters(const QList<QVariantHash> &chapters);
+    // Called whenever the playback position changes, cheap.
+    void setPosition(const qreal position);
+
+Q_SIGNALS:
+    void currentIndexChanged();
+
+private:
+    void updateCurrentIndex();
+
+private:
+    // Start time of every chapter, in ascending order.
+    QVector<qreal> m_times = {};
+    qreal m_position = 0.0;
+    int m_currentIndex = -1;
+};
+
+// The metadata of the current file, one row per tag ("key" and "value"
+// roles), sorted by key.
+class MpvMetadataModel : public MpvVariantListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("Provided by MpvObject.")
+    Q_DISABLE_COPY_MOVE(MpvMetadataModel)
+
+public:
+    explicit MpvMetadataModel(QObject *parent = nullptr);
+    ~MpvMetadataModel() override;
+
+    QVariantHash metadata() const;
+
+    bool setMetadata(const QVariantMap &metadata);
+
+private:
+    QVariantHash m_metadata = {};
+};
@@ -23,14 +23,22 @@
  */
 
 #include "mpvobject.h"
+#include "mpvframetap.h"
+#include "mpvperformancemonitor.h"
+#include "mpvresourcescheduler.h"
+#include "mpvstreamprotocol.h"
+#include "mpvtracer.h"
 
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
+#include <QOpenGLBuffer>
 #include <QOpenGLContext>
 #include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
 #include <QQuickWindow>
 #include <QTime>
+#include <vector>
 #if defined(Q_OS_LINUX) && !defined(Q_OS_ANDROID)
 #include <QGuiApplication>
 #include <QX11Info>
@@ -40,30 +48,10 @@
 #endif
 
 Q_LOGGING_CATEGORY(lcMpv, "libmpv.general")
-Q_LOGGING_CATEGORY(lcMpvLog, "libmpv.log.general")
 Q_LOGGING_CATEGORY(lcMpvEvent, "libmpv.event.general")
-Q_LOGGING_CATEGORY(lcMpvCommand, "libmpv.command.general")
-Q_LOGGING_CATEGORY(lcMpvProperty, "libmpv.property.general")
-Q_LOGGING_CATEGORY(lcMpvMisc, "libmpv.misc.general")
 
 namespace {
 
-const char m_libmpvPathEnvVarName[] = "WWX190_LIBMPV_PATH";
-
-QString getLibmpvPath()
-{
-    return qEnvironmentVariable(m_libmpvPathEnvVarName, QString::fromUtf8("mpv"));
-}
-
-void wakeup(void *ctx)
-{
-    // This callback is invoked from any mpv thread (but possibly also
-    // recursively from a thread that is calling the mpv API). Just notify
-    // the Qt GUI thread to wake up (so that it can process events with
-    // mpv_wait_event()), and return as quickly as possible.
-    QMetaObject::invokeMethod(static_cast<MpvObject *>(ctx), "hasMpvEvents", Qt::QueuedConnection);
-}
-
 void on_mpv_redraw(void *ctx)
 {
     MpvObject::on_update(ctx);
@@ -81,6 +69,133 @@ QString timeToString(const qint64 ss)
     return QTime(0, 0).addSecs(ss).toString(QString::fromUtf8("hh:mm:ss"));
 }
 
+// What loadfile expects.
+QString urlToMpvPath(const QUrl &url)
+{
+    // Qt resources are read through our own stream protocol.
+    if (url.scheme() == QString::fromUtf8("qrc")) {
+        return MpvStreamProtocol::resourceUrl(url).toString();
+    }
+    return url.isLocalFile() ? QDir::toNativeSeparators(url.toLocalFile()) : url.url();
+}
+
+// Only keeps what we're interested in.
+MpvObject::MediaTracks toMediaTracks(const QVariantList &trackList)
+{
+    MpvObject::MediaTracks mediaTracks;
+    for (auto &&track : qAsConst(trackList)) {
+        const auto trackInfo = track.toMap();
+        if ((trackInfo[QString::fromUtf8("type")] != QString::fromUtf8("video"))
+            && (trackInfo[QString::fromUtf8("type")] != QString::fromUtf8("audio"))
+            && (trackInfo[QString::fromUtf8("type")] != QString::fromUtf8("sub"))) {
+            continue;
+        }
+        QVariantHash singleTrackInfo;
+        singleTrackInfo[QString::fromUtf8("id")] = trackInfo[QString::fromUtf8("id")];
+        singleTrackInfo[QString::fromUtf8("type")] = trackInfo[QString::fromUtf8("type")];
+        singleTrackInfo[QString::fromUtf8("src-id")] = trackInfo[QString::fromUtf8("src-id")];
+        if (trackInfo[QString::fromUtf8("title")].toString().isEmpty()) {
+            if (trackInfo[QString::fromUtf8("lang")].toString() != QString::fromUtf8("und")) {
+                singleTrackInfo[QString::fromUtf8("title")] = trackInfo[QString::fromUtf8("lang")];
+            } else if (!trackInfo[QString::fromUtf8("external")].toBool()) {
+                singleTrackInfo[QString::fromUtf8("title")] = QString::fromUtf8("[internal]");
+            } else {
+                singleTrackInfo[QString::fromUtf8("title")] = QString::fromUtf8("[untitled]");
+            }
+        } else {
+            singleTrackInfo[QString::fromUtf8("title")] = trackInfo[QString::fromUtf8("title")];
+        }
+        singleTrackInfo[QString::fromUtf8("lang")] = trackInfo[QString::fromUtf8("lang")];
+        singleTrackInfo[QString::fromUtf8("default")] = trackInfo[QString::fromUtf8("default")];
+        singleTrackInfo[QString::fromUtf8("forced")] = trackInfo[QString::fromUtf8("forced")];
+        singleTrackInfo[QString::fromUtf8("codec")] = trackInfo[QString::fromUtf8("codec")];
+        singleTrackInfo[QString::fromUtf8("external")] = trackInfo[QString::fromUtf8("external")];
+        singleTrackInfo[QString::fromUtf8("external-filename")]
+            = trackInfo[QString::fromUtf8("external-filename")];
+        singleTrackInfo[QString::fromUtf8("selected")] = trackInfo[QString::fromUtf8("selected")];
+        singleTrackInfo[QString::fromUtf8("decoder-desc")]
+            = trackInfo[QString::fromUtf8("decoder-desc")];
+        if (trackInfo[QString::fromUtf8("type")] == QString::fromUtf8("video")) {
+            singleTrackInfo[QString::fromUtf8("albumart")]
+                = trackInfo[QString::fromUtf8("albumart")];
+            singleTrackInfo[QString::fromUtf8("demux-w")] = trackInfo[QString::fromUtf8("demux-w")];
+            singleTrackInfo[QString::fromUtf8("demux-h")] = trackInfo[QString::fromUtf8("demux-h")];
+            singleTrackInfo[QString::fromUtf8("demux-fps")]
+                = trackInfo[QString::fromUtf8("demux-fps")];
+            mediaTracks.videoChannels.append(singleTrackInfo);
+        } else if (trackInfo[QString::fromUtf8("type")] == QString::fromUtf8("audio")) {
+            singleTrackInfo[QString::fromUtf8("demux-channel-count")]
+                = trackInfo[QString::fromUtf8("demux-channel-count")];
+            singleTrackInfo[QString::fromUtf8("demux-channels")]
+                = trackInfo[QString::fromUtf8("demux-channels")];
+            singleTrackInfo[QString::fromUtf8("demux-samplerate")]
+                = trackInfo[QString::fromUtf8("demux-samplerate")];
+            mediaTracks.audioTracks.append(singleTrackInfo);
+        } else if (trackInfo[QString::fromUtf8("type")] == QString::fromUtf8("sub")) {
+            mediaTracks.subtitleStreams.append(singleTrackInfo);
+        }
+    }
+    return mediaTracks;
+}
+
+MpvObject::Chapters toChapters(const QVariantList &chapterList)
+{
+    MpvObject::Chapters chapters;
+    for (auto &&chapter : qAsConst(chapterList)) {
+        const auto chapterInfo = chapter.toMap();
+        QVariantHash singleTrackInfo;
+        singleTrackInfo[QString::fromUtf8("title")] = chapterInfo[QString::fromUtf8("title")];
+        singleTrackInfo[QString::fromUtf8("time")] = chapterInfo[QString::fromUtf8("time")];
+        chapters.append(singleTrackInfo);
+    }
+    return chapters;
+}
+
+// The opposite, for the file names of the playlist entries.
+QUrl mpvPathToUrl(const QString &path)
+{
+    const QUrl resource = MpvStreamProtocol::resourceFromUrl(QUrl(path));
+    if (resource.isValid()) {
+        return resource;
+    }
+    return QUrl::fromUserInput(path, QString(), QUrl::AssumeLocalFile);
+}
+
+// What the low latency mode sets, mostly mpv's own "low-latency" profile.
+// Two things are deliberately left alone: --vd-lavc-threads, which belongs
+// to MpvResourceScheduler, and the demuxer readahead, because a demuxer
+// that stops reading only moves the backlog into the socket buffers, where
+// it can't be dropped.
+QVariantMap lowLatencyOptions()
+{
+    return QVariantMap{{QString::fromUtf8("cache"), QString::fromUtf8("no")},
+                       {QString::fromUtf8("cache-pause"), false},
+                       {QString::fromUtf8("stream-buffer-size"), QString::fromUtf8("4KiB")},
+                       {QString::fromUtf8("demuxer-lavf-o"),
+                        QString::fromUtf8("fflags=+nobuffer")},
+                       {QString::fromUtf8("demuxer-lavf-probe-info"),
+                        QString::fromUtf8("nostreams")},
+                       {QString::fromUtf8("demuxer-lavf-analyzeduration"), 0.1},
+                       {QString::fromUtf8("demuxer-lavf-probesize"), 32768},
+                       {QString::fromUtf8("video-sync"), QString::fromUtf8("audio")},
+                       {QString::fromUtf8("video-latency-hacks"), true},
+                       {QString::fromUtf8("framedrop"), QString::fromUtf8("decoder+vo")},
+                       {QString::fromUtf8("interpolation"), false},
+                       {QString::fromUtf8("audio-buffer"), 0.0},
+                       // Set per file, see MPV_EVENT_FILE_LOADED.
+                       {QString::fromUtf8("untimed"), false}};
+}
+
+// How much faster playback gets while catching up with the live edge.
+const qreal m_catchUpFactor = 1.1;
+
+// A target this close to a keyframe is reached exactly by a keyframe seek,
+// in seconds.
+const qreal m_keyframeTolerance = 0.005;
+// Keyframe seeks go to the last keyframe before the target, aim a little
+// after the keyframe so that rounding can't make it the previous one.
+const qreal m_keyframeSeekMargin = 0.001;
+
 } // namespace
 
 class MpvRenderer : public QQuickFramebufferObject::Renderer
@@ -95,37 +210,44 @@ public:
     // This happens on the initial frame.
     QOpenGLFramebufferObject *createFramebufferObject(const QSize &size) override
     {
-        // init mpv_gl:
-        if (!m_player->m_mpvGL) {
-            mpv_opengl_init_params gl_init_params{get_proc_address_mpv, nullptr, nullptr};
-            mpv_render_param params[]{{MPV_RENDER_PARAM_API_TYPE,
-                                       const_cast<char *>(MPV_RENDER_API_TYPE_OPENGL)},
-                                      {MPV_RENDER_PARAM_OPENGL_INIT_PARAMS, &gl_init_params},
-                                      {MPV_RENDER_PARAM_INVALID, nullptr},
-                                      {MPV_RENDER_PARAM_INVALID, nullptr}};
-#if defined(Q_OS_LINUX) && !defined(Q_OS_ANDROID)
-            if (QGuiApplication::platformName().contains("xcb", Qt::CaseInsensitive)) {
-                params[2].type = MPV_RENDER_PARAM_X11_DISPLAY;
-                params[2].data = QX11Info::display();
-            }
-#endif
-
-            const int mpvGLInitResult = mpv::qt::render_context_create(&m_player->m_mpvGL,
-                                                                       m_player->m_mpv,
-                                                                       params);
-            Q_ASSERT_X(mpvGLInitResult >= 0,
-                       __FUNCTION__,
-                       qUtf8Printable(mpv::qt::error_string(mpvGLInitResult)));
-            mpv::qt::render_context_set_update_callback(m_player->m_mpvGL, on_mpv_redraw, m_player);
+        const MpvTraceScope trace("createFramebufferObject", "render");
+        return QQuickFramebufferObject::Renderer::createFramebufferObject(scaledSize(size));
+    }
 
-            QMetaObject::invokeMethod(m_player, "initFinished");
+    // Called with the GUI thread blocked, so it's safe to access the player.
+    void synchronize(QQuickFramebufferObject *item) override
+    {
+        // A scaled down FBO doesn't follow the size of the item, it's
+        // recreated here instead.
+        const QOpenGLFramebufferObject *fbo = framebufferObject();
+        if (!qFuzzyCompare(m_renderScale, m_player->currentRenderScale)) {
+            m_renderScale = m_player->currentRenderScale;
+            invalidateFramebufferObject();
+        } else if (fbo && item->window() && !item->textureFollowsItemSize()) {
+            const QSize itemSize = QSize(static_cast<int>(item->width()),
+                                         static_cast<int>(item->height()))
+                                   * item->window()->effectiveDevicePixelRatio();
+            if (fbo->size() != scaledSize(itemSize)) {
+                invalidateFramebufferObject();
+            }
         }
-
-        return QQuickFramebufferObject::Renderer::createFramebufferObject(size);
+        // The handle of an asynchronous player may not exist yet, the item
+        // is updated again once it does.
+        if (!m_player->m_mpvGL && m_player->m_core->handle()) {
+            createRenderContext();
+        }
+        m_frameTap = m_player->m_frameTap;
+        m_latency = m_player->m_latency;
+        m_renderTimings = m_player->m_renderTimings;
+        m_timePos = m_player->currentTimePos;
     }
 
     void render() override
     {
+        if (!m_player->m_mpvGL) {
+            return;
+        }
+        const MpvTraceScope trace("render", "render");
 #if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
         QQuickOpenGLUtils::resetOpenGLState();
 #else
@@ -150,7 +272,21 @@ public:
                                      {MPV_RENDER_PARAM_INVALID, nullptr}};
         // See render_gl.h on what OpenGL environment mpv expects, and
         // other API details.
+        QElapsedTimer renderTimer;
+        if (m_renderTimings) {
+            renderTimer.start();
+        }
         mpv::qt::render_context_render(m_player->m_mpvGL, params);
+        if (m_renderTimings) {
+            m_renderTimings->add(renderTimer.nsecsElapsed());
+        }
+
+        if (m_frameTap && m_frameTap->wantsFrame()) {
+            tapFrame(fbo);
+        }
+        if (m_latency && m_latency->wantsFrame()) {
+            m_latency->frameRendered();
+        }
 
 #if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
         QQuickOpenGLUtils::resetOpenGLState();
@@ -160,50 +296,486 @@ public:
     }
 
 private:
-    MpvObject *m_player = nullptr;
-};
+    QSize scaledSize(const QSize &size) const
+    {
+        return (QSizeF(size) * m_renderScale).toSize().expandedTo(QSize(1, 1));
+    }
 
-MpvObject::MpvObject(QQuickItem *parent) : QQuickFramebufferObject(parent)
-{
-    mpv::qt::libmpv_init(getLibmpvPath());
+    // Called on the render thread, with the OpenGL context current.
+    void createRenderContext()
+    {
+        mpv_opengl_init_params gl_init_params{get_proc_address_mpv, nullptr, nullptr};
+        mpv_render_param params[]{{MPV_RENDER_PARAM_API_TYPE,
+                                   const_cast<char *>(MPV_RENDER_API_TYPE_OPENGL)},
+                                  {MPV_RENDER_PARAM_OPENGL_INIT_PARAMS, &gl_init_params},
+                                  {MPV_RENDER_PARAM_INVALID, nullptr},
+                                  {MPV_RENDER_PARAM_INVALID, nullptr}};
+#if defined(Q_OS_LINUX) && !defined(Q_OS_ANDROID)
+        if (QGuiApplication::platformName().contains("xcb", Qt::CaseInsensitive)) {
+            params[2].type = MPV_RENDER_PARAM_X11_DISPLAY;
+            params[2].data = QX11Info::display();
+        }
+#endif
 
-    m_mpv = mpv::qt::create();
-    Q_ASSERT(m_mpv);
+        const int mpvGLInitResult = mpv::qt::render_context_create(&m_player->m_mpvGL,
+                                                                   m_player->m_core->handle(),
+                                                                   params);
+        Q_ASSERT_X(mpvGLInitResult >= 0,
+                   __FUNCTION__,
+                   qUtf8Printable(mpv::qt::error_string(mpvGLInitResult)));
+        mpv::qt::render_context_set_update_callback(m_player->m_mpvGL, on_mpv_redraw, m_player);
 
-    qRegisterMetaType<MediaTracks>();
+        QMetaObject::invokeMethod(m_player, "initFinished");
+    }
 
-    mpvSetProperty(QString::fromUtf8("input-default-bindings"), false);
-    mpvSetProperty(QString::fromUtf8("input-vo-keyboard"), false);
-    mpvSetProperty(QString::fromUtf8("input-cursor"), false);
-    mpvSetProperty(QString::fromUtf8("cursor-autohide"), false);
+    // The pixels are read into one of two pixel buffer objects and only
+    // mapped when the next frame is tapped, by which time the GPU has long
+    // finished the copy, so the render thread never waits for it. Frames are
+    // therefore delivered one tapped frame late. Without PBOs (OpenGL ES 2)
+    // it falls back to a synchronous glReadPixels().
+    void tapFrame(QOpenGLFramebufferObject *fbo)
+    {
+        const int width = fbo->width();
+        const int height = fbo->height();
+        const QOpenGLContext *const context = QOpenGLContext::currentContext();
+        if (context->isOpenGLES() && (context->format().majorVersion() < 3)) {
+            readFrameSync(fbo);
+            return;
+        }
+        ReadbackBuffer &current = m_readbackBuffers[m_readbackIndex];
+        const int size = width * height * 4;
+        if (!current.buffer.isCreated()) {
+            current.buffer = QOpenGLBuffer(QOpenGLBuffer::PixelPackBuffer);
+            current.buffer.setUsagePattern(QOpenGLBuffer::StreamRead);
+            if (!current.buffer.create()) {
+                readFrameSync(fbo);
+                return;
+            }
+        }
+        current.buffer.bind();
+        if (current.buffer.size() != size) {
+            current.buffer.allocate(size);
+        }
+        // GL_RGBA is the only format that is guaranteed to be readable on
+        // both desktop OpenGL and OpenGL ES, the tap does the conversion.
+        // With a pixel pack buffer bound, the last argument is an offset
+        // into it and the call returns without waiting for the GPU.
+        fbo->bind();
+        context->functions()->glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        fbo->release();
+        current.buffer.release();
+        current.size = QSize(width, height);
+        current.pts = m_timePos;
+        current.pending = true;
+
+        m_readbackIndex = (m_readbackIndex + 1) % 2;
+        ReadbackBuffer &previous = m_readbackBuffers[m_readbackIndex];
+        if (!previous.pending) {
+            return;
+        }
+        previous.pending = false;
+        previous.buffer.bind();
+        const int previousSize = previous.size.width() * previous.size.height() * 4;
+        void *pixels = previous.buffer.mapRange(0, previousSize, QOpenGLBuffer::RangeRead);
+        if (!pixels && !context->isOpenGLES()) {
+            pixels = previous.buffer.map(QOpenGLBuffer::ReadOnly);
+        }
+        if (pixels) {
+            m_frameTap->pushRgbaFrame(static_cast<const uchar *>(pixels),
+                                      previous.size.width(),
+                                      previous.size.height(),
+                                      true,
+                                      previous.pts);
+            previous.buffer.unmap();
+        }
+        previous.buffer.release();
+    }
 
-    auto iterator = properties.cbegin();
-    while (iterator != properties.cend()) {
-        mpvObserveProperty(iterator.key());
-        ++iterator;
+    void readFrameSync(QOpenGLFramebufferObject *fbo)
+    {
+        const int width = fbo->width();
+        const int height = fbo->height();
+        const auto size = static_cast<size_t>(width) * height * 4;
+        if (m_readbackData.size() != size) {
+            m_readbackData.resize(size);
+        }
+        fbo->bind();
+        QOpenGLContext::currentContext()->functions()->glReadPixels(0,
+                                                                    0,
+                                                                    width,
+                                                                    height,
+                                                                    GL_RGBA,
+                                                                    GL_UNSIGNED_BYTE,
+                                                                    m_readbackData.data());
+        fbo->release();
+        m_frameTap->pushRgbaFrame(m_readbackData.data(), width, height, true, m_timePos);
     }
 
-    // From this point on, the wakeup function will be called. The callback
-    // can come from any thread, so we use the QueuedConnection mechanism to
-    // relay the wakeup in a thread-safe way.
-    connect(this, &MpvObject::hasMpvEvents, this, &MpvObject::handleMpvEvents, Qt::QueuedConnection);
-    mpv::qt::set_wakeup_callback(m_mpv, wakeup, this);
+private:
+    MpvObject *m_player = nullptr;
+    QSharedPointer<MpvFrameTap> m_frameTap;
+    // Owned by the player, which outlives the renderer.
+    MpvLatencyTracker *m_latency = nullptr;
+    QSharedPointer<MpvRenderTimings> m_renderTimings;
+    qreal m_timePos = 0.0;
+    qreal m_renderScale = 1.0;
+
+    struct ReadbackBuffer
+    {
+        QOpenGLBuffer buffer;
+        QSize size = {};
+        qreal pts = 0.0;
+        bool pending = false;
+    };
+    ReadbackBuffer m_readbackBuffers[2];
+    int m_readbackIndex = 0;
+    std::vector<uchar> m_readbackData = {};
+};
 
-    const int mpvInitResult = mpv::qt::initialize(m_mpv);
-    Q_ASSERT_X(mpvInitResult >= 0,
-               __FUNCTION__,
-               qUtf8Printable(mpv::qt::error_string(mpvInitResult)));
+MpvObject::MpvObject(QQuickItem *parent)
+    : QQuickFramebufferObject(parent), m_core(new MpvCore(this)),
+      m_videoTrackModel(new MpvTrackModel(this)), m_audioTrackModel(new MpvTrackModel(this)),
+      m_subtitleTrackModel(new MpvTrackModel(this)), m_chapterModel(new MpvChapterModel(this)),
+      m_metadataModel(new MpvMetadataModel(this)), m_cacheTelemetry(new MpvCacheTelemetry(this)),
+      m_latency(new MpvLatencyTracker(this)), m_logSink(new MpvLogSink(this))
+{
+    qRegisterMetaType<MediaTracks>();
 
+    // We render the video ourselves.
+    m_core->setVideoOutput(true);
+    connect(m_core, &MpvCore::eventReceived, this, &MpvObject::handleMpvEvent);
+    connect(m_core, &MpvCore::propertyChanged, this, &MpvObject::processMpvPropertyChange);
+    connect(m_core, &MpvCore::queueOverflowsChanged, this, &MpvObject::queueOverflowsChanged);
+    connect(m_core, &MpvCore::readyChanged, this, [this]() {
+        Q_EMIT readyChanged();
+        // Let the renderer create the render context.
+        update();
+    });
     connect(this, &MpvObject::onUpdate, this, &MpvObject::doUpdate, Qt::QueuedConnection);
+    // A scaled down FBO doesn't follow the size of the item by itself.
+    const auto updateScaledSize = [this]() {
+        if (!textureFollowsItemSize()) {
+            update();
+        }
+    };
+    connect(this, &QQuickItem::widthChanged, this, updateScaledSize);
+    connect(this, &QQuickItem::heightChanged, this, updateScaledSize);
+    m_liveLatencyTimer.setInterval(250);
+    connect(&m_liveLatencyTimer, &QTimer::timeout, this, &MpvObject::updateLiveLatency);
+
+    if (MpvResourceScheduler *scheduler = MpvResourceScheduler::instance()) {
+        scheduler->registerPlayer(this);
+    }
+
+    // Players created by the QML engine are initialized in
+    // componentComplete(), once we know whether it should happen
+    // asynchronously. The others are initialized on first use, or as soon as
+    // the event loop runs.
+    QMetaObject::invokeMethod(
+        this,
+        [this]() {
+            if (m_core->autoInitialize()) {
+                m_core->initialize();
+            }
+        },
+        Qt::QueuedConnection);
 }
 
 MpvObject::~MpvObject()
 {
+    if (MpvResourceScheduler *scheduler = MpvResourceScheduler::instance()) {
+        scheduler->unregisterPlayer(this);
+    }
     // only initialized if something got drawn
     if (m_mpvGL) {
         mpv::qt::render_context_free(m_mpvGL);
     }
-    mpv::qt::terminate_destroy(m_mpv);
+    // The core, and the handle with it, goes away with the children.
+}
+
+void MpvObject::classBegin()
+{
+    QQuickFramebufferObject::classBegin();
+    m_core->setAutoInitialize(false);
+}
+
+void MpvObject::componentComplete()
+{
+    QQuickFramebufferObject::componentComplete();
+    m_core->setAutoInitialize(true);
+    if (currentAsynchronous) {
+        m_core->initializeAsynchronously();
+    } else {
+        m_core->initialize();
+    }
+}
+
+bool MpvObject::asynchronous() const
+{
+    return currentAsynchronous;
+}
+
+bool MpvObject::ready() const
+{
+    return m_core->ready();
+}
+
+MpvCore *MpvObject::core() const
+{
+    return m_core;
+}
+
+void MpvObject::setAsynchronous(const bool asynchronous)
+{
+    if (asynchronous == currentAsynchronous) {
+        return;
+    }
+    currentAsynchronous = asynchronous;
+    Q_EMIT asynchronousChanged();
+}
+
+void MpvObject::setPlaylistIndex(const int playlistIndex)
+{
+    if ((playlistIndex < 0) || (playlistIndex >= currentPlaylist.size())
+        || (ready() && (playlistIndex == this->playlistIndex()))) {
+        return;
+    }
+    // play-dir outlives the file, the next one must not open backward.
+    stopSteppingBackward();
+    mpvSetProperty(QString::fromUtf8("playlist-pos"), playlistIndex);
+}
+
+void MpvObject::setGapless(const bool gapless)
+{
+    if (ready() && (gapless == this->gapless())) {
+        return;
+    }
+    mpvSetProperty(QString::fromUtf8("gapless-audio"),
+                   gapless ? QString::fromUtf8("yes") : QString::fromUtf8("no"));
+}
+
+void MpvObject::setPrefetchPlaylist(const bool prefetchPlaylist)
+{
+    if (ready() && (prefetchPlaylist == this->prefetchPlaylist())) {
+        return;
+    }
+    mpvSetProperty(QString::fromUtf8("prefetch-playlist"), prefetchPlaylist);
+}
+
+void MpvObject::setPriority(const Priority priority)
+{
+    if (priority == currentPriority) {
+        return;
+    }
+    currentPriority = priority;
+    Q_EMIT priorityChanged();
+}
+
+void MpvObject::setRenderScale(const qreal renderScale)
+{
+    const qreal scale = qBound(0.1, renderScale, 1.0);
+    if (qFuzzyCompare(scale, currentRenderScale)) {
+        return;
+    }
+    currentRenderScale = scale;
+    setTextureFollowsItemSize(qFuzzyCompare(currentRenderScale, 1.0));
+    update();
+    Q_EMIT renderScaleChanged();
+}
+
+void MpvObject::setDemuxerMaxBytes(const qint64 demuxerMaxBytes)
+{
+    if (ready() && (demuxerMaxBytes == this->demuxerMaxBytes())) {
+        return;
+    }
+    mpvSetProperty(QString::fromUtf8("demuxer-max-bytes"), qMax(demuxerMaxBytes, qint64(0)));
+}
+
+void MpvObject::setDemuxerMaxBackBytes(const qint64 demuxerMaxBackBytes)
+{
+    if (ready() && (demuxerMaxBackBytes == this->demuxerMaxBackBytes())) {
+        return;
+    }
+    mpvSetProperty(QString::fromUtf8("demuxer-max-back-bytes"),
+                   qMax(demuxerMaxBackBytes, qint64(0)));
+}
+
+void MpvObject::setLowLatency(const bool lowLatency)
+{
+    if (lowLatency == currentLowLatency) {
+        return;
+    }
+    currentLowLatency = lowLatency;
+    if (!currentLowLatency) {
+        m_liveLatencyTimer.stop();
+        setCatchingUp(false);
+        if (!qFuzzyIsNull(currentLiveLatency)) {
+            currentLiveLatency = 0.0;
+            Q_EMIT liveLatencyChanged();
+        }
+    }
+    applyLowLatencyOptions();
+    if (currentLowLatency) {
+        m_liveLatencyTimer.start();
+    }
+    Q_EMIT lowLatencyChanged();
+}
+
+void MpvObject::setTargetLatency(const qreal targetLatency)
+{
+    const qreal latency = qMax(targetLatency, 0.0);
+    if (qFuzzyCompare(latency, currentTargetLatency)) {
+        return;
+    }
+    currentTargetLatency = latency;
+    Q_EMIT targetLatencyChanged();
+}
+
+void MpvObject::setMaxLatency(const qreal maxLatency)
+{
+    const qreal latency = qMax(maxLatency, 0.0);
+    if (qFuzzyCompare(latency, currentMaxLatency)) {
+        return;
+    }
+    currentMaxLatency = latency;
+    Q_EMIT maxLatencyChanged();
+}
+
+void MpvObject::setStepCacheBytes(const qint64 stepCacheBytes)
+{
+    const qint64 bytes = qMax(stepCacheBytes, qint64(0));
+    if (bytes == currentStepCacheBytes) {
+        return;
+    }
+    currentStepCacheBytes = bytes;
+    if (m_steppingBackward) {
+        if (currentStepCacheBytes > 0) {
+            mpvSetProperty(QString::fromUtf8("video-reversal-buffer"), currentStepCacheBytes);
+        } else {
+            stopSteppingBackward();
+        }
+    }
+    Q_EMIT stepCacheBytesChanged();
+}
+
+void MpvObject::setKeyframeIndex(MpvKeyframeIndex *keyframeIndex)
+{
+    if (keyframeIndex == currentKeyframeIndex) {
+        return;
+    }
+    currentKeyframeIndex = keyframeIndex;
+    Q_EMIT keyframeIndexChanged();
+}
+
+void MpvObject::setScrubbing(const bool scrubbing)
+{
+    if (scrubbing == currentScrubbing) {
+        return;
+    }
+    currentScrubbing = scrubbing;
+    if (!currentScrubbing && (m_pendingExactSeek >= 0.0)) {
+        const qreal target = m_pendingExactSeek;
+        m_pendingExactSeek = -1.0;
+        if (!isStopped()) {
+            const bool latencyStarted = m_latency->seekStarted();
+            if (!mpvSendCommand(QVariantList{QString::fromUtf8("seek"),
+                                             target,
+                                             QString::fromUtf8("absolute+exact")})
+                && latencyStarted) {
+                m_latency->cancelSeek();
+            }
+        }
+    }
+    Q_EMIT scrubbingChanged();
+}
+
+void MpvObject::stopSteppingBackward()
+{
+    if (!m_steppingBackward) {
+        return;
+    }
+    m_steppingBackward = false;
+    mpvSetProperty(QString::fromUtf8("play-dir"), QString::fromUtf8("forward"));
+}
+
+void MpvObject::applyLowLatencyOptions()
+{
+    if (currentLowLatency) {
+        const QVariantMap options = lowLatencyOptions();
+        m_savedLatencyOptions.clear();
+        auto iterator = options.cbegin();
+        while (iterator != options.cend()) {
+            bool ok = false;
+            const QVariant value = mpvGetProperty(iterator.key(), true, &ok);
+            m_savedLatencyOptions.insert(iterator.key(), ok ? value : QVariant());
+            mpvSetProperty(iterator.key(), iterator.value());
+            ++iterator;
+        }
+        return;
+    }
+    auto iterator = m_savedLatencyOptions.cbegin();
+    while (iterator != m_savedLatencyOptions.cend()) {
+        QVariant value = iterator.value();
+        // Nothing could be read before the handle was initialized.
+        if (!value.isValid()) {
+            value = mpvGetProperty(
+                QString::fromUtf8("option-info/%1/default-value").arg(iterator.key()), true);
+        }
+        if (value.isValid()) {
+            mpvSetProperty(iterator.key(), value);
+        }
+        ++iterator;
+    }
+    m_savedLatencyOptions.clear();
+}
+
+void MpvObject::updateLiveLatency()
+{
+    bool cacheOk = false;
+    bool positionOk = false;
+    const qreal cacheTime
+        = mpvGetProperty(QString::fromUtf8("demuxer-cache-time"), true, &cacheOk).toReal();
+    const qreal position
+        = mpvGetProperty(QString::fromUtf8("time-pos"), true, &positionOk).toReal();
+    const bool measured = cacheOk && positionOk;
+    const qreal latency = measured ? qMax(cacheTime - position, 0.0) : 0.0;
+    if (!qFuzzyCompare(latency + 1.0, currentLiveLatency + 1.0)) {
+        currentLiveLatency = latency;
+        Q_EMIT liveLatencyChanged();
+    }
+    if (!measured || !isPlaying()) {
+        setCatchingUp(false);
+        return;
+    }
+    if (latency > currentMaxLatency) {
+        // Too far behind to catch up in a reasonable time, jump to the live
+        // edge instead.
+        qCDebug(lcMpv) << "Live latency is" << latency << "seconds, dropping the buffers.";
+        setCatchingUp(false);
+        mpvSendCommand(QVariantList{QString::fromUtf8("drop-buffers")});
+        return;
+    }
+    // Keep catching up until we're well below the target, so that the speed
+    // doesn't flip on every measurement.
+    if (latency > currentTargetLatency) {
+        setCatchingUp(true);
+    } else if (latency < (currentTargetLatency / 2.0)) {
+        setCatchingUp(false);
+    }
+}
+
+void MpvObject::setCatchingUp(const bool catchingUp)
+{
+    if (catchingUp == m_catchingUp) {
+        return;
+    }
+    m_catchingUp = catchingUp;
+    if (m_catchingUp) {
+        m_speedBeforeCatchUp = speed();
+        mpvSetProperty(QString::fromUtf8("speed"), m_speedBeforeCatchUp * m_catchUpFactor);
+    } else {
+        mpvSetProperty(QString::fromUtf8("speed"), m_speedBeforeCatchUp);
+    }
 }
 
 void MpvObject::on_update(void *ctx)
@@ -223,37 +795,42 @@ void MpvObject::processMpvLogMessage(void *event)
         return;
     }
     const auto e = static_cast<mpv_event_log_message *>(event);
-    // The log message from libmpv contains new line. Remove it.
-    const QString message = QString::fromUtf8(e->text).trimmed();
-    switch (e->log_level) {
-    case MPV_LOG_LEVEL_V:
-    case MPV_LOG_LEVEL_DEBUG:
-    case MPV_LOG_LEVEL_TRACE:
-        qCDebug(lcMpvLog).noquote() << message;
-        break;
-    case MPV_LOG_LEVEL_WARN:
-        qCWarning(lcMpvLog).noquote() << message;
-        break;
-    case MPV_LOG_LEVEL_ERROR:
-        qCCritical(lcMpvLog).noquote() << message;
-        break;
-    case MPV_LOG_LEVEL_FATAL:
-        // qFatal() doesn't support the "<<" operator.
-        qFatal("libmpv.log.general %s", e->text);
-        break;
-    case MPV_LOG_LEVEL_INFO:
-        qCInfo(lcMpvLog).noquote() << message;
-        break;
-    default:
-        qCDebug(lcMpvLog).noquote() << message;
-        break;
-    }
+    m_logSink->add(e->log_level, e->prefix, e->text);
 }
 
-void MpvObject::processMpvPropertyChange(void *event)
+void MpvObject::processMpvPropertyChange(const QString &name, const QVariant &value)
 {
-    const auto e = static_cast<mpv_event_property *>(event);
-    const QString name = QString::fromUtf8(e->name);
+    if (name == QString::fromUtf8("time-pos")) {
+        if (value.isValid()) {
+            currentTimePos = value.toReal();
+            m_chapterModel->setPosition(currentTimePos);
+        }
+    } else if (name == QString::fromUtf8("playlist")) {
+        updatePlaylist(value.toList());
+    } else if (name == QString::fromUtf8("track-list")) {
+        const MediaTracks mediaTracks = toMediaTracks(value.toList());
+        m_videoTrackModel->setTracks(mediaTracks.videoChannels);
+        m_audioTrackModel->setTracks(mediaTracks.audioTracks);
+        m_subtitleTrackModel->setTracks(mediaTracks.subtitleStreams);
+    } else if (name == QString::fromUtf8("chapter-list")) {
+        m_chapterModel->setChapters(toChapters(value.toList()));
+    } else if (name == QString::fromUtf8("metadata")) {
+        m_metadataModel->setMetadata(value.toMap());
+    } else if (name == QString::fromUtf8("demuxer-cache-state")) {
+        m_cacheTelemetry->setCacheState(value.toMap());
+        updateBufferingStatus();
+    } else if (name == QString::fromUtf8("paused-for-cache")) {
+        m_cacheTelemetry->setStalled(value.toBool());
+        updateBufferingStatus();
+    } else if (name == QString::fromUtf8("cache-buffering-state")) {
+        m_cacheTelemetry->setBufferingProgress(value.toInt());
+    } else if (name == QString::fromUtf8("playlist-pos")) {
+        updateSourceFromPlaylist();
+    } else if ((name == QString::fromUtf8("idle-active"))
+               && mpvGetProperty(name, true).toBool()) {
+        // The end of the playlist has been reached, there's no next item.
+        m_transitionTimer.invalidate();
+    }
     if (!propertyBlackList.contains(name) && !currentLivePreview) {
         qCDebug(lcMpvProperty).noquote() << name << "-->" << mpvGetProperty(name, true);
     }
@@ -271,7 +848,8 @@ void MpvObject::processMpvPropertyChange(void *event)
 
 bool MpvObject::isLoaded() const
 {
-    return ((mediaStatus() == MediaStatus::Loaded) || (mediaStatus() == MediaStatus::Buffering)
+    return ((mediaStatus() == MediaStatus::Loaded) || (mediaStatus() == MediaStatus::Stalled)
+            || (mediaStatus() == MediaStatus::Buffering)
             || (mediaStatus() == MediaStatus::Buffered));
 }
 
@@ -299,11 +877,66 @@ void MpvObject::setMediaStatus(const MpvObject::MediaStatus mediaStatus)
     Q_EMIT mediaStatusChanged();
 }
 
+void MpvObject::updatePlaylist(const QVariantList &entries)
+{
+    m_playlistEntries = entries;
+    QList<QUrl> playlist = {};
+    playlist.reserve(m_playlistEntries.size());
+    for (auto &&entry : qAsConst(m_playlistEntries)) {
+        const QString fileName = entry.toMap().value(QString::fromUtf8("filename")).toString();
+        playlist.append(mpvPathToUrl(fileName));
+    }
+    currentPlaylist = playlist;
+    // The current item may have been replaced.
+    updateSourceFromPlaylist();
+}
+
+void MpvObject::updateBufferingStatus()
+{
+    // Loading and End are driven by the events.
+    if (!isLoaded()) {
+        return;
+    }
+    if (m_cacheTelemetry->stalled()) {
+        setMediaStatus(MediaStatus::Stalled);
+    } else if (m_cacheTelemetry->bytes() <= 0) {
+        // Nothing is buffered (yet), eg: the cache is disabled.
+        setMediaStatus(MediaStatus::Loaded);
+    } else if (m_cacheTelemetry->idle() || m_cacheTelemetry->endCached()) {
+        // The cache is full, or holds everything up to the end.
+        setMediaStatus(MediaStatus::Buffered);
+    } else {
+        setMediaStatus(MediaStatus::Buffering);
+    }
+}
+
+void MpvObject::updateSourceFromPlaylist()
+{
+    const int index = playlistIndex();
+    if ((index < 0) || (index >= currentPlaylist.size())) {
+        return;
+    }
+    const QUrl source = currentPlaylist.at(index);
+    if (source != currentSource) {
+        currentSource = source;
+        Q_EMIT sourceChanged();
+    }
+}
+
 void MpvObject::videoReconfig()
 {
+    updateFrameRate();
     Q_EMIT videoSizeChanged();
 }
 
+void MpvObject::updateFrameRate()
+{
+    m_frameRate = mpvGetProperty(QString::fromUtf8("container-fps"), true).toReal();
+    if (m_frameRate <= 0.0) {
+        m_frameRate = estimatedVfFps();
+    }
+}
+
 void MpvObject::audioReconfig() {}
 
 void MpvObject::playbackStateChangeEvent()
@@ -322,84 +955,23 @@ void MpvObject::playbackStateChangeEvent()
 
 bool MpvObject::mpvSendCommand(const QVariant &arguments)
 {
-    if (arguments.isNull() || !arguments.isValid()) {
-        return false;
-    }
-    if (!currentLivePreview) {
-        qCDebug(lcMpvCommand).noquote() << arguments;
-    }
-    int errorCode = 0;
-    if (mpvCallType() == MpvCallType::Asynchronous) {
-        errorCode = mpv::qt::command_async(m_mpv, arguments, 0);
-    } else {
-        errorCode = mpv::qt::get_error(mpv::qt::command(m_mpv, arguments));
-    }
-    if ((errorCode < 0) && !currentLivePreview) {
-        qCWarning(lcMpvCommand).noquote()
-            << "Failed to send command" << arguments << ':' << mpv::qt::error_string(errorCode);
-    }
-    return (errorCode >= 0);
-}
-
-bool MpvObject::mpvSetProperty(const QString &name, const QVariant &value)
-{
-    if (name.isEmpty() || value.isNull() || !value.isValid()) {
-        return false;
-    }
-    if (!currentLivePreview) {
-        qCDebug(lcMpvProperty).noquote() << name << "-->" << value;
-    }
-    int errorCode = 0;
-    if (mpvCallType() == MpvCallType::Asynchronous) {
-        errorCode = mpv::qt::set_property_async(m_mpv, name, value, 0);
-    } else {
-        errorCode = mpv::qt::set_property(m_mpv, name, value);
-    }
-    if ((errorCode < 0) && !currentLivePreview) {
-        qCWarning(lcMpvProperty).noquote() << "Failed to change property" << name << "to" << value
-                                           << ':' << mpv::qt::error_string(errorCode);
+    MpvTraceScope trace("command", "api");
+    if (trace.isActive()) {
+        trace.setDetail(arguments.toList().value(0).toString());
     }
-    return (errorCode >= 0);
+    return m_core->command(arguments);
 }
 
-QVariant MpvObject::mpvGetProperty(const QString &name, const bool silent, bool *ok) const
+bool MpvObject::mpvSetProperty(const QString &name, const QVariant &value)
 {
-    if (ok) {
-        *ok = false;
-    }
-    if (name.isEmpty()) {
-        return QVariant();
-    }
-    const QVariant result = mpv::qt::get_property(m_mpv, name);
-    const int errorCode = mpv::qt::get_error(result);
-    if (result.isNull() || !result.isValid() || (errorCode < 0)) {
-        if (!silent && !currentLivePreview) {
-            qCWarning(lcMpvProperty).noquote()
-                << "Failed to query property" << name << ':' << mpv::qt::error_string(errorCode);
-        }
-    } else {
-        if (ok) {
-            *ok = true;
-        }
-        /*if ((name != "time-pos") && (name != "duration")) {
-            qCDebug(lcMpvProperty).noquote() << "Querying a property from mpv:"
-                               << name << "result:" << result;
-        }*/
-    }
-    return result;
+    MpvTraceScope trace("setProperty", "api");
+    trace.setDetail(name);
+    return m_core->setMpvProperty(name, value);
 }
 
-bool MpvObject::mpvObserveProperty(const QString &name)
+QVariant MpvObject::mpvGetProperty(const QString &name, const bool silent, bool *ok) const
 {
-    if (name.isEmpty()) {
-        return false;
-    }
-    const int errorCode = mpv::qt::observe_property(m_mpv, name, 0);
-    if ((errorCode < 0) && !currentLivePreview) {
-        qCWarning(lcMpvProperty).noquote()
-            << "Failed to observe property" << name << ':' << mpv::qt::error_string(errorCode);
-    }
-    return (errorCode >= 0);
+    return m_core->mpvProperty(name, silent, ok);
 }
 
 QQuickFramebufferObject::Renderer *MpvObject::createRenderer() const
@@ -722,87 +1294,42 @@ MpvObject::MpvCallType MpvObject::mpvCallType() const
 
 MpvObject::MediaTracks MpvObject::mediaTracks() const
 {
-    MediaTracks mediaTracks;
-    QVariantList trackList = mpvGetProperty(QString::fromUtf8("track-list")).toList();
-    for (auto &&track : qAsConst(trackList)) {
-        const auto trackInfo = track.toMap();
-        if ((trackInfo[QString::fromUtf8("type")] != QString::fromUtf8("video"))
-            && (trackInfo[QString::fromUtf8("type")] != QString::fromUtf8("audio"))
-            && (trackInfo[QString::fromUtf8("type")] != QString::fromUtf8("sub"))) {
-            continue;
-        }
-        QVariantHash singleTrackInfo;
-        singleTrackInfo[QString::fromUtf8("id")] = trackInfo[QString::fromUtf8("id")];
-        singleTrackInfo[QString::fromUtf8("type")] = trackInfo[QString::fromUtf8("type")];
-        singleTrackInfo[QString::fromUtf8("src-id")] = trackInfo[QString::fromUtf8("src-id")];
-        if (trackInfo[QString::fromUtf8("title")].toString().isEmpty()) {
-            if (trackInfo[QString::fromUtf8("lang")].toString() != QString::fromUtf8("und")) {
-                singleTrackInfo[QString::fromUtf8("title")] = trackInfo[QString::fromUtf8("lang")];
-            } else if (!trackInfo[QString::fromUtf8("external")].toBool()) {
-                singleTrackInfo[QString::fromUtf8("title")] = QString::fromUtf8("[internal]");
-            } else {
-                singleTrackInfo[QString::fromUtf8("title")] = QString::fromUtf8("[untitled]");
-            }
-        } else {
-            singleTrackInfo[QString::fromUtf8("title")] = trackInfo[QString::fromUtf8("title")];
-        }
-        singleTrackInfo[QString::fromUtf8("lang")] = trackInfo[QString::fromUtf8("lang")];
-        singleTrackInfo[QString::fromUtf8("default")] = trackInfo[QString::fromUtf8("default")];
-        singleTrackInfo[QString::fromUtf8("forced")] = trackInfo[QString::fromUtf8("forced")];
-        singleTrackInfo[QString::fromUtf8("codec")] = trackInfo[QString::fromUtf8("codec")];
-        singleTrackInfo[QString::fromUtf8("external")] = trackInfo[QString::fromUtf8("external")];
-        singleTrackInfo[QString::fromUtf8("external-filename")]
-            = trackInfo[QString::fromUtf8("external-filename")];
-        singleTrackInfo[QString::fromUtf8("selected")] = trackInfo[QString::fromUtf8("selected")];
-        singleTrackInfo[QString::fromUtf8("decoder-desc")]
-            = trackInfo[QString::fromUtf8("decoder-desc")];
-        if (trackInfo[QString::fromUtf8("type")] == QString::fromUtf8("video")) {
-            singleTrackInfo[QString::fromUtf8("albumart")]
-                = trackInfo[QString::fromUtf8("albumart")];
-            singleTrackInfo[QString::fromUtf8("demux-w")] = trackInfo[QString::fromUtf8("demux-w")];
-            singleTrackInfo[QString::fromUtf8("demux-h")] = trackInfo[QString::fromUtf8("demux-h")];
-            singleTrackInfo[QString::fromUtf8("demux-fps")]
-                = trackInfo[QString::fromUtf8("demux-fps")];
-            mediaTracks.videoChannels.append(singleTrackInfo);
-        } else if (trackInfo[QString::fromUtf8("type")] == QString::fromUtf8("audio")) {
-            singleTrackInfo[QString::fromUtf8("demux-channel-count")]
-                = trackInfo[QString::fromUtf8("demux-channel-count")];
-            singleTrackInfo[QString::fromUtf8("demux-channels")]
-                = trackInfo[QString::fromUtf8("demux-channels")];
-            singleTrackInfo[QString::fromUtf8("demux-samplerate")]
-                = trackInfo[QString::fromUtf8("demux-samplerate")];
-            mediaTracks.audioTracks.append(singleTrackInfo);
-        } else if (trackInfo[QString::fromUtf8("type")] == QString::fromUtf8("sub")) {
-            mediaTracks.subtitleStreams.append(singleTrackInfo);
-        }
-    }
-    return mediaTracks;
+    return {m_videoTrackModel->rows(), m_audioTrackModel->rows(), m_subtitleTrackModel->rows()};
 }
 
 MpvObject::Chapters MpvObject::chapters() const
 {
-    Chapters chapters;
-    QVariantList chapterList = mpvGetProperty(QString::fromUtf8("chapter-list")).toList();
-    for (auto &&chapter : qAsConst(chapterList)) {
-        const auto chapterInfo = chapter.toMap();
-        QVariantHash singleTrackInfo;
-        singleTrackInfo[QString::fromUtf8("title")] = chapterInfo[QString::fromUtf8("title")];
-        singleTrackInfo[QString::fromUtf8("time")] = chapterInfo[QString::fromUtf8("time")];
-        chapters.append(singleTrackInfo);
-    }
-    return chapters;
+    return m_chapterModel->rows();
 }
 
 MpvObject::Metadata MpvObject::metadata() const
 {
-    Metadata metadata;
-    QVariantMap metadataMap = mpvGetProperty(QString::fromUtf8("metadata")).toMap();
-    auto iterator = metadataMap.cbegin();
-    while (iterator != metadataMap.cend()) {
-        metadata[iterator.key()] = iterator.value();
-        ++iterator;
-    }
-    return metadata;
+    return m_metadataModel->metadata();
+}
+
+MpvTrackModel *MpvObject::videoTrackModel() const
+{
+    return m_videoTrackModel;
+}
+
+MpvTrackModel *MpvObject::audioTrackModel() const
+{
+    return m_audioTrackModel;
+}
+
+MpvTrackModel *MpvObject::subtitleTrackModel() const
+{
+    return m_subtitleTrackModel;
+}
+
+MpvChapterModel *MpvObject::chapterModel() const
+{
+    return m_chapterModel;
+}
+
+MpvMetadataModel *MpvObject::metadataModel() const
+{
+    return m_metadataModel;
 }
 
 qreal MpvObject::avsync() const
@@ -837,6 +1364,157 @@ QString MpvObject::durationText() const
     return timeToString(duration());
 }
 
+QList<QUrl> MpvObject::playlist() const
+{
+    return currentPlaylist;
+}
+
+QVariantList MpvObject::playlistEntries() const
+{
+    return m_playlistEntries;
+}
+
+int MpvObject::playlistIndex() const
+{
+    bool ok = false;
+    const int index = mpvGetProperty(QString::fromUtf8("playlist-pos"), true, &ok).toInt();
+    return ok ? index : -1;
+}
+
+bool MpvObject::gapless() const
+{
+    return mpvGetProperty(QString::fromUtf8("gapless-audio")).toString()
+           != QString::fromUtf8("no");
+}
+
+bool MpvObject::prefetchPlaylist() const
+{
+    return mpvGetProperty(QString::fromUtf8("prefetch-playlist")).toBool();
+}
+
+qreal MpvObject::transitionLatency() const
+{
+    return currentTransitionLatency;
+}
+
+MpvObject::Priority MpvObject::priority() const
+{
+    return currentPriority;
+}
+
+qreal MpvObject::renderScale() const
+{
+    return currentRenderScale;
+}
+
+qint64 MpvObject::demuxerMaxBytes() const
+{
+    return mpvGetProperty(QString::fromUtf8("demuxer-max-bytes")).toLongLong();
+}
+
+qint64 MpvObject::demuxerMaxBackBytes() const
+{
+    return mpvGetProperty(QString::fromUtf8("demuxer-max-back-bytes")).toLongLong();
+}
+
+qint64 MpvObject::cacheBytes() const
+{
+    // Unavailable (and not cached) while nothing is being played.
+    return mpvGetProperty(QString::fromUtf8("demuxer-cache-state"), true)
+        .toMap()
+        .value(QString::fromUtf8("total-bytes"))
+        .toLongLong();
+}
+
+MpvCacheTelemetry *MpvObject::cacheTelemetry() const
+{
+    return m_cacheTelemetry;
+}
+
+MpvLatencyTracker *MpvObject::latency() const
+{
+    return m_latency;
+}
+
+MpvLogSink *MpvObject::logSink() const
+{
+    return m_logSink;
+}
+
+qint64 MpvObject::queueOverflows() const
+{
+    return m_core->queueOverflows();
+}
+
+bool MpvObject::lowLatency() const
+{
+    return currentLowLatency;
+}
+
+qreal MpvObject::targetLatency() const
+{
+    return currentTargetLatency;
+}
+
+qreal MpvObject::maxLatency() const
+{
+    return currentMaxLatency;
+}
+
+qreal MpvObject::liveLatency() const
+{
+    return currentLiveLatency;
+}
+
+qint64 MpvObject::frameNumber() const
+{
+    if (isStopped()) {
+        return 0;
+    }
+    return qMax(qRound64(currentTimePos * m_frameRate), qint64(0));
+}
+
+qint64 MpvObject::stepCacheBytes() const
+{
+    return currentStepCacheBytes;
+}
+
+MpvKeyframeIndex *MpvObject::keyframeIndex() const
+{
+    return currentKeyframeIndex;
+}
+
+bool MpvObject::scrubbing() const
+{
+    return currentScrubbing;
+}
+
+qreal MpvObject::timePos() const
+{
+    return currentTimePos;
+}
+
+QSharedPointer<MpvFrameTap> MpvObject::frameTap() const
+{
+    return m_frameTap;
+}
+
+void MpvObject::setFrameTap(const QSharedPointer<MpvFrameTap> &frameTap)
+{
+    m_frameTap = frameTap;
+}
+
+QSharedPointer<MpvRenderTimings> MpvObject::renderTimings() const
+{
+    return m_renderTimings;
+}
+
+void MpvObject::setRenderTimings(const QSharedPointer<MpvRenderTimings> &renderTimings)
+{
+    // The renderer picks it up in synchronize().
+    m_renderTimings = renderTimings;
+}
+
 bool MpvObject::open(const QUrl &url)
 {
     if (!url.isValid()) {
@@ -856,6 +1534,7 @@ bool MpvObject::play()
     if (!isPaused() || !currentSource.isValid()) {
         return false;
     }
+    stopSteppingBackward();
     const bool result = mpvSetProperty(QString::fromUtf8("pause"), false);
     if (result) {
         Q_EMIT playing();
@@ -898,6 +1577,7 @@ bool MpvObject::stop()
     if (result) {
         Q_EMIT stopped();
     }
+    m_transitionTimer.invalidate();
     currentSource.clear();
     Q_EMIT sourceChanged();
     return result;
@@ -910,11 +1590,37 @@ bool MpvObject::seek(const qint64 value, const bool absolute, const bool percent
     }
     const qint64 min = (absolute || percent) ? 0 : -position();
     const qint64 max = percent ? 100 : (absolute ? duration() : duration() - position());
-    return mpvSendCommand(QVariantList{QString::fromUtf8("seek"),
-                                       qBound(min, value, max),
-                                       percent ? QString::fromUtf8("absolute-percent")
-                                               : (absolute ? QString::fromUtf8("absolute")
-                                                           : QString::fromUtf8("relative"))});
+    const qint64 target = qBound(min, value, max);
+    QVariantList arguments = {QString::fromUtf8("seek"),
+                              target,
+                              percent ? QString::fromUtf8("absolute-percent")
+                                      : (absolute ? QString::fromUtf8("absolute")
+                                                  : QString::fromUtf8("relative"))};
+    stopSteppingBackward();
+    m_pendingExactSeek = -1.0;
+    if (currentKeyframeIndex && currentKeyframeIndex->ready()
+        && (currentKeyframeIndex->indexedSource() == currentSource)) {
+        const qreal seconds = percent ? (duration() * target / 100.0)
+                                      : (absolute ? target : (currentTimePos + target));
+        const qreal keyframe = currentKeyframeIndex->nearestKeyframe(seconds);
+        const bool onKeyframe = (qAbs(keyframe - seconds) <= m_keyframeTolerance);
+        // Exact seeks decode everything from the previous keyframe on, only
+        // pay for that when it makes a difference.
+        if (onKeyframe || currentScrubbing) {
+            arguments = {QString::fromUtf8("seek"),
+                         keyframe + m_keyframeSeekMargin,
+                         QString::fromUtf8("absolute+keyframes")};
+            if (!onKeyframe) {
+                m_pendingExactSeek = seconds;
+            }
+        }
+    }
+    const bool latencyStarted = m_latency->seekStarted();
+    const bool result = mpvSendCommand(arguments);
+    if (!result && latencyStarted) {
+        m_latency->cancelSeek();
+    }
+    return result;
 }
 
 bool MpvObject::seekAbsolute(const qint64 position)
@@ -941,6 +1647,36 @@ bool MpvObject::seekPercent(const int percent)
     return seek(qBound(0, percent, 100), true, true);
 }
 
+bool MpvObject::frameStep()
+{
+    if (isStopped()) {
+        return false;
+    }
+    stopSteppingBackward();
+    return mpvSendCommand(QVariantList{QString::fromUtf8("frame-step")});
+}
+
+bool MpvObject::frameBackStep()
+{
+    if (isStopped()) {
+        return false;
+    }
+    if (currentStepCacheBytes <= 0) {
+        return mpvSendCommand(QVariantList{QString::fromUtf8("frame-back-step")});
+    }
+    // While playing backward, mpv decodes a whole GOP at a time and keeps
+    // its frames in the reversal buffer, so that "frame-step" only has to
+    // show the next one of them.
+    if (!m_steppingBackward) {
+        mpvSetProperty(QString::fromUtf8("video-reversal-buffer"), currentStepCacheBytes);
+        if (!mpvSetProperty(QString::fromUtf8("play-dir"), QString::fromUtf8("backward"))) {
+            return false;
+        }
+        m_steppingBackward = true;
+    }
+    return mpvSendCommand(QVariantList{QString::fromUtf8("frame-step")});
+}
+
 bool MpvObject::screenshot()
 {
     if (isStopped()) {
@@ -965,15 +1701,7 @@ bool MpvObject::screenshotToFile(const QString &filePath)
 
 bool MpvObject::loadConfigFile(const QString &path)
 {
-    if (path.isEmpty() || !QFileInfo::exists(path)) {
-        return false;
-    }
-    const int errorCode = mpv::qt::load_config_file(m_mpv, path);
-    if ((errorCode < 0) && !currentLivePreview) {
-        qCWarning(lcMpvMisc).noquote()
-            << "Failed to load the config file" << path << ':' << mpv::qt::error_string(errorCode);
-    }
-    return (errorCode >= 0);
+    return m_core->loadConfigFile(path);
 }
 
 bool MpvObject::isVideo(const QUrl &url)
@@ -1014,6 +1742,80 @@ bool MpvObject::currentIsMedia() const
     return (currentIsVideo() || currentIsAudio());
 }
 
+bool MpvObject::appendToPlaylist(const QUrl &url)
+{
+    if (!url.isValid()) {
+        return false;
+    }
+    return mpvSendCommand(QVariantList{QString::fromUtf8("loadfile"),
+                                       urlToMpvPath(url),
+                                       QString::fromUtf8("append-play")});
+}
+
+bool MpvObject::insertIntoPlaylist(const int index, const QUrl &url)
+{
+    if (!url.isValid() || (index < 0)) {
+        return false;
+    }
+    // The playlist is only refreshed once mpv notifies us, ask for its size
+    // to take the previous requests into account.
+    const int count = mpvGetProperty(QString::fromUtf8("playlist-count"), true).toInt();
+    if (!appendToPlaylist(url)) {
+        return false;
+    }
+    if (index >= count) {
+        return true;
+    }
+    // Moves the item before the one currently at the index.
+    return mpvSendCommand(QVariantList{QString::fromUtf8("playlist-move"), count, index});
+}
+
+bool MpvObject::movePlaylistItem(const int from, const int to)
+{
+    const int count = mpvGetProperty(QString::fromUtf8("playlist-count"), true).toInt();
+    if ((from < 0) || (from >= count) || (to < 0) || (to >= count)) {
+        return false;
+    }
+    if (from == to) {
+        return true;
+    }
+    // playlist-move inserts the item before the one at the target index,
+    // which is one place too early when moving forward.
+    return mpvSendCommand(
+        QVariantList{QString::fromUtf8("playlist-move"), from, (from < to) ? (to + 1) : to});
+}
+
+bool MpvObject::removeFromPlaylist(const int index)
+{
+    if (index < 0) {
+        return false;
+    }
+    // Removing the current item plays the next one.
+    if (index == playlistIndex()) {
+        stopSteppingBackward();
+    }
+    return mpvSendCommand(QVariantList{QString::fromUtf8("playlist-remove"), index});
+}
+
+bool MpvObject::clearPlaylist()
+{
+    // The stop command clears the playlist as well.
+    return mpvSendCommand(QVariantList{QString::fromUtf8("playlist-clear")})
+           && (isStopped() || stop());
+}
+
+bool MpvObject::playNext()
+{
+    stopSteppingBackward();
+    return mpvSendCommand(QVariantList{QString::fromUtf8("playlist-next")});
+}
+
+bool MpvObject::playPrevious()
+{
+    stopSteppingBackward();
+    return mpvSendCommand(QVariantList{QString::fromUtf8("playlist-prev")});
+}
+
 void MpvObject::setSource(const QUrl &source)
 {
     if (source.isEmpty()) {
@@ -1023,10 +1825,10 @@ void MpvObject::setSource(const QUrl &source)
     if (!source.isValid() || (source == currentSource)) {
         return;
     }
+    m_latency->openStarted();
+    stopSteppingBackward();
     const bool result = mpvSendCommand(
-        QVariantList{QString::fromUtf8("loadfile"),
-                     source.isLocalFile() ? QDir::toNativeSeparators(source.toLocalFile())
-                                          : source.url()});
+        QVariantList{QString::fromUtf8("loadfile"), urlToMpvPath(source)});
     if (result) {
         if (livePreview()) {
             mpvSetProperty(QString::fromUtf8("pause"), true);
@@ -1038,7 +1840,7 @@ void MpvObject::setSource(const QUrl &source)
 
 void MpvObject::setMute(const bool mute)
 {
-    if (mute == this->mute()) {
+    if (ready() && (mute == this->mute())) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("mute"), mute);
@@ -1068,7 +1870,7 @@ void MpvObject::setPlaybackState(const MpvObject::PlaybackState playbackState)
 
 void MpvObject::setLogLevel(const MpvObject::LogLevel logLevel)
 {
-    if (logLevel == this->logLevel()) {
+    if (ready() && (logLevel == this->logLevel())) {
         return;
     }
     QString level = QString::fromUtf8("debug");
@@ -1098,20 +1900,19 @@ void MpvObject::setLogLevel(const MpvObject::LogLevel logLevel)
                                         level != QString::fromUtf8("no"));
     const bool result2 = mpvSetProperty(QString::fromUtf8("msg-level"),
                                         QString::fromUtf8("all=%1").arg(level));
-    const int errorCode = mpv::qt::request_log_messages(m_mpv, level);
-    if (result1 && result2 && (errorCode >= 0)) {
+    const bool result3 = m_core->requestLogMessages(level);
+    if (result1 && result2 && result3) {
         Q_EMIT logLevelChanged();
     } else {
         if (!currentLivePreview) {
-            qCWarning(lcMpvMisc).noquote() << "Failed to change log level to" << level << ':'
-                                           << mpv::qt::error_string(errorCode);
+            qCWarning(lcMpvMisc).noquote() << "Failed to change log level to" << level;
         }
     }
 }
 
 void MpvObject::setPosition(const qint64 position)
 {
-    if (isStopped() || (position == this->position())) {
+    if (isStopped() || (ready() && (position == this->position()))) {
         return;
     }
     seek(qBound(qint64(0), position, duration()));
@@ -1119,7 +1920,7 @@ void MpvObject::setPosition(const qint64 position)
 
 void MpvObject::setVolume(const int volume)
 {
-    if (volume == this->volume()) {
+    if (ready() && (volume == this->volume())) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("volume"), qBound(0, volume, 100));
@@ -1127,7 +1928,7 @@ void MpvObject::setVolume(const int volume)
 
 void MpvObject::setHwdec(const QString &hwdec)
 {
-    if (hwdec.isEmpty() || (hwdec == this->hwdec())) {
+    if (hwdec.isEmpty() || (ready() && (hwdec == this->hwdec()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("hwdec"), hwdec);
@@ -1135,7 +1936,7 @@ void MpvObject::setHwdec(const QString &hwdec)
 
 void MpvObject::setVid(const int vid)
 {
-    if (isStopped() || (vid == this->vid())) {
+    if (isStopped() || (ready() && (vid == this->vid()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("vid"), qMax(vid, 0));
@@ -1143,7 +1944,7 @@ void MpvObject::setVid(const int vid)
 
 void MpvObject::setAid(const int aid)
 {
-    if (isStopped() || (aid == this->aid())) {
+    if (isStopped() || (ready() && (aid == this->aid()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("aid"), qMax(aid, 0));
@@ -1151,7 +1952,7 @@ void MpvObject::setAid(const int aid)
 
 void MpvObject::setSid(const int sid)
 {
-    if (isStopped() || (sid == this->sid())) {
+    if (isStopped() || (ready() && (sid == this->sid()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("sid"), qMax(sid, 0));
@@ -1159,7 +1960,7 @@ void MpvObject::setSid(const int sid)
 
 void MpvObject::setVideoRotate(const int videoRotate)
 {
-    if (isStopped() || (videoRotate == this->videoRotate())) {
+    if (isStopped() || (ready() && (videoRotate == this->videoRotate()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("video-rotate"), qBound(0, videoRotate, 359));
@@ -1167,7 +1968,7 @@ void MpvObject::setVideoRotate(const int videoRotate)
 
 void MpvObject::setVideoAspect(const qreal videoAspect)
 {
-    if (isStopped() || (videoAspect == this->videoAspect())) {
+    if (isStopped() || (ready() && (videoAspect == this->videoAspect()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("video-aspect-override"), qMax(videoAspect, 0.0));
@@ -1175,7 +1976,7 @@ void MpvObject::setVideoAspect(const qreal videoAspect)
 
 void MpvObject::setSpeed(const qreal speed)
 {
-    if (isStopped() || (speed == this->speed())) {
+    if (isStopped() || (ready() && (speed == this->speed()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("speed"), qMax(speed, 0.0));
@@ -1183,7 +1984,7 @@ void MpvObject::setSpeed(const qreal speed)
 
 void MpvObject::setDeinterlace(const bool deinterlace)
 {
-    if (deinterlace == this->deinterlace()) {
+    if (ready() && (deinterlace == this->deinterlace())) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("deinterlace"), deinterlace);
@@ -1191,7 +1992,7 @@ void MpvObject::setDeinterlace(const bool deinterlace)
 
 void MpvObject::setAudioExclusive(const bool audioExclusive)
 {
-    if (audioExclusive == this->audioExclusive()) {
+    if (ready() && (audioExclusive == this->audioExclusive())) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("audio-exclusive"), audioExclusive);
@@ -1199,7 +2000,7 @@ void MpvObject::setAudioExclusive(const bool audioExclusive)
 
 void MpvObject::setAudioFileAuto(const QString &audioFileAuto)
 {
-    if (audioFileAuto.isEmpty() || (audioFileAuto == this->audioFileAuto())) {
+    if (audioFileAuto.isEmpty() || (ready() && (audioFileAuto == this->audioFileAuto()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("audio-file-auto"), audioFileAuto);
@@ -1207,7 +2008,7 @@ void MpvObject::setAudioFileAuto(const QString &audioFileAuto)
 
 void MpvObject::setSubAuto(const QString &subAuto)
 {
-    if (subAuto.isEmpty() || (subAuto == this->subAuto())) {
+    if (subAuto.isEmpty() || (ready() && (subAuto == this->subAuto()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("sub-auto"), subAuto);
@@ -1215,7 +2016,7 @@ void MpvObject::setSubAuto(const QString &subAuto)
 
 void MpvObject::setSubCodepage(const QString &subCodepage)
 {
-    if (subCodepage.isEmpty() || (subCodepage == this->subCodepage())) {
+    if (subCodepage.isEmpty() || (ready() && (subCodepage == this->subCodepage()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("sub-codepage"),
@@ -1228,7 +2029,7 @@ void MpvObject::setSubCodepage(const QString &subCodepage)
 
 void MpvObject::setVo(const QString &vo)
 {
-    if (vo.isEmpty() || (vo == this->vo())) {
+    if (vo.isEmpty() || (ready() && (vo == this->vo()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("vo"), vo);
@@ -1236,7 +2037,7 @@ void MpvObject::setVo(const QString &vo)
 
 void MpvObject::setAo(const QString &ao)
 {
-    if (ao.isEmpty() || (ao == this->ao())) {
+    if (ao.isEmpty() || (ready() && (ao == this->ao()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("ao"), ao);
@@ -1244,7 +2045,7 @@ void MpvObject::setAo(const QString &ao)
 
 void MpvObject::setScreenshotFormat(const QString &screenshotFormat)
 {
-    if (screenshotFormat.isEmpty() || (screenshotFormat == this->screenshotFormat())) {
+    if (screenshotFormat.isEmpty() || (ready() && (screenshotFormat == this->screenshotFormat()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("screenshot-format"), screenshotFormat);
@@ -1252,7 +2053,7 @@ void MpvObject::setScreenshotFormat(const QString &screenshotFormat)
 
 void MpvObject::setScreenshotPngCompression(const int screenshotPngCompression)
 {
-    if (screenshotPngCompression == this->screenshotPngCompression()) {
+    if (ready() && (screenshotPngCompression == this->screenshotPngCompression())) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("screenshot-png-compression"),
@@ -1261,7 +2062,8 @@ void MpvObject::setScreenshotPngCompression(const int screenshotPngCompression)
 
 void MpvObject::setScreenshotTemplate(const QString &screenshotTemplate)
 {
-    if (screenshotTemplate.isEmpty() || (screenshotTemplate == this->screenshotTemplate())) {
+    if (screenshotTemplate.isEmpty()
+        || (ready() && (screenshotTemplate == this->screenshotTemplate()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("screenshot-template"), screenshotTemplate);
@@ -1269,7 +2071,8 @@ void MpvObject::setScreenshotTemplate(const QString &screenshotTemplate)
 
 void MpvObject::setScreenshotDirectory(const QString &screenshotDirectory)
 {
-    if (screenshotDirectory.isEmpty() || (screenshotDirectory == this->screenshotDirectory())) {
+    if (screenshotDirectory.isEmpty()
+        || (ready() && (screenshotDirectory == this->screenshotDirectory()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("screenshot-directory"), screenshotDirectory);
@@ -1277,7 +2080,7 @@ void MpvObject::setScreenshotDirectory(const QString &screenshotDirectory)
 
 void MpvObject::setProfile(const QString &profile)
 {
-    if (profile.isEmpty() || (profile == this->profile())) {
+    if (profile.isEmpty() || (ready() && (profile == this->profile()))) {
         return;
     }
     mpvSendCommand(QVariantList{QString::fromUtf8("apply-profile"), profile});
@@ -1285,7 +2088,7 @@ void MpvObject::setProfile(const QString &profile)
 
 void MpvObject::setHrSeek(const bool hrSeek)
 {
-    if (hrSeek == this->hrSeek()) {
+    if (ready() && (hrSeek == this->hrSeek())) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("hr-seek"),
@@ -1294,7 +2097,7 @@ void MpvObject::setHrSeek(const bool hrSeek)
 
 void MpvObject::setYtdl(const bool ytdl)
 {
-    if (ytdl == this->ytdl()) {
+    if (ready() && (ytdl == this->ytdl())) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("ytdl"), ytdl);
@@ -1302,7 +2105,7 @@ void MpvObject::setYtdl(const bool ytdl)
 
 void MpvObject::setLoadScripts(const bool loadScripts)
 {
-    if (loadScripts == this->loadScripts()) {
+    if (ready() && (loadScripts == this->loadScripts())) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("load-scripts"), loadScripts);
@@ -1310,7 +2113,7 @@ void MpvObject::setLoadScripts(const bool loadScripts)
 
 void MpvObject::setScreenshotTagColorspace(const bool screenshotTagColorspace)
 {
-    if (screenshotTagColorspace == this->screenshotTagColorspace()) {
+    if (ready() && (screenshotTagColorspace == this->screenshotTagColorspace())) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("screenshot-tag-colorspace"), screenshotTagColorspace);
@@ -1318,7 +2121,7 @@ void MpvObject::setScreenshotTagColorspace(const bool screenshotTagColorspace)
 
 void MpvObject::setScreenshotJpegQuality(const int screenshotJpegQuality)
 {
-    if (screenshotJpegQuality == this->screenshotJpegQuality()) {
+    if (ready() && (screenshotJpegQuality == this->screenshotJpegQuality())) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("screenshot-jpeg-quality"),
@@ -1331,12 +2134,13 @@ void MpvObject::setMpvCallType(const MpvObject::MpvCallType mpvCallType)
         return;
     }
     currentMpvCallType = mpvCallType;
+    m_core->setAsynchronousCalls(currentMpvCallType == MpvCallType::Asynchronous);
     Q_EMIT mpvCallTypeChanged();
 }
 
 void MpvObject::setPercentPos(const int percentPos)
 {
-    if (isStopped() || (percentPos == this->percentPos())) {
+    if (isStopped() || (ready() && (percentPos == this->percentPos()))) {
         return;
     }
     mpvSetProperty(QString::fromUtf8("percent-pos"), qBound(0, percentPos, 100));
@@ -1348,6 +2152,7 @@ void MpvObject::setLivePreview(const bool livePreview)
         return;
     }
     currentLivePreview = livePreview;
+    m_core->setQuiet(currentLivePreview);
     if (currentLivePreview) {
         setLogLevel(LogLevel::Off);
         mpvSetProperty(QString::fromUtf8("pause"), true);
@@ -1360,123 +2165,144 @@ void MpvObject::setLivePreview(const bool livePreview)
     Q_EMIT livePreviewChanged();
 }
 
-void MpvObject::handleMpvEvents()
+void MpvObject::handleMpvEvent(const mpv_event *event)
 {
-    // Process all events, until the event queue is empty.
-    while (m_mpv) {
-        const auto event = mpv::qt::wait_event(m_mpv, 0.005);
-        // Nothing happened. Happens on timeouts or sporadic wakeups.
-        if (event->event_id == MPV_EVENT_NONE) {
-            break;
+    const MpvTraceScope trace("handleMpvEvent", "player");
+    bool shouldOutput = true;
+    switch (event->event_id) {
+    // Happens when the player quits. The player enters a state where it
+    // tries to disconnect all clients. Most requests to the player will
+    // fail, and the client should react to this and quit with
+    // mpv_destroy() as soon as possible.
+    case MPV_EVENT_SHUTDOWN:
+        break;
+    // See mpv_request_log_messages().
+    case MPV_EVENT_LOG_MESSAGE:
+        processMpvLogMessage(event->data);
+        shouldOutput = false;
+        break;
+    // Reply to a mpv_get_property_async() request.
+    // See also mpv_event and mpv_event_property.
+    case MPV_EVENT_GET_PROPERTY_REPLY:
+        shouldOutput = false;
+        break;
+    // Reply to a mpv_set_property_async() request.
+    // (Unlike MPV_EVENT_GET_PROPERTY, mpv_event_property is not used.)
+    case MPV_EVENT_SET_PROPERTY_REPLY:
+        shouldOutput = false;
+        break;
+    // Reply to a mpv_command_async() or mpv_command_node_async() request.
+    // See also mpv_event and mpv_event_command.
+    case MPV_EVENT_COMMAND_REPLY:
+        shouldOutput = false;
+        break;
+    // Notification before playback start of a file (before the file is
+    // loaded).
+    case MPV_EVENT_START_FILE:
+        // Playlist items don't go through setSource(). Usually it's too
+        // late by now, see MPV_EVENT_END_FILE.
+        stopSteppingBackward();
+        m_pendingExactSeek = -1.0;
+        m_cacheTelemetry->reset();
+        m_latency->fileStarted();
+        setMediaStatus(MediaStatus::Loading);
+        break;
+    // Notification after playback end (after the file was unloaded).
+    // See also mpv_event and mpv_event_end_file.
+    case MPV_EVENT_END_FILE:
+        // Playback of the next item starts right away, if there's one.
+        if (const auto e = static_cast<mpv_event_end_file *>(event->data);
+            (e->reason == MPV_END_FILE_REASON_EOF)
+            || (e->reason == MPV_END_FILE_REASON_STOP)) {
+            m_transitionTimer.start();
+        } else {
+            m_transitionTimer.invalidate();
         }
-        bool shouldOutput = true;
-        switch (event->event_id) {
-        // Happens when the player quits. The player enters a state where it
-        // tries to disconnect all clients. Most requests to the player will
-        // fail, and the client should react to this and quit with
-        // mpv_destroy() as soon as possible.
-        case MPV_EVENT_SHUTDOWN:
-            break;
-        // See mpv_request_log_messages().
-        case MPV_EVENT_LOG_MESSAGE:
-            processMpvLogMessage(event->data);
-            shouldOutput = false;
-            break;
-        // Reply to a mpv_get_property_async() request.
-        // See also mpv_event and mpv_event_property.
-        case MPV_EVENT_GET_PROPERTY_REPLY:
-            shouldOutput = false;
-            break;
-        // Reply to a mpv_set_property_async() request.
-        // (Unlike MPV_EVENT_GET_PROPERTY, mpv_event_property is not used.)
-        case MPV_EVENT_SET_PROPERTY_REPLY:
-            shouldOutput = false;
-            break;
-        // Reply to a mpv_command_async() or mpv_command_node_async() request.
-        // See also mpv_event and mpv_event_command.
-        case MPV_EVENT_COMMAND_REPLY:
-            shouldOutput = false;
-            break;
-        // Notification before playback start of a file (before the file is
-        // loaded).
-        case MPV_EVENT_START_FILE:
-            setMediaStatus(MediaStatus::Loading);
-            break;
-        // Notification after playback end (after the file was unloaded).
-        // See also mpv_event and mpv_event_end_file.
-        case MPV_EVENT_END_FILE:
-            setMediaStatus(MediaStatus::End);
-            playbackStateChangeEvent();
-            break;
-        // Notification when the file has been loaded (headers were read
-        // etc.), and decoding starts.
-        case MPV_EVENT_FILE_LOADED:
-            setMediaStatus(MediaStatus::Loaded);
-            Q_EMIT loaded();
-            playbackStateChangeEvent();
-            break;
-        // Triggered by the script-message input command. The command uses the
-        // first argument of the command as client name (see mpv_client_name())
-        // to dispatch the message, and passes along all arguments starting from
-        // the second argument as strings.
-        // See also mpv_event and mpv_event_client_message.
-        case MPV_EVENT_CLIENT_MESSAGE:
-            break;
-        // Happens after video changed in some way. This can happen on
-        // resolution changes, pixel format changes, or video filter changes.
-        // The event is sent after the video filters and the VO are
-        // reconfigured. Applications embedding a mpv window should listen to
-        // this event in order to resize the window if needed.
-        // Note that this event can happen sporadically, and you should check
-        // yourself whether the video parameters really changed before doing
-        // something expensive.
-        case MPV_EVENT_VIDEO_RECONFIG:
-            videoReconfig();
-            break;
-        // Similar to MPV_EVENT_VIDEO_RECONFIG. This is relatively
-        // uninteresting, because there is no such thing as audio output
-        // embedding.
-        case MPV_EVENT_AUDIO_RECONFIG:
-            audioReconfig();
-            break;
-        // Happens when a seek was initiated. Playback stops. Usually it will
-        // resume with MPV_EVENT_PLAYBACK_RESTART as soon as the seek is
-        // finished.
-        case MPV_EVENT_SEEK:
-            break;
-        // There was a discontinuity of some sort (like a seek), and playback
-        // was reinitialized. Usually happens after seeking, or ordered chapter
-        // segment switches. The main purpose is allowing the client to detect
-        // when a seek request is finished.
-        case MPV_EVENT_PLAYBACK_RESTART:
-            break;
-        // Event sent due to mpv_observe_property().
-        // See also mpv_event and mpv_event_property.
-        case MPV_EVENT_PROPERTY_CHANGE:
-            processMpvPropertyChange(event->data);
-            shouldOutput = false;
-            break;
-        // Happens if the internal per-mpv_handle ringbuffer overflows, and at
-        // least 1 event had to be dropped. This can happen if the client
-        // doesn't read the event queue quickly enough with mpv_wait_event(), or
-        // if the client makes a very large number of asynchronous calls at
-        // once.
-        // Event delivery will continue normally once this event was returned
-        // (this forces the client to empty the queue completely).
-        case MPV_EVENT_QUEUE_OVERFLOW:
-            break;
-        // Triggered if a hook handler was registered with mpv_hook_add(), and
-        // the hook is invoked. If you receive this, you must handle it, and
-        // continue the hook with mpv_hook_continue().
-        // See also mpv_event and mpv_event_hook.
-        case MPV_EVENT_HOOK:
-            break;
-        default:
-            break;
+        // Before the next item is opened, or prefetched, backward.
+        stopSteppingBackward();
+        m_latency->fileEnded();
+        m_frameRate = 0.0;
+        setMediaStatus(MediaStatus::End);
+        playbackStateChangeEvent();
+        break;
+    // Notification when the file has been loaded (headers were read
+    // etc.), and decoding starts.
+    case MPV_EVENT_FILE_LOADED:
+        m_latency->fileLoaded();
+        updateFrameRate();
+        // Without audio, there's no clock to sync to: show the frames as
+        // soon as they are decoded.
+        if (currentLowLatency) {
+            mpvSetProperty(QString::fromUtf8("untimed"), aid() <= 0);
         }
-        if (shouldOutput && !currentLivePreview) {
-            qCDebug(lcMpvEvent).noquote()
-                << mpv::qt::event_name(event->event_id) << "event received.";
+        setMediaStatus(MediaStatus::Loaded);
+        Q_EMIT loaded();
+        updateBufferingStatus();
+        playbackStateChangeEvent();
+        break;
+    // Triggered by the script-message input command. The command uses the
+    // first argument of the command as client name (see mpv_client_name())
+    // to dispatch the message, and passes along all arguments starting from
+    // the second argument as strings.
+    // See also mpv_event and mpv_event_client_message.
+    case MPV_EVENT_CLIENT_MESSAGE:
+        break;
+    // Happens after video changed in some way. This can happen on
+    // resolution changes, pixel format changes, or video filter changes.
+    // The event is sent after the video filters and the VO are
+    // reconfigured. Applications embedding a mpv window should listen to
+    // this event in order to resize the window if needed.
+    // Note that this event can happen sporadically, and you should check
+    // yourself whether the video parameters really changed before doing
+    // something expensive.
+    case MPV_EVENT_VIDEO_RECONFIG:
+        videoReconfig();
+        break;
+    // Similar to MPV_EVENT_VIDEO_RECONFIG. This is relatively
+    // uninteresting, because there is no such thing as audio output
+    // embedding.
+    case MPV_EVENT_AUDIO_RECONFIG:
+        audioReconfig();
+        break;
+    // Happens when a seek was initiated. Playback stops. Usually it will
+    // resume with MPV_EVENT_PLAYBACK_RESTART as soon as the seek is
+    // finished.
+    case MPV_EVENT_SEEK:
+        m_latency->seekStarted();
+        break;
+    // There was a discontinuity of some sort (like a seek), and playback
+    // was reinitialized. Usually happens after seeking, or ordered chapter
+    // segment switches. The main purpose is allowing the client to detect
+    // when a seek request is finished.
+    case MPV_EVENT_PLAYBACK_RESTART:
+        m_latency->playbackRestarted(vid() > 0);
+        if (m_transitionTimer.isValid()) {
+            currentTransitionLatency = m_transitionTimer.nsecsElapsed() / 1000000.0;
+            m_transitionTimer.invalidate();
+            Q_EMIT transitionLatencyChanged();
         }
+        break;
+    // Happens if the internal per-mpv_handle ringbuffer overflows, and at
+    // least 1 event had to be dropped. This can happen if the client
+    // doesn't read the event queue quickly enough with mpv_wait_event(), or
+    // if the client makes a very large number of asynchronous calls at
+    // once.
+    // Event delivery will continue normally once this event was returned
+    // (this forces the client to empty the queue completely).
+    // MpvCore reads the observed properties again once the queue is empty.
+    case MPV_EVENT_QUEUE_OVERFLOW:
+        break;
+    // Triggered if a hook handler was registered with mpv_hook_add(), and
+    // the hook is invoked. If you receive this, you must handle it, and
+    // continue the hook with mpv_hook_continue().
+    // See also mpv_event and mpv_event_hook.
+    case MPV_EVENT_HOOK:
+        break;
+    default:
+        break;
+    }
+    if (shouldOutput && !currentLivePreview) {
+        qCDebug(lcMpvEvent).noquote()
+            << mpv::qt::event_name(event->event_id) << "event received.";
     }
 }
@@ -31,18 +31,25 @@
 
 #define MPV_ENABLE_DEPRECATED 0
 
-#include "mpvqthelper.hpp"
+#include "mpvcachetelemetry.h"
+#include "mpvcore.h"
+#include "mpvkeyframeindex.h"
+#include "mpvlatencytracker.h"
+#include "mpvlogsink.h"
+#include "mpvmediamodels.h"
+#include <QElapsedTimer>
 #include <QLoggingCategory>
+#include <QPointer>
 #include <QQuickFramebufferObject>
+#include <QSharedPointer>
+#include <QTimer>
 
 Q_DECLARE_LOGGING_CATEGORY(lcMpv)
-Q_DECLARE_LOGGING_CATEGORY(lcMpvLog)
 Q_DECLARE_LOGGING_CATEGORY(lcMpvEvent)
-Q_DECLARE_LOGGING_CATEGORY(lcMpvCommand)
-Q_DECLARE_LOGGING_CATEGORY(lcMpvProperty)
-Q_DECLARE_LOGGING_CATEGORY(lcMpvMisc)
 
 QT_FORWARD_DECLARE_CLASS(MpvRenderer)
+QT_FORWARD_DECLARE_CLASS(MpvRenderTimings)
+QT_FORWARD_DECLARE_CLASS(MpvFrameTap)
 
 class MpvObject : public QQuickFramebufferObject
 {
@@ -113,6 +120,11 @@ class MpvObject : public QQuickFramebufferObject
     Q_PROPERTY(QStringList subtitleSuffixes READ subtitleSuffixes CONSTANT)
     Q_PROPERTY(Chapters chapters READ chapters NOTIFY chaptersChanged)
     Q_PROPERTY(Metadata metadata READ metadata NOTIFY metadataChanged)
+    Q_PROPERTY(MpvTrackModel *videoTrackModel READ videoTrackModel CONSTANT)
+    Q_PROPERTY(MpvTrackModel *audioTrackModel READ audioTrackModel CONSTANT)
+    Q_PROPERTY(MpvTrackModel *subtitleTrackModel READ subtitleTrackModel CONSTANT)
+    Q_PROPERTY(MpvChapterModel *chapterModel READ chapterModel CONSTANT)
+    Q_PROPERTY(MpvMetadataModel *metadataModel READ metadataModel CONSTANT)
     Q_PROPERTY(qreal avsync READ avsync NOTIFY avsyncChanged)
     Q_PROPERTY(int percentPos READ percentPos WRITE setPercentPos NOTIFY percentPosChanged)
     Q_PROPERTY(qreal estimatedVfFps READ estimatedVfFps NOTIFY estimatedVfFpsChanged)
@@ -120,6 +132,38 @@ class MpvObject : public QQuickFramebufferObject
     Q_PROPERTY(bool livePreview READ livePreview WRITE setLivePreview NOTIFY livePreviewChanged)
     Q_PROPERTY(QString positionText READ positionText NOTIFY positionTextChanged)
     Q_PROPERTY(QString durationText READ durationText NOTIFY durationTextChanged)
+    Q_PROPERTY(
+        bool asynchronous READ asynchronous WRITE setAsynchronous NOTIFY asynchronousChanged)
+    Q_PROPERTY(bool ready READ ready NOTIFY readyChanged)
+    Q_PROPERTY(QList<QUrl> playlist READ playlist NOTIFY playlistChanged)
+    Q_PROPERTY(
+        int playlistIndex READ playlistIndex WRITE setPlaylistIndex NOTIFY playlistIndexChanged)
+    Q_PROPERTY(bool gapless READ gapless WRITE setGapless NOTIFY gaplessChanged)
+    Q_PROPERTY(bool prefetchPlaylist READ prefetchPlaylist WRITE setPrefetchPlaylist NOTIFY
+                   prefetchPlaylistChanged)
+    Q_PROPERTY(qreal transitionLatency READ transitionLatency NOTIFY transitionLatencyChanged)
+    Q_PROPERTY(Priority priority READ priority WRITE setPriority NOTIFY priorityChanged)
+    Q_PROPERTY(qreal renderScale READ renderScale WRITE setRenderScale NOTIFY renderScaleChanged)
+    Q_PROPERTY(qint64 demuxerMaxBytes READ demuxerMaxBytes WRITE setDemuxerMaxBytes NOTIFY
+                   demuxerMaxBytesChanged)
+    Q_PROPERTY(qint64 demuxerMaxBackBytes READ demuxerMaxBackBytes WRITE setDemuxerMaxBackBytes
+                   NOTIFY demuxerMaxBackBytesChanged)
+    Q_PROPERTY(qint64 cacheBytes READ cacheBytes NOTIFY cacheBytesChanged)
+    Q_PROPERTY(MpvCacheTelemetry *cacheTelemetry READ cacheTelemetry CONSTANT)
+    Q_PROPERTY(MpvLatencyTracker *latency READ latency CONSTANT)
+    Q_PROPERTY(MpvLogSink *logSink READ logSink CONSTANT)
+    Q_PROPERTY(qint64 queueOverflows READ queueOverflows NOTIFY queueOverflowsChanged)
+    Q_PROPERTY(bool lowLatency READ lowLatency WRITE setLowLatency NOTIFY lowLatencyChanged)
+    Q_PROPERTY(
+        qreal targetLatency READ targetLatency WRITE setTargetLatency NOTIFY targetLatencyChanged)
+    Q_PROPERTY(qreal maxLatency READ maxLatency WRITE setMaxLatency NOTIFY maxLatencyChanged)
+    Q_PROPERTY(qreal liveLatency READ liveLatency NOTIFY liveLatencyChanged)
+    Q_PROPERTY(qint64 frameNumber READ frameNumber NOTIFY frameNumberChanged)
+    Q_PROPERTY(qint64 stepCacheBytes READ stepCacheBytes WRITE setStepCacheBytes NOTIFY
+                   stepCacheBytesChanged)
+    Q_PROPERTY(MpvKeyframeIndex *keyframeIndex READ keyframeIndex WRITE setKeyframeIndex NOTIFY
+                   keyframeIndexChanged)
+    Q_PROPERTY(bool scrubbing READ scrubbing WRITE setScrubbing NOTIFY scrubbingChanged)
 
 public:
     enum class PlaybackState { Stopped, Playing, Paused };
@@ -144,6 +188,10 @@ public:
     enum class MpvCallType { Synchronous, Asynchronous };
     Q_ENUM(MpvCallType)
 
+    // See MpvResourceScheduler.
+    enum class Priority { Automatic, Focused, Visible, SmallTile, OffScreen };
+    Q_ENUM(Priority)
+
     struct MediaTracks
     {
         QList<QVariantHash> videoChannels = {};
@@ -163,6 +211,9 @@ public:
     static void on_update(void *ctx);
     Renderer *createRenderer() const override;
 
+    void classBegin() override;
+    void componentComplete() override;
+
     // Current media's source in QUrl.
     QUrl source() const;
     // Currently played file, with path stripped. If this is an URL, try to undo
@@ -425,6 +476,13 @@ public:
     Chapters chapters() const;
     // Metadata map
     Metadata metadata() const;
+    // The same as mediaTracks(), chapters() and metadata(), as models that
+    // are updated in place.
+    MpvTrackModel *videoTrackModel() const;
+    MpvTrackModel *audioTrackModel() const;
+    MpvTrackModel *subtitleTrackModel() const;
+    MpvChapterModel *chapterModel() const;
+    MpvMetadataModel *metadataModel() const;
     // Last A/V synchronization difference. Unavailable if audio or video is
     // disabled.
     qreal avsync() const;
@@ -455,6 +513,119 @@ public:
 
     QString durationText() const;
 
+    // Create and initialize the mpv handle on a worker thread instead of
+    // blocking the GUI thread. Only has an effect when set from QML, before
+    // the component is complete. Property changes and commands issued before
+    // the player is ready are queued and replayed in order.
+    bool asynchronous() const;
+    // Whether the mpv handle exists. Always true for players that are not
+    // asynchronous, once they are complete.
+    bool ready() const;
+
+    // Every item of the playlist, in playback order. The current one is
+    // also the source.
+    QList<QUrl> playlist() const;
+    // The entries of mpv's "playlist" property as of the last
+    // playlistChanged(), one map per item ("filename", "id", and "title",
+    // "current" or "playing" when applicable).
+    QVariantList playlistEntries() const;
+    // Index of the current item of the playlist, -1 if there's none.
+    int playlistIndex() const;
+    // --gapless-audio=<no|yes|weak>
+    // Try to play consecutive audio files with no silence or disruption at
+    // the point of file change (enabled by default).
+    bool gapless() const;
+    // --prefetch-playlist=<yes|no>
+    // Prefetch the next playlist entry while playback of the current entry
+    // is ending, so that its demuxer is warmed up when it starts (enabled by
+    // default).
+    bool prefetchPlaylist() const;
+    // How long the last switch from one item to the next took, in
+    // milliseconds: from the end of the previous item to the moment the
+    // next one started playing.
+    qreal transitionLatency() const;
+    // The priority MpvResourceScheduler gives this player. Automatic (the
+    // default) lets it work it out from the item.
+    Priority priority() const;
+    // The resolution the video is rendered at, relative to the size of the
+    // item (0.1 - 1.0). Scaled down frames are stretched to fill the item.
+    // Managed by MpvResourceScheduler when it's enabled.
+    qreal renderScale() const;
+    // --demuxer-max-bytes=<bytesize>
+    // How much the demuxer is allowed to buffer ahead, in bytes (150 MiB by
+    // default). Managed by MpvResourceScheduler when it has a memory budget.
+    qint64 demuxerMaxBytes() const;
+    // --demuxer-max-back-bytes=<bytesize>
+    // How much already played data the demuxer keeps for seeking back, in
+    // bytes (50 MiB by default). Managed by MpvResourceScheduler when it has
+    // a memory budget.
+    qint64 demuxerMaxBackBytes() const;
+    // The memory the demuxer cache actually uses right now, in bytes
+    // ("total-bytes" of demuxer-cache-state).
+    qint64 cacheBytes() const;
+    // The state of the demuxer cache, in detail.
+    MpvCacheTelemetry *cacheTelemetry() const;
+    // How long opening files and seeking take.
+    MpvLatencyTracker *latency() const;
+    // Where the log messages of libmpv go.
+    MpvLogSink *logSink() const;
+    // How many times the event queue overflowed, see MpvCore::resync().
+    qint64 queueOverflows() const;
+    // Plays live streams (eg: udp://, rtsp://, srt://) as close to the live
+    // edge as possible: no cache, small probes, no buffering by FFmpeg,
+    // frame dropping, and no audio buffer. The options are applied right
+    // away, the probe options only take effect for the next file. The
+    // previous values are restored when it's disabled.
+    bool lowLatency() const;
+    // In low latency mode, playback is sped up by 10% while liveLatency is
+    // above this, in seconds (0.3 by default).
+    qreal targetLatency() const;
+    // In low latency mode, everything that's buffered is dropped once
+    // liveLatency is above this, in seconds (2.0 by default).
+    qreal maxLatency() const;
+    // How far playback is behind the newest packet the demuxer has read, in
+    // seconds. Only measured in low latency mode.
+    qreal liveLatency() const;
+    // The number of the frame being displayed, counted from 0. It's derived
+    // from the timestamp of the frame and the frame rate of the container,
+    // so it's exact for constant frame rate video, which includes every
+    // frame reached through frameStep() and frameBackStep().
+    qint64 frameNumber() const;
+    // --video-reversal-buffer=<bytesize>
+    // How much memory frameBackStep() may use for decoded frames, in bytes.
+    // 0 (the default) disables the buffer, and each backward step decodes
+    // from the previous keyframe again.
+    qint64 stepCacheBytes() const;
+    // The keyframes of the current source, if known. seek() then uses a
+    // fast keyframe seek whenever the target is a keyframe, and snaps to the
+    // nearest keyframe while scrubbing. Ignored while it indexes another
+    // source, or nothing yet.
+    MpvKeyframeIndex *keyframeIndex() const;
+    // Set while the user drags the seek bar. With a keyframe index, seeks
+    // only go to keyframes meanwhile, and the exact seek to the last target
+    // is done once it's unset.
+    bool scrubbing() const;
+
+    // The controller this item is a view of. Everything but the rendering
+    // happens there.
+    MpvCore *core() const;
+
+    // Same as position(), but in seconds with sub-second precision and
+    // without querying mpv. Updated whenever positionChanged() is emitted.
+    qreal timePos() const;
+
+    // The frame tap currently installed, if any.
+    QSharedPointer<MpvFrameTap> frameTap() const;
+    // Install a tap to receive copies of the rendered frames on other
+    // threads, or pass a null pointer to remove it. Must be called from the
+    // GUI thread. Only the frames that are actually rendered are delivered,
+    // so the item has to be visible.
+    void setFrameTap(const QSharedPointer<MpvFrameTap> &frameTap);
+    // Where the renderer records how long each frame took, if anywhere.
+    // See MpvPerformanceMonitor, which installs one.
+    QSharedPointer<MpvRenderTimings> renderTimings() const;
+    void setRenderTimings(const QSharedPointer<MpvRenderTimings> &renderTimings);
+
     void setSource(const QUrl &source);
     void setMute(const bool mute);
     void setPlaybackState(const PlaybackState playbackState);
@@ -488,6 +659,20 @@ public:
     void setMpvCallType(const MpvCallType mpvCallType);
     void setPercentPos(const int percentPos);
     void setLivePreview(const bool livePreview);
+    void setAsynchronous(const bool asynchronous);
+    void setPlaylistIndex(const int playlistIndex);
+    void setGapless(const bool gapless);
+    void setPrefetchPlaylist(const bool prefetchPlaylist);
+    void setPriority(const Priority priority);
+    void setRenderScale(const qreal renderScale);
+    void setDemuxerMaxBytes(const qint64 demuxerMaxBytes);
+    void setDemuxerMaxBackBytes(const qint64 demuxerMaxBackBytes);
+    void setLowLatency(const bool lowLatency);
+    void setTargetLatency(const qreal targetLatency);
+    void setMaxLatency(const qreal maxLatency);
+    void setStepCacheBytes(const qint64 stepCacheBytes);
+    void setKeyframeIndex(MpvKeyframeIndex *keyframeIndex);
+    void setScrubbing(const bool scrubbing);
 
 public Q_SLOTS:
     bool open(const QUrl &url);
@@ -507,6 +692,14 @@ public Q_SLOTS:
     // relative percent, I will not implement it in a short period of time
     // because I don't think it is useful enough.
     bool seekPercent(const int percent);
+    // Show the next frame, then pause.
+    bool frameStep();
+    // Show the previous frame, then pause. Slow with long GOPs unless
+    // stepCacheBytes is set: playback then runs backward while stepping, so
+    // that the frames of a GOP are decoded once and kept until they are
+    // shown. Leaving that mode (play(), frameStep(), loading another file)
+    // costs one seek.
+    bool frameBackStep();
     bool screenshot();
     // According to mpv's manual, the file path must contain an extension
     // name, otherwise the behavior is arbitrary.
@@ -520,9 +713,21 @@ public Q_SLOTS:
     bool currentIsVideo() const;
     bool currentIsAudio() const;
     bool currentIsMedia() const;
+    // Add an item to the end of the playlist. Starts playing it if nothing
+    // is being played.
+    bool appendToPlaylist(const QUrl &url);
+    // Insert an item before the one at the given index.
+    bool insertIntoPlaylist(const int index, const QUrl &url);
+    // Move an item so that it ends up at the given index.
+    bool movePlaylistItem(const int from, const int to);
+    bool removeFromPlaylist(const int index);
+    // Remove every item, including the current one, which stops playback.
+    bool clearPlaylist();
+    bool playNext();
+    bool playPrevious();
 
 protected Q_SLOTS:
-    void handleMpvEvents();
+    void handleMpvEvent(const mpv_event *event);
 
 private Q_SLOTS:
     void doUpdate();
@@ -533,10 +738,9 @@ private:
     QVariant mpvGetProperty(const QString &name,
                             const bool silent = false,
                             bool *ok = nullptr) const;
-    bool mpvObserveProperty(const QString &name);
 
     void processMpvLogMessage(void *event);
-    void processMpvPropertyChange(void *event);
+    void processMpvPropertyChange(const QString &name, const QVariant &value);
 
     bool isLoaded() const;
     bool isPlaying() const;
@@ -545,33 +749,112 @@ private:
 
     void setMediaStatus(const MediaStatus mediaStatus);
 
+    // Applies or restores the options of the low latency mode.
+    void applyLowLatencyOptions();
+    // Measures liveLatency and catches up with the live edge if needed.
+    void updateLiveLatency();
+    void setCatchingUp(const bool catchingUp);
+    // Makes playback run forward again after frameBackStep().
+    void stopSteppingBackward();
+
     // Should be called when MPV_EVENT_VIDEO_RECONFIG happens.
     // Never do anything expensive here.
     void videoReconfig();
+    // Caches the frame rate for frameNumber(), which changes a lot more
+    // often than the frame rate does.
+    void updateFrameRate();
     // Should be called when MPV_EVENT_AUDIO_RECONFIG happens.
     // Never do anything expensive here.
     void audioReconfig();
 
     void playbackStateChangeEvent();
 
+    // Should be called when the "playlist" property changes.
+    void updatePlaylist(const QVariantList &entries);
+    // Follows the current item of the playlist.
+    void updateSourceFromPlaylist();
+    // Switches between Loaded, Stalled, Buffering and Buffered according to
+    // the state of the cache, once the file is loaded.
+    void updateBufferingStatus();
+
 private:
     friend class MpvRenderer;
+    friend class MpvHandlePool;
+    friend class MpvResourceScheduler;
+    friend class MpvPerformanceMonitor;
 
-    mpv_handle *m_mpv = nullptr;
+    MpvCore *m_core = nullptr;
     mpv_render_context *m_mpvGL = nullptr;
 
     QUrl currentSource = QUrl();
     MediaStatus currentMediaStatus = MediaStatus::NoMedia;
     MpvCallType currentMpvCallType = MpvCallType::Synchronous;
     bool currentLivePreview = false;
+    // Only written on the GUI thread, the renderer copies it while the GUI
+    // thread is blocked in synchronize().
+    qreal currentTimePos = 0.0;
+    qreal m_frameRate = 0.0;
+    QSharedPointer<MpvFrameTap> m_frameTap;
+    QSharedPointer<MpvRenderTimings> m_renderTimings;
+    MpvTrackModel *m_videoTrackModel = nullptr;
+    MpvTrackModel *m_audioTrackModel = nullptr;
+    MpvTrackModel *m_subtitleTrackModel = nullptr;
+    MpvChapterModel *m_chapterModel = nullptr;
+    MpvMetadataModel *m_metadataModel = nullptr;
+    MpvCacheTelemetry *m_cacheTelemetry = nullptr;
+    MpvLatencyTracker *m_latency = nullptr;
+    MpvLogSink *m_logSink = nullptr;
+    bool currentAsynchronous = false;
+    QList<QUrl> currentPlaylist = {};
+    QVariantList m_playlistEntries = {};
+    qreal currentTransitionLatency = 0.0;
+    // Started when an item ends, invalid when no transition is going on.
+    QElapsedTimer m_transitionTimer;
+    Priority currentPriority = Priority::Automatic;
+    // Read by the renderer in synchronize().
+    qreal currentRenderScale = 1.0;
+    bool currentLowLatency = false;
+    qreal currentTargetLatency = 0.3;
+    qreal currentMaxLatency = 2.0;
+    qreal currentLiveLatency = 0.0;
+    // The values the low latency options had before it was enabled.
+    QVariantMap m_savedLatencyOptions = {};
+    bool m_catchingUp = false;
+    qreal m_speedBeforeCatchUp = 1.0;
+    QTimer m_liveLatencyTimer;
+    qint64 currentStepCacheBytes = 0;
+    // Whether frameBackStep() made playback run backward.
+    bool m_steppingBackward = false;
+    QPointer<MpvKeyframeIndex> currentKeyframeIndex;
+    bool currentScrubbing = false;
+    // Where the last seek while scrubbing should have gone, in seconds, if
+    // it was snapped to a keyframe. Negative otherwise.
+    qreal m_pendingExactSeek = -1.0;
+
+    // The properties whose value mpv sends along with the change
+    // notification, instead of having us query it again: the playback
+    // position is needed by the renderer, the lists by the models, the
+    // cache state by MpvResourceScheduler and MpvCacheTelemetry.
+    static inline const QHash<QString, mpv_format> propertyFormats
+        = {{QString::fromUtf8("time-pos"), MPV_FORMAT_DOUBLE},
+           {QString::fromUtf8("playlist"), MPV_FORMAT_NODE},
+           {QString::fromUtf8("track-list"), MPV_FORMAT_NODE},
+           {QString::fromUtf8("chapter-list"), MPV_FORMAT_NODE},
+           {QString::fromUtf8("metadata"), MPV_FORMAT_NODE},
+           {QString::fromUtf8("demuxer-cache-state"), MPV_FORMAT_NODE},
+           {QString::fromUtf8("paused-for-cache"), MPV_FORMAT_FLAG},
+           {QString::fromUtf8("cache-buffering-state"), MPV_FORMAT_INT64}};
 
-    const QHash<QString, QStringList> properties
+    // Observed on every handle by MpvHandlePool::createHandle().
+    static inline const QHash<QString, QStringList> properties
         = {{QString::fromUtf8("dwidth"), {QString::fromUtf8("videoSizeChanged")}},
            {QString::fromUtf8("dheight"), {QString::fromUtf8("videoSizeChanged")}},
            {QString::fromUtf8("duration"),
             {QString::fromUtf8("durationChanged"), QString::fromUtf8("durationTextChanged")}},
            {QString::fromUtf8("time-pos"),
-            {QString::fromUtf8("positionChanged"), QString::fromUtf8("positionTextChanged")}},
+            {QString::fromUtf8("positionChanged"),
+             QString::fromUtf8("positionTextChanged"),
+             QString::fromUtf8("frameNumberChanged")}},
            {QString::fromUtf8("volume"), {QString::fromUtf8("volumeChanged")}},
            {QString::fromUtf8("mute"), {QString::fromUtf8("muteChanged")}},
            {QString::fromUtf8("seekable"), {QString::fromUtf8("seekableChanged")}},
@@ -623,7 +906,18 @@ private:
             {QString::fromUtf8("percentPosChanged"),
              QString::fromUtf8("positionChanged"),
              QString::fromUtf8("positionTextChanged")}},
-           {QString::fromUtf8("estimated-vf-fps"), {QString::fromUtf8("estimatedVfFpsChanged")}}};
+           {QString::fromUtf8("estimated-vf-fps"), {QString::fromUtf8("estimatedVfFpsChanged")}},
+           {QString::fromUtf8("playlist"), {QString::fromUtf8("playlistChanged")}},
+           {QString::fromUtf8("playlist-pos"), {QString::fromUtf8("playlistIndexChanged")}},
+           {QString::fromUtf8("gapless-audio"), {QString::fromUtf8("gaplessChanged")}},
+           {QString::fromUtf8("prefetch-playlist"),
+            {QString::fromUtf8("prefetchPlaylistChanged")}},
+           {QString::fromUtf8("demuxer-max-bytes"), {QString::fromUtf8("demuxerMaxBytesChanged")}},
+           {QString::fromUtf8("demuxer-max-back-bytes"),
+            {QString::fromUtf8("demuxerMaxBackBytesChanged")}},
+           {QString::fromUtf8("demuxer-cache-state"), {QString::fromUtf8("cacheBytesChanged")}},
+           {QString::fromUtf8("paused-for-cache"), {}},
+           {QString::fromUtf8("cache-buffering-state"), {}}};
 
     // These properties are changing all the time during the playback process.
     // So we have to add them to the black list, otherwise we'll get huge
@@ -634,11 +928,18 @@ private:
                                            QString::fromUtf8("video-bitrate"),
                                            QString::fromUtf8("audio-bitrate"),
                                            QString::fromUtf8("estimated-vf-fps"),
-                                           QString::fromUtf8("avsync")};
+                                           QString::fromUtf8("demuxer-cache-state"),
+                                           QString::fromUtf8("cache-buffering-state"),
+                                           QString::fromUtf8("avsync"),
+                                           // Whole lists, formatting them would
+                                           // cost more than handling the change.
+                                           QString::fromUtf8("playlist"),
+                                           QString::fromUtf8("track-list"),
+                                           QString::fromUtf8("chapter-list"),
+                                           QString::fromUtf8("metadata")};
 
 Q_SIGNALS:
     void onUpdate();
-    void hasMpvEvents();
     void initFinished();
 
     void loaded();
@@ -651,6 +952,7 @@ Q_SIGNALS:
     void playbackStateChanged();
     void mediaStatusChanged();
     void logLevelChanged();
+    void queueOverflowsChanged();
     void durationChanged();
     void positionChanged();
     void volumeChanged();
@@ -699,6 +1001,26 @@ Q_SIGNALS:
     void livePreviewChanged();
     void positionTextChanged();
     void durationTextChanged();
+    void asynchronousChanged();
+    void readyChanged();
+    void playlistChanged();
+    void playlistIndexChanged();
+    void gaplessChanged();
+    void prefetchPlaylistChanged();
+    void transitionLatencyChanged();
+    void priorityChanged();
+    void renderScaleChanged();
+    void demuxerMaxBytesChanged();
+    void demuxerMaxBackBytesChanged();
+    void cacheBytesChanged();
+    void lowLatencyChanged();
+    void targetLatencyChanged();
+    void maxLatencyChanged();
+    void liveLatencyChanged();
+    void frameNumberChanged();
+    void stepCacheBytesChanged();
+    void keyframeIndexChanged();
+    void scrubbingChanged();
 };
 
 Q_DECLARE_METATYPE(MpvObject::MediaTracks)
@@ -0,0 +1,169 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvpcmpipe.h"
+
+#include <QDir>
+#include <QThread>
+#include <QUuid>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MpvPcmPipe::MpvPcmPipe()
+{
+    m_path = QDir::temp().filePath(
+        QString::fromUtf8("libmpv-pcm-%1.raw")
+            .arg(QUuid::createUuid().toString(QUuid::WithoutBraces)));
+}
+
+MpvPcmPipe::~MpvPcmPipe()
+{
+    close();
+}
+
+bool MpvPcmPipe::open()
+{
+    if (isOpen()) {
+        return true;
+    }
+    m_writerFinished = false;
+#ifdef Q_OS_UNIX
+    const QByteArray nativePath = QFile::encodeName(m_path);
+    if (::mkfifo(nativePath.constData(), 0600) != 0) {
+        return false;
+    }
+    // Open the reading end without blocking: mpv's fopen() for writing only
+    // succeeds once a reader exists, and we don't know yet if it will ever
+    // get that far (the file may have no audio at all).
+    m_fd = ::open(nativePath.constData(), O_RDONLY | O_NONBLOCK);
+    if (m_fd < 0) {
+        ::unlink(nativePath.constData());
+        return false;
+    }
+    m_writerSeen = false;
+    return true;
+#else
+    m_file.setFileName(m_path);
+    // Create it empty first, so that it can be opened for reading right now.
+    if (!m_file.open(QFile::WriteOnly | QFile::Truncate)) {
+        return false;
+    }
+    m_file.close();
+    return m_file.open(QFile::ReadOnly);
+#endif
+}
+
+void MpvPcmPipe::close()
+{
+#ifdef Q_OS_UNIX
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+        ::unlink(QFile::encodeName(m_path).constData());
+    }
+#else
+    if (m_file.isOpen()) {
+        m_file.close();
+        QFile::remove(m_path);
+    }
+#endif
+}
+
+bool MpvPcmPipe::isOpen() const
+{
+#ifdef Q_OS_UNIX
+    return (m_fd >= 0);
+#else
+    return m_file.isOpen();
+#endif
+}
+
+QString MpvPcmPipe::path() const
+{
+    return m_path;
+}
+
+qint64 MpvPcmPipe::read(char *data, const qint64 maxSize, const int timeout)
+{
+    if (!isOpen() || !data || (maxSize <= 0)) {
+        return -1;
+    }
+#ifdef Q_OS_UNIX
+    pollfd pfd = {};
+    pfd.fd = m_fd;
+    pfd.events = POLLIN;
+    const int pollResult = ::poll(&pfd, 1, qMax(timeout, 0));
+    if (pollResult < 0) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+    if (pollResult == 0) {
+        return (m_writerFinished && !m_writerSeen) ? -1 : 0;
+    }
+    const auto bytesRead = static_cast<qint64>(::read(m_fd, data, static_cast<size_t>(maxSize)));
+    if (bytesRead > 0) {
+        m_writerSeen = true;
+        return bytesRead;
+    }
+    if ((bytesRead < 0) && ((errno == EAGAIN) || (errno == EINTR))) {
+        return 0;
+    }
+    // End of stream: the writer has closed its end. Some systems report a
+    // hang-up before any writer has connected, don't mistake that for the
+    // end unless mpv told us it's done.
+    if (m_writerSeen || m_writerFinished) {
+        // mpv reopens the pipe whenever its audio output is reinitialized.
+        m_writerSeen = false;
+        return -1;
+    }
+    QThread::msleep(static_cast<unsigned long>(qBound(1, timeout, 20)));
+    return 0;
+#else
+    // mpv reopens (and truncates) the file if the audio output has to be
+    // reinitialized, start over in that case.
+    if (m_file.size() < m_file.pos()) {
+        m_file.seek(0);
+    }
+    if (m_file.bytesAvailable() <= 0) {
+        if (m_writerFinished) {
+            return -1;
+        }
+        QThread::msleep(static_cast<unsigned long>(qBound(1, timeout, 20)));
+        if (m_file.bytesAvailable() <= 0) {
+            return 0;
+        }
+    }
+    return m_file.read(data, maxSize);
+#endif
+}
+
+void MpvPcmPipe::setWriterFinished()
+{
+    m_writerFinished = true;
+}
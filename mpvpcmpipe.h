@@ -0,0 +1,79 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <QFile>
+#include <QString>
+
+// Carries the raw PCM written by mpv's "pcm" audio output (ao=pcm) to the
+// code that analyzes it, without ever storing the whole stream. On Unix the
+// path is a named pipe, so mpv blocks whenever the reader falls behind and
+// the memory usage stays constant whatever the length of the file. Elsewhere
+// it's a temporary file that is followed while mpv writes to it.
+//
+// Usage:
+//     MpvPcmPipe pipe;
+//     pipe.open();
+//     options.insert("ao", "pcm");
+//     options.insert("ao-pcm-file", pipe.path());
+//     ...
+//     while ((bytes = pipe.read(buffer, size, 50)) >= 0) { ... }
+class MpvPcmPipe
+{
+    Q_DISABLE_COPY_MOVE(MpvPcmPipe)
+
+public:
+    MpvPcmPipe();
+    ~MpvPcmPipe();
+
+    // Creates the pipe (or file) and opens its reading end.
+    bool open();
+    void close();
+    bool isOpen() const;
+    // To be used as the "ao-pcm-file" option.
+    QString path() const;
+
+    // Reads up to "maxSize" bytes, waiting at most "timeout" milliseconds for
+    // data to arrive. Returns the number of bytes read (0 on timeout) or -1
+    // once the writer has finished and everything has been read. mpv may
+    // start writing again later on (eg: after the audio output has been
+    // reinitialized), so -1 is not necessarily the end for long-lived
+    // readers.
+    qint64 read(char *data, const qint64 maxSize, const int timeout);
+    // Tells the pipe that mpv is done with the current file (the
+    // MPV_EVENT_END_FILE has been received). Required on platforms without
+    // named pipes, where the end of the stream can't be detected otherwise.
+    void setWriterFinished();
+
+private:
+    QString m_path = QString();
+    bool m_writerFinished = false;
+#ifdef Q_OS_UNIX
+    int m_fd = -1;
+    bool m_writerSeen = false;
+#else
+    QFile m_file;
+#endif
+};
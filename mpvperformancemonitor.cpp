@@ -0,0 +1,402 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvperformancemonitor.h"
+#include "mpvobject.h"
+
+#include <QDebug>
+#include <limits>
+
+Q_LOGGING_CATEGORY(lcMpvPerformance, "libmpv.performance.general")
+
+namespace {
+
+// Upper bounds of the histogram buckets, the last bucket takes the rest.
+QVector<qreal> bucketBounds(const QString &metric)
+{
+    if (metric == QString::fromUtf8("renderTime")) {
+        return {1.0, 2.0, 4.0, 8.0, 16.0, 33.0, 66.0};
+    }
+    if (metric == QString::fromUtf8("renderFps")) {
+        return {10.0, 20.0, 24.0, 30.0, 50.0, 60.0, 120.0};
+    }
+    if (metric == QString::fromUtf8("cachedDuration")) {
+        return {0.5, 1.0, 2.0, 5.0, 10.0, 30.0, 60.0};
+    }
+    // Events per sample.
+    return {0.0, 1.0, 2.0, 5.0, 10.0, 20.0, 50.0};
+}
+
+int bucketOf(const QVector<qreal> &bounds, const qreal value)
+{
+    for (int i = 0; i != bounds.size(); ++i) {
+        if (value <= bounds.at(i)) {
+            return i;
+        }
+    }
+    return bounds.size();
+}
+
+// How much a counter of mpv grew, counters start over with each file.
+qint64 counterDelta(const qint64 previous, const qint64 current)
+{
+    if (previous < 0) {
+        return 0;
+    }
+    return (current >= previous) ? (current - previous) : current;
+}
+
+// Samples that haven't been taken are dropped beyond this, eg: when the
+// monitor is disabled.
+const int m_maxPendingTimings = 4096;
+
+} // namespace
+
+void MpvRenderTimings::add(const qint64 nsecs)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_samples.size() < m_maxPendingTimings) {
+        m_samples.append(nsecs);
+    }
+}
+
+QVector<qint64> MpvRenderTimings::take()
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<qint64> samples = {};
+    samples.swap(m_samples);
+    return samples;
+}
+
+MpvPerformanceMonitor::MpvPerformanceMonitor(MpvObject *player, QObject *parent)
+    : QObject(parent), m_player(player),
+      m_renderTimings(QSharedPointer<MpvRenderTimings>::create())
+{
+    m_timer.setInterval(1000);
+    connect(&m_timer, &QTimer::timeout, this, &MpvPerformanceMonitor::sample);
+    attach();
+}
+
+MpvPerformanceMonitor::~MpvPerformanceMonitor()
+{
+    detach();
+}
+
+MpvPerformanceMonitor *MpvPerformanceMonitor::qmlAttachedProperties(QObject *object)
+{
+    const auto player = qobject_cast<MpvObject *>(object);
+    if (!player) {
+        qCWarning(lcMpvPerformance) << "PerformanceMonitor can only be attached to a MpvObject.";
+    }
+    return new MpvPerformanceMonitor(player, object);
+}
+
+bool MpvPerformanceMonitor::enabled() const
+{
+    return m_timer.isActive();
+}
+
+int MpvPerformanceMonitor::interval() const
+{
+    return m_timer.interval();
+}
+
+int MpvPerformanceMonitor::historySize() const
+{
+    return currentHistorySize;
+}
+
+qint64 MpvPerformanceMonitor::droppedFrames() const
+{
+    return m_droppedFrames;
+}
+
+qint64 MpvPerformanceMonitor::decoderDroppedFrames() const
+{
+    return m_decoderDroppedFrames;
+}
+
+qint64 MpvPerformanceMonitor::delayedFrames() const
+{
+    return m_delayedFrames;
+}
+
+qint64 MpvPerformanceMonitor::queueOverflows() const
+{
+    return m_queueOverflows;
+}
+
+int MpvPerformanceMonitor::underruns() const
+{
+    return m_underruns;
+}
+
+qreal MpvPerformanceMonitor::renderTime() const
+{
+    return m_history.isEmpty() ? 0.0 : m_history.constLast().renderTime;
+}
+
+qreal MpvPerformanceMonitor::maxRenderTime() const
+{
+    return m_maxRenderTime;
+}
+
+qreal MpvPerformanceMonitor::renderFps() const
+{
+    return m_history.isEmpty() ? 0.0 : m_history.constLast().renderFps;
+}
+
+qreal MpvPerformanceMonitor::cachedDuration() const
+{
+    return m_history.isEmpty() ? 0.0 : m_history.constLast().cachedDuration;
+}
+
+QString MpvPerformanceMonitor::hwdecCurrent() const
+{
+    return m_hwdecCurrent;
+}
+
+bool MpvPerformanceMonitor::hwdecFallback() const
+{
+    return m_hwdecFallback;
+}
+
+void MpvPerformanceMonitor::setEnabled(const bool enabled)
+{
+    if (enabled == this->enabled()) {
+        return;
+    }
+    if (enabled) {
+        attach();
+    } else {
+        detach();
+    }
+    Q_EMIT enabledChanged();
+}
+
+void MpvPerformanceMonitor::setInterval(const int interval)
+{
+    if (interval == m_timer.interval()) {
+        return;
+    }
+    m_timer.setInterval(qMax(interval, 1));
+    Q_EMIT intervalChanged();
+}
+
+void MpvPerformanceMonitor::setHistorySize(const int historySize)
+{
+    const int size = qMax(historySize, 1);
+    if (size == currentHistorySize) {
+        return;
+    }
+    currentHistorySize = size;
+    while (m_history.size() > currentHistorySize) {
+        m_history.removeFirst();
+    }
+    Q_EMIT historySizeChanged();
+}
+
+QVariantList MpvPerformanceMonitor::history(const QString &metric) const
+{
+    QVariantList values = {};
+    for (auto &&sample : qAsConst(m_history)) {
+        bool ok = false;
+        const qreal value = metricValue(sample, metric, &ok);
+        if (!ok) {
+            qCWarning(lcMpvPerformance) << "Unknown metric" << metric;
+            return {};
+        }
+        values.append(value);
+    }
+    return values;
+}
+
+QVariantList MpvPerformanceMonitor::histogram(const QString &metric) const
+{
+    const QVector<qreal> bounds = bucketBounds(metric);
+    QVector<int> counts(bounds.size() + 1, 0);
+    for (auto &&sample : qAsConst(m_history)) {
+        if (metric == QString::fromUtf8("renderTime")) {
+            for (int i = 0; i != sample.renderTimeBuckets.size(); ++i) {
+                counts[i] += sample.renderTimeBuckets.at(i);
+            }
+            continue;
+        }
+        bool ok = false;
+        const qreal value = metricValue(sample, metric, &ok);
+        if (!ok) {
+            qCWarning(lcMpvPerformance) << "Unknown metric" << metric;
+            return {};
+        }
+        ++counts[bucketOf(bounds, value)];
+    }
+    QVariantList buckets = {};
+    for (int i = 0; i != counts.size(); ++i) {
+        const qreal upperBound = (i < bounds.size()) ? bounds.at(i)
+                                                     : std::numeric_limits<qreal>::infinity();
+        buckets.append(QVariantMap{{QString::fromUtf8("upperBound"), upperBound},
+                                   {QString::fromUtf8("count"), counts.at(i)}});
+    }
+    return buckets;
+}
+
+void MpvPerformanceMonitor::reset()
+{
+    m_history.clear();
+    m_droppedFrames = 0;
+    m_decoderDroppedFrames = 0;
+    m_delayedFrames = 0;
+    m_queueOverflows = 0;
+    m_underruns = 0;
+    m_maxRenderTime = 0.0;
+    m_renderTimings->take();
+    Q_EMIT updated();
+}
+
+void MpvPerformanceMonitor::sample()
+{
+    if (!m_player) {
+        return;
+    }
+    Sample sample;
+
+    // The counters are unavailable while nothing is being played.
+    const auto counter = [this](const char *name) -> qint64 {
+        bool ok = false;
+        const QVariant value = m_player->mpvGetProperty(QString::fromUtf8(name), true, &ok);
+        return (ok && value.isValid()) ? value.toLongLong() : 0;
+    };
+    const qint64 dropped = counter("frame-drop-count");
+    const qint64 decoderDropped = counter("decoder-frame-drop-count");
+    const qint64 delayed = counter("vo-delayed-frame-count");
+    sample.droppedFrames = counterDelta(m_lastDroppedFrames, dropped);
+    sample.decoderDroppedFrames = counterDelta(m_lastDecoderDroppedFrames, decoderDropped);
+    sample.delayedFrames = counterDelta(m_lastDelayedFrames, delayed);
+    m_lastDroppedFrames = dropped;
+    m_lastDecoderDroppedFrames = decoderDropped;
+    m_lastDelayedFrames = delayed;
+    m_droppedFrames += static_cast<qint64>(sample.droppedFrames);
+    m_decoderDroppedFrames += static_cast<qint64>(sample.decoderDroppedFrames);
+    m_delayedFrames += static_cast<qint64>(sample.delayedFrames);
+
+    sample.queueOverflows = m_pendingQueueOverflows;
+    m_queueOverflows += m_pendingQueueOverflows;
+    m_pendingQueueOverflows = 0;
+
+    const MpvCacheTelemetry *cache = m_player->cacheTelemetry();
+    sample.underruns = counterDelta(m_lastUnderruns, cache->underrunCount());
+    m_lastUnderruns = cache->underrunCount();
+    m_underruns += static_cast<int>(sample.underruns);
+    sample.cachedDuration = cache->cachedDuration();
+
+    const QVector<qint64> timings = m_renderTimings->take();
+    const QVector<qreal> bounds = bucketBounds(QString::fromUtf8("renderTime"));
+    sample.renderTimeBuckets.fill(0, bounds.size() + 1);
+    qreal total = 0.0;
+    for (auto &&nsecs : qAsConst(timings)) {
+        const qreal msecs = static_cast<qreal>(nsecs) / 1000000.0;
+        total += msecs;
+        m_maxRenderTime = qMax(m_maxRenderTime, msecs);
+        ++sample.renderTimeBuckets[bucketOf(bounds, msecs)];
+    }
+    sample.renderTime = timings.isEmpty() ? 0.0 : (total / timings.size());
+    sample.renderFps = timings.size() * 1000.0 / m_timer.interval();
+
+    m_hwdecCurrent = m_player->mpvGetProperty(QString::fromUtf8("hwdec-current"), true).toString();
+    const QString requested = m_player->hwdec();
+    m_hwdecFallback = !requested.isEmpty() && (requested != QString::fromUtf8("no"))
+                      && m_player->currentIsVideo() && !m_player->isStopped()
+                      && (m_hwdecCurrent.isEmpty() || (m_hwdecCurrent == QString::fromUtf8("no")));
+
+    m_history.append(sample);
+    while (m_history.size() > currentHistorySize) {
+        m_history.removeFirst();
+    }
+    Q_EMIT updated();
+}
+
+void MpvPerformanceMonitor::handleMpvEvent(const mpv_event *event)
+{
+    if (event->event_id == MPV_EVENT_QUEUE_OVERFLOW) {
+        ++m_pendingQueueOverflows;
+    }
+}
+
+qreal MpvPerformanceMonitor::metricValue(const Sample &sample, const QString &metric, bool *ok)
+{
+    *ok = true;
+    if (metric == QString::fromUtf8("droppedFrames")) {
+        return sample.droppedFrames;
+    }
+    if (metric == QString::fromUtf8("decoderDroppedFrames")) {
+        return sample.decoderDroppedFrames;
+    }
+    if (metric == QString::fromUtf8("delayedFrames")) {
+        return sample.delayedFrames;
+    }
+    if (metric == QString::fromUtf8("queueOverflows")) {
+        return sample.queueOverflows;
+    }
+    if (metric == QString::fromUtf8("underruns")) {
+        return sample.underruns;
+    }
+    if (metric == QString::fromUtf8("renderTime")) {
+        return sample.renderTime;
+    }
+    if (metric == QString::fromUtf8("renderFps")) {
+        return sample.renderFps;
+    }
+    if (metric == QString::fromUtf8("cachedDuration")) {
+        return sample.cachedDuration;
+    }
+    *ok = false;
+    return 0.0;
+}
+
+void MpvPerformanceMonitor::attach()
+{
+    if (!m_player) {
+        return;
+    }
+    m_player->setRenderTimings(m_renderTimings);
+    connect(m_player->core(),
+            &MpvCore::eventReceived,
+            this,
+            &MpvPerformanceMonitor::handleMpvEvent,
+            Qt::UniqueConnection);
+    m_lastUnderruns = m_player->cacheTelemetry()->underrunCount();
+    m_timer.start();
+}
+
+void MpvPerformanceMonitor::detach()
+{
+    m_timer.stop();
+    if (!m_player) {
+        return;
+    }
+    disconnect(m_player->core(), nullptr, this, nullptr);
+    if (m_player->renderTimings() == m_renderTimings) {
+        m_player->setRenderTimings({});
+    }
+}
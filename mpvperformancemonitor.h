@@ -0,0 +1,206 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+// Don't use any deprecated APIs from MPV.
+#ifdef MPV_ENABLE_DEPRECATED
+#undef MPV_ENABLE_DEPRECATED
+#endif
+
+#define MPV_ENABLE_DEPRECATED 0
+
+#include "mpvqthelper.hpp"
+#include <QLoggingCategory>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QVariantList>
+#include <QVector>
+#include <QtQml/qqml.h>
+
+Q_DECLARE_LOGGING_CATEGORY(lcMpvPerformance)
+
+class MpvObject;
+
+// The time each frame took to render, filled on the render thread and
+// drained by MpvPerformanceMonitor.
+class MpvRenderTimings
+{
+    Q_DISABLE_COPY_MOVE(MpvRenderTimings)
+
+public:
+    MpvRenderTimings() = default;
+    ~MpvRenderTimings() = default;
+
+    void add(const qint64 nsecs);
+    // Everything added since the last call, in nanoseconds.
+    QVector<qint64> take();
+
+private:
+    QMutex m_mutex;
+    QVector<qint64> m_samples = {};
+};
+
+// Playback performance of a MpvObject, to diagnose stutter: dropped and
+// delayed frames, render time, event queue overflows, cache health and
+// hardware decoding fallbacks. Attached to a player in QML:
+//
+//     MpvObject {
+//         id: player
+//         PerformanceMonitor.interval: 2000
+//     }
+//     Text { text: player.PerformanceMonitor.droppedFrames }
+//
+// Values are sampled and published every "interval" milliseconds, and the
+// last "historySize" samples of each metric are kept for history() and
+// histogram(). The metrics are:
+//
+// - "droppedFrames", "decoderDroppedFrames", "delayedFrames",
+//   "queueOverflows", "underruns": how many happened during the sample.
+// - "renderTime": average time to render a frame, in milliseconds.
+//   That's the time spent in mpv_render_context_render() on the render
+//   thread, the GPU may still be busy afterwards. Its histogram counts
+//   every frame, not the averages.
+// - "renderFps": frames rendered per second.
+// - "cachedDuration": seconds cached ahead.
+class MpvPerformanceMonitor : public QObject
+{
+    Q_OBJECT
+    QML_NAMED_ELEMENT(PerformanceMonitor)
+    QML_UNCREATABLE("PerformanceMonitor is only available as an attached property of MpvObject.")
+    QML_ATTACHED(MpvPerformanceMonitor)
+    Q_DISABLE_COPY_MOVE(MpvPerformanceMonitor)
+
+    Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(int interval READ interval WRITE setInterval NOTIFY intervalChanged)
+    Q_PROPERTY(int historySize READ historySize WRITE setHistorySize NOTIFY historySizeChanged)
+    Q_PROPERTY(qint64 droppedFrames READ droppedFrames NOTIFY updated)
+    Q_PROPERTY(qint64 decoderDroppedFrames READ decoderDroppedFrames NOTIFY updated)
+    Q_PROPERTY(qint64 delayedFrames READ delayedFrames NOTIFY updated)
+    Q_PROPERTY(qint64 queueOverflows READ queueOverflows NOTIFY updated)
+    Q_PROPERTY(int underruns READ underruns NOTIFY updated)
+    Q_PROPERTY(qreal renderTime READ renderTime NOTIFY updated)
+    Q_PROPERTY(qreal maxRenderTime READ maxRenderTime NOTIFY updated)
+    Q_PROPERTY(qreal renderFps READ renderFps NOTIFY updated)
+    Q_PROPERTY(qreal cachedDuration READ cachedDuration NOTIFY updated)
+    Q_PROPERTY(QString hwdecCurrent READ hwdecCurrent NOTIFY updated)
+    Q_PROPERTY(bool hwdecFallback READ hwdecFallback NOTIFY updated)
+
+public:
+    explicit MpvPerformanceMonitor(MpvObject *player, QObject *parent = nullptr);
+    ~MpvPerformanceMonitor() override;
+
+    static MpvPerformanceMonitor *qmlAttachedProperties(QObject *object);
+
+    // Enabled by default.
+    bool enabled() const;
+    // In milliseconds, defaults to 1000.
+    int interval() const;
+    // Number of samples kept per metric, defaults to 60.
+    int historySize() const;
+    // Totals since the monitor was created or reset() was called.
+    qint64 droppedFrames() const;
+    qint64 decoderDroppedFrames() const;
+    qint64 delayedFrames() const;
+    qint64 queueOverflows() const;
+    int underruns() const;
+    // Of the last sample, in milliseconds.
+    qreal renderTime() const;
+    qreal maxRenderTime() const;
+    qreal renderFps() const;
+    qreal cachedDuration() const;
+    // The hardware decoding API in use, "no" if none.
+    QString hwdecCurrent() const;
+    // Whether hardware decoding has been requested, but the video is
+    // decoded in software.
+    bool hwdecFallback() const;
+
+    void setEnabled(const bool enabled);
+    void setInterval(const int interval);
+    void setHistorySize(const int historySize);
+
+    // The last samples of the metric, oldest first.
+    Q_INVOKABLE QVariantList history(const QString &metric) const;
+    // The samples of the metric kept in the history, counted per bucket:
+    // one map per bucket with "upperBound" (infinite for the last one) and
+    // "count".
+    Q_INVOKABLE QVariantList histogram(const QString &metric) const;
+
+public Q_SLOTS:
+    void reset();
+
+Q_SIGNALS:
+    void enabledChanged();
+    void intervalChanged();
+    void historySizeChanged();
+    // Emitted once per interval.
+    void updated();
+
+private Q_SLOTS:
+    void sample();
+    void handleMpvEvent(const mpv_event *event);
+
+private:
+    struct Sample
+    {
+        qreal droppedFrames = 0.0;
+        qreal decoderDroppedFrames = 0.0;
+        qreal delayedFrames = 0.0;
+        qreal queueOverflows = 0.0;
+        qreal underruns = 0.0;
+        qreal renderTime = 0.0;
+        qreal renderFps = 0.0;
+        qreal cachedDuration = 0.0;
+        // Number of frames per render time bucket.
+        QVector<int> renderTimeBuckets = {};
+    };
+
+    static qreal metricValue(const Sample &sample, const QString &metric, bool *ok);
+    void attach();
+    void detach();
+
+private:
+    QPointer<MpvObject> m_player;
+    QSharedPointer<MpvRenderTimings> m_renderTimings;
+    QTimer m_timer;
+    int currentHistorySize = 60;
+    QVector<Sample> m_history = {};
+    // The counters of mpv as of the previous sample, -1 before the first.
+    qint64 m_lastDroppedFrames = -1;
+    qint64 m_lastDecoderDroppedFrames = -1;
+    qint64 m_lastDelayedFrames = -1;
+    int m_lastUnderruns = 0;
+    qint64 m_pendingQueueOverflows = 0;
+    qint64 m_droppedFrames = 0;
+    qint64 m_decoderDroppedFrames = 0;
+    qint64 m_delayedFrames = 0;
+    qint64 m_queueOverflows = 0;
+    int m_underruns = 0;
+    qreal m_maxRenderTime = 0.0;
+    QString m_hwdecCurrent = {};
+    bool m_hwdecFallback = false;
+};
@@ -0,0 +1,350 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvplaylistmodel.h"
+
+#include <QSet>
+#include <algorithm>
+
+namespace {
+
+// Past this many moves in a single update (eg: the playlist has been
+// shuffled), resetting the model is cheaper than moving rows one by one.
+const int m_maxMoves = 64;
+
+} // namespace
+
+MpvPlaylistModel::MpvPlaylistModel(QObject *parent) : QAbstractListModel(parent) {}
+
+MpvPlaylistModel::~MpvPlaylistModel() = default;
+
+MpvObject *MpvPlaylistModel::player() const
+{
+    return currentPlayer;
+}
+
+int MpvPlaylistModel::count() const
+{
+    return m_items.size();
+}
+
+int MpvPlaylistModel::fetchSize() const
+{
+    return currentFetchSize;
+}
+
+void MpvPlaylistModel::setPlayer(MpvObject *player)
+{
+    if (player == currentPlayer) {
+        return;
+    }
+    for (auto &&connection : qAsConst(m_playerConnections)) {
+        disconnect(connection);
+    }
+    m_playerConnections.clear();
+    currentPlayer = player;
+    if (currentPlayer) {
+        m_playerConnections
+            << connect(currentPlayer, &MpvObject::playlistChanged, this, &MpvPlaylistModel::update)
+            << connect(currentPlayer, &QObject::destroyed, this, &MpvPlaylistModel::update);
+    }
+    Q_EMIT playerChanged();
+    // The rows of another player have nothing to do with the new ones.
+    reset({});
+    update();
+}
+
+void MpvPlaylistModel::setFetchSize(const int fetchSize)
+{
+    const int newFetchSize = qMax(fetchSize, 1);
+    if (newFetchSize == currentFetchSize) {
+        return;
+    }
+    currentFetchSize = newFetchSize;
+    Q_EMIT fetchSizeChanged();
+}
+
+int MpvPlaylistModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_fetchedCount;
+}
+
+QVariant MpvPlaylistModel::data(const QModelIndex &index, const int role) const
+{
+    if (!index.isValid() || (index.row() >= m_fetchedCount)) {
+        return QVariant();
+    }
+    const Item &item = m_items.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return item.title.isEmpty() ? item.url.fileName() : item.title;
+    case UrlRole:
+        return item.url;
+    case TitleRole:
+        return item.title;
+    case IdRole:
+        return item.id;
+    case CurrentRole:
+        return item.current;
+    case PlayingRole:
+        return item.playing;
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> MpvPlaylistModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = QAbstractListModel::roleNames();
+    roles.insert(UrlRole, "url");
+    roles.insert(TitleRole, "title");
+    roles.insert(IdRole, "id");
+    roles.insert(CurrentRole, "current");
+    roles.insert(PlayingRole, "playing");
+    return roles;
+}
+
+bool MpvPlaylistModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && (m_fetchedCount < m_items.size());
+}
+
+void MpvPlaylistModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent)) {
+        return;
+    }
+    const int last = qMin(m_fetchedCount + currentFetchSize, m_items.size()) - 1;
+    beginInsertRows(QModelIndex(), m_fetchedCount, last);
+    m_fetchedCount = last + 1;
+    endInsertRows();
+}
+
+void MpvPlaylistModel::update()
+{
+    const QVariantList entries = currentPlayer ? currentPlayer->playlistEntries() : QVariantList();
+    const QList<QUrl> urls = currentPlayer ? currentPlayer->playlist() : QList<QUrl>();
+    const int oldCount = m_items.size();
+
+    QVector<Item> items = {};
+    items.reserve(entries.size());
+    bool keyed = true;
+    for (int i = 0; i != entries.size(); ++i) {
+        const QVariantMap entry = entries.at(i).toMap();
+        Item item = {};
+        // Entry ids exist since mpv 0.33.
+        keyed = keyed && entry.contains(QString::fromUtf8("id"));
+        item.id = entry.value(QString::fromUtf8("id"), -1).toLongLong();
+        item.url = urls.value(i);
+        item.title = entry.value(QString::fromUtf8("title")).toString();
+        item.current = entry.value(QString::fromUtf8("current")).toBool();
+        item.playing = entry.value(QString::fromUtf8("playing")).toBool();
+        items.append(item);
+    }
+    if (!keyed) {
+        reset(items);
+    } else {
+        QHash<qint64, int> newRows = {};
+        newRows.reserve(items.size());
+        for (int i = 0; i != items.size(); ++i) {
+            newRows.insert(items.at(i).id, i);
+        }
+        // Removals first, in blocks, from the end so the rows don't shift.
+        int row = m_items.size() - 1;
+        while (row >= 0) {
+            if (newRows.contains(m_items.at(row).id)) {
+                --row;
+                continue;
+            }
+            int first = row;
+            while ((first > 0) && !newRows.contains(m_items.at(first - 1).id)) {
+                --first;
+            }
+            removeItems(first, row);
+            row = first - 1;
+        }
+        QSet<qint64> oldIds = {};
+        oldIds.reserve(m_items.size());
+        for (auto &&item : qAsConst(m_items)) {
+            oldIds.insert(item.id);
+        }
+        // Now every remaining row is still in the playlist. Walk the new
+        // playlist, the rows before i are final.
+        int moves = 0;
+        for (int i = 0; i < items.size(); ++i) {
+            const Item &item = items.at(i);
+            if ((i < m_items.size()) && (m_items.at(i).id == item.id)) {
+                setItem(i, item);
+                continue;
+            }
+            if (!oldIds.contains(item.id)) {
+                int last = i;
+                while (((last + 1) < items.size()) && !oldIds.contains(items.at(last + 1).id)) {
+                    ++last;
+                }
+                insertItems(i, items.mid(i, last - i + 1));
+                i = last;
+                continue;
+            }
+            if (++moves > m_maxMoves) {
+                reset(items);
+                break;
+            }
+            // When the wanted row comes right after, it's more likely the
+            // current one that has been moved down, eg: [A, B, C] -> [B, C, A].
+            // Moving every other row up instead would be a lot of moves.
+            if (((i + 1) < m_items.size()) && (m_items.at(i + 1).id == item.id)) {
+                const int newRow = newRows.value(m_items.at(i).id);
+                int to = m_items.size() - 1;
+                if ((newRow + 1) < items.size()) {
+                    const qint64 nextId = items.at(newRow + 1).id;
+                    to = -1;
+                    for (int row = i + 1; row != m_items.size(); ++row) {
+                        if (m_items.at(row).id == nextId) {
+                            // Right before it, once it has shifted up.
+                            to = row - 1;
+                            break;
+                        }
+                    }
+                }
+                if (to > i) {
+                    moveItem(i, to);
+                    // Look at this row again.
+                    --i;
+                    continue;
+                }
+            }
+            int from = i + 1;
+            while (m_items.at(from).id != item.id) {
+                ++from;
+            }
+            moveItem(from, i);
+            setItem(i, item);
+        }
+    }
+    if (m_items.size() != oldCount) {
+        Q_EMIT countChanged();
+    }
+}
+
+void MpvPlaylistModel::reset(const QVector<Item> &items)
+{
+    beginResetModel();
+    m_items = items;
+    m_fetchedCount = qMin(m_items.size(), currentFetchSize);
+    endResetModel();
+}
+
+void MpvPlaylistModel::insertItems(const int row, const QVector<Item> &items)
+{
+    if (items.isEmpty()) {
+        return;
+    }
+    // Rows inserted inside the fetched block are fetched as well. Appending
+    // to a fully fetched model shows the first chunk right away, the views
+    // fetch the rest when they need it.
+    const bool fullyFetched = (m_fetchedCount == m_items.size());
+    int visibleCount = 0;
+    if (row < m_fetchedCount) {
+        visibleCount = items.size();
+    } else if (fullyFetched) {
+        visibleCount = qMin(items.size(), currentFetchSize);
+    }
+    if (visibleCount > 0) {
+        beginInsertRows(QModelIndex(), row, row + visibleCount - 1);
+    }
+    m_items.insert(row, items.size(), Item());
+    std::copy(items.cbegin(), items.cend(), m_items.begin() + row);
+    if (visibleCount > 0) {
+        m_fetchedCount += visibleCount;
+        endInsertRows();
+    }
+}
+
+void MpvPlaylistModel::removeItems(const int first, const int last)
+{
+    const int lastVisible = qMin(last, m_fetchedCount - 1);
+    const bool visible = (first <= lastVisible);
+    if (visible) {
+        beginRemoveRows(QModelIndex(), first, lastVisible);
+    }
+    m_items.remove(first, last - first + 1);
+    if (visible) {
+        m_fetchedCount -= lastVisible - first + 1;
+        endRemoveRows();
+    }
+}
+
+void MpvPlaylistModel::moveItem(const int from, const int to)
+{
+    const bool fromVisible = (from < m_fetchedCount);
+    const bool toVisible = (to < m_fetchedCount);
+    if (fromVisible && toVisible) {
+        // The destination is the row the item ends up before, before the move.
+        beginMoveRows(QModelIndex(), from, from, QModelIndex(), (from < to) ? (to + 1) : to);
+        m_items.move(from, to);
+        endMoveRows();
+    } else if (toVisible) {
+        // Moved into the fetched block, which grows by one row.
+        beginInsertRows(QModelIndex(), to, to);
+        m_items.move(from, to);
+        ++m_fetchedCount;
+        endInsertRows();
+    } else if (fromVisible) {
+        // Moved out of the fetched block, which shrinks by one row.
+        beginRemoveRows(QModelIndex(), from, from);
+        m_items.move(from, to);
+        --m_fetchedCount;
+        endRemoveRows();
+    } else {
+        m_items.move(from, to);
+    }
+}
+
+void MpvPlaylistModel::setItem(const int row, const Item &item)
+{
+    Item &oldItem = m_items[row];
+    QVector<int> roles = {};
+    if (item.url != oldItem.url) {
+        roles << UrlRole << Qt::DisplayRole;
+    }
+    if (item.title != oldItem.title) {
+        roles << TitleRole << Qt::DisplayRole;
+    }
+    if (item.current != oldItem.current) {
+        roles << CurrentRole;
+    }
+    if (item.playing != oldItem.playing) {
+        roles << PlayingRole;
+    }
+    if (roles.isEmpty()) {
+        return;
+    }
+    oldItem = item;
+    if (row < m_fetchedCount) {
+        const QModelIndex modelIndex = index(row);
+        Q_EMIT dataChanged(modelIndex, modelIndex, roles);
+    }
+}
@@ -0,0 +1,108 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "mpvobject.h"
+#include <QAbstractListModel>
+#include <QPointer>
+#include <QUrl>
+#include <QVector>
+#include <QtQml/qqml.h>
+
+// The playlist of a MpvObject, as a list model. Every change of mpv's
+// "playlist" property is turned into the smallest set of row removals,
+// insertions, moves and data changes, keyed by the playlist entry ids, so
+// delegates survive and a change of a single item doesn't touch the others.
+//
+// Rows are handed to the views in chunks of fetchSize() through
+// canFetchMore()/fetchMore(), so that loading a huge playlist doesn't
+// create thousands of rows at once.
+class MpvPlaylistModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_DISABLE_COPY_MOVE(MpvPlaylistModel)
+
+    Q_PROPERTY(MpvObject *player READ player WRITE setPlayer NOTIFY playerChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(int fetchSize READ fetchSize WRITE setFetchSize NOTIFY fetchSizeChanged)
+
+public:
+    enum Roles { UrlRole = Qt::UserRole + 1, TitleRole, IdRole, CurrentRole, PlayingRole };
+    Q_ENUM(Roles)
+
+    explicit MpvPlaylistModel(QObject *parent = nullptr);
+    ~MpvPlaylistModel() override;
+
+    MpvObject *player() const;
+    // Number of items in the playlist, including the ones that haven't been
+    // fetched yet.
+    int count() const;
+    // How many rows fetchMore() adds at once. Defaults to 256.
+    int fetchSize() const;
+
+    void setPlayer(MpvObject *player);
+    void setFetchSize(const int fetchSize);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, const int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+Q_SIGNALS:
+    void playerChanged();
+    void countChanged();
+    void fetchSizeChanged();
+
+private:
+    struct Item
+    {
+        qint64 id = -1;
+        QUrl url = QUrl();
+        QString title = QString();
+        bool current = false;
+        bool playing = false;
+    };
+
+    // Brings the rows in line with the playlist of the player.
+    void update();
+    void reset(const QVector<Item> &items);
+    // These keep the fetched rows in a single block at the beginning, and
+    // only notify the views about the rows they know of.
+    void insertItems(const int row, const QVector<Item> &items);
+    void removeItems(const int first, const int last);
+    void moveItem(const int from, const int to);
+    void setItem(const int row, const Item &item);
+
+private:
+    QPointer<MpvObject> currentPlayer;
+    int currentFetchSize = 256;
+
+    QVector<Item> m_items = {};
+    // The first m_fetchedCount items are the rows of the model.
+    int m_fetchedCount = 0;
+    QList<QMetaObject::Connection> m_playerConnections = {};
+};
@@ -48,6 +48,7 @@
 
 #include <mpv/client.h>
 #include <mpv/render_gl.h>
+#include <mpv/stream_cb.h>
 
 /**
  * Note: these helpers are provided for convenience for C++/Qt applications.
@@ -60,6 +61,7 @@
 #ifdef WWX190_DYNAMIC_LIBMPV
 #include <QDebug>
 #include <QLibrary>
+#include <QMutex>
 #endif
 #include <QVariant>
 
@@ -68,12 +70,14 @@ namespace mpv {
 namespace qt {
 
 #ifdef WWX190_DYNAMIC_LIBMPV
-const char messagePrefix_plugin_init[] = "[PLUGIN] [INIT]";
+inline constexpr char messagePrefix_plugin_init[] = "[PLUGIN] [INIT]";
 
+// The function pointers are inline variables, so that every source file
+// shares the ones resolved by libmpv_init(), whichever file called it.
 #ifndef WWX190_GENERATE_MPVAPI
 #define WWX190_GENERATE_MPVAPI(funcName, resultType, ...) \
     using _WWX190_MPVAPI_lp_##funcName = resultType (*)(__VA_ARGS__); \
-    static _WWX190_MPVAPI_lp_##funcName m_lp_##funcName = nullptr;
+    inline _WWX190_MPVAPI_lp_##funcName m_lp_##funcName = nullptr;
 #endif
 
 #ifndef WWX190_RESOLVE_MPVAPI
@@ -112,6 +116,8 @@ WWX190_GENERATE_MPVAPI(mpv_wait_event, mpv_event *, mpv_handle *, double)
 WWX190_GENERATE_MPVAPI(mpv_create, mpv_handle *)
 WWX190_GENERATE_MPVAPI(mpv_event_name, const char *, mpv_event_id)
 WWX190_GENERATE_MPVAPI(mpv_free_node_contents, void, mpv_node *)
+WWX190_GENERATE_MPVAPI(
+    mpv_stream_cb_add_ro, int, mpv_handle *, const char *, void *, mpv_stream_cb_open_ro_fn)
 #else
 #define m_lp_mpv_get_property mpv_get_property
 #define m_lp_mpv_set_property mpv_set_property
@@ -133,11 +139,26 @@ WWX190_GENERATE_MPVAPI(mpv_free_node_contents, void, mpv_node *)
 #define m_lp_mpv_create mpv_create
 #define m_lp_mpv_event_name mpv_event_name
 #define m_lp_mpv_free_node_contents mpv_free_node_contents
+#define m_lp_mpv_stream_cb_add_ro mpv_stream_cb_add_ro
 #endif
 
-static inline void libmpv_init(const QString &path)
+/**
+ * Return the path of the libmpv library that should be loaded. It can be
+ * changed through the "WWX190_LIBMPV_PATH" environment variable.
+ */
+static inline QString libmpv_path()
+{
+    return qEnvironmentVariable("WWX190_LIBMPV_PATH", QString::fromUtf8("mpv"));
+}
+
+// Not static: the library must be resolved once per process, not once per
+// source file.
+inline void libmpv_init(const QString &path)
 {
 #ifdef WWX190_DYNAMIC_LIBMPV
+    // Players may be initialized on worker threads.
+    static QBasicMutex mutex;
+    const QMutexLocker locker(&mutex);
     static bool resolved = false;
     if (resolved) {
         return;
@@ -165,6 +186,7 @@ static inline void libmpv_init(const QString &path)
     WWX190_RESOLVE_MPVAPI(mpv_create)
     WWX190_RESOLVE_MPVAPI(mpv_event_name)
     WWX190_RESOLVE_MPVAPI(mpv_free_node_contents)
+    WWX190_RESOLVE_MPVAPI(mpv_stream_cb_add_ro)
 #else
     Q_UNUSED(path)
 #endif
@@ -181,6 +203,11 @@ static inline QVariant node_to_variant(const mpv_node *node)
         return QVariant(static_cast<qlonglong>(node->u.int64));
     case MPV_FORMAT_DOUBLE:
         return QVariant(node->u.double_);
+    case MPV_FORMAT_BYTE_ARRAY: {
+        const mpv_byte_array *array = node->u.ba;
+        return QVariant(QByteArray(static_cast<const char *>(array->data),
+                                   static_cast<int>(array->size)));
+    }
     case MPV_FORMAT_NODE_ARRAY: {
         mpv_node_list *list = node->u.list;
         QVariantList qlist;
@@ -460,9 +487,12 @@ static inline int load_config_file(mpv_handle *ctx, const QString &fileName)
     return m_lp_mpv_load_config_file(ctx, qUtf8Printable(fileName));
 }
 
-static inline int observe_property(mpv_handle *ctx, const QString &name, quint64 reply_userdata)
+static inline int observe_property(mpv_handle *ctx,
+                                   const QString &name,
+                                   quint64 reply_userdata,
+                                   mpv_format format = MPV_FORMAT_NONE)
 {
-    return m_lp_mpv_observe_property(ctx, reply_userdata, qUtf8Printable(name), MPV_FORMAT_NONE);
+    return m_lp_mpv_observe_property(ctx, reply_userdata, qUtf8Printable(name), format);
 }
 
 static inline QString error_string(int errCode)
@@ -529,6 +559,14 @@ static inline QString event_name(mpv_event_id event)
     return QString::fromUtf8(m_lp_mpv_event_name(event));
 }
 
+static inline int stream_cb_add_ro(mpv_handle *ctx,
+                                   const QString &protocol,
+                                   void *user_data,
+                                   mpv_stream_cb_open_ro_fn open_fn)
+{
+    return m_lp_mpv_stream_cb_add_ro(ctx, qUtf8Printable(protocol), user_data, open_fn);
+}
+
 } // namespace qt
 
 } // namespace mpv
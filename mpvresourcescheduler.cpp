@@ -0,0 +1,449 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvresourcescheduler.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QJSEngine>
+#include <QPointer>
+#include <QQuickWindow>
+#include <QThread>
+
+Q_LOGGING_CATEGORY(lcMpvScheduler, "libmpv.scheduler.general")
+
+namespace {
+
+// Share of the cores, relative to the other players. Off-screen players
+// always get a single thread.
+int priorityWeight(const MpvObject::Priority priority)
+{
+    switch (priority) {
+    case MpvObject::Priority::Focused:
+        return 8;
+    case MpvObject::Priority::Visible:
+        return 4;
+    case MpvObject::Priority::SmallTile:
+        return 1;
+    default:
+        break;
+    }
+    return 0;
+}
+
+// Seconds of readahead, a focused player is the one most likely to be
+// seeked and watched closely.
+qreal priorityReadahead(const MpvObject::Priority priority)
+{
+    switch (priority) {
+    case MpvObject::Priority::Focused:
+        return 10.0;
+    case MpvObject::Priority::Visible:
+        return 5.0;
+    case MpvObject::Priority::SmallTile:
+        return 2.0;
+    default:
+        break;
+    }
+    return 1.0;
+}
+
+qreal priorityRenderScale(const MpvObject::Priority priority)
+{
+    switch (priority) {
+    case MpvObject::Priority::SmallTile:
+        return 0.75;
+    case MpvObject::Priority::OffScreen:
+        return 0.25;
+    default:
+        break;
+    }
+    return 1.0;
+}
+
+// Share of the memory budget, relative to the other players. Stopped
+// players get m_minCacheBytes instead.
+int cacheWeight(const MpvObject::Priority priority, const MpvObject::PlaybackState state)
+{
+    if (state == MpvObject::PlaybackState::Paused) {
+        return 1;
+    }
+    switch (priority) {
+    case MpvObject::Priority::Focused:
+        return 8;
+    case MpvObject::Priority::Visible:
+        return 4;
+    case MpvObject::Priority::SmallTile:
+        return 2;
+    default:
+        break;
+    }
+    return 1;
+}
+
+// FFmpeg doesn't scale beyond this for a single stream anyway.
+const int m_maxDecoderThreads = 16;
+// The least a player's demuxer cache is given, in bytes.
+const qint64 m_minCacheBytes = 1024 * 1024;
+
+} // namespace
+
+bool MpvResourceScheduler::Allocation::operator==(const Allocation &other) const
+{
+    return (priority == other.priority) && (decoderThreads == other.decoderThreads)
+           && qFuzzyCompare(readaheadSecs, other.readaheadSecs)
+           && qFuzzyCompare(renderScale, other.renderScale) && (maxBytes == other.maxBytes)
+           && (maxBackBytes == other.maxBackBytes);
+}
+
+bool MpvResourceScheduler::Allocation::operator!=(const Allocation &other) const
+{
+    return !(*this == other);
+}
+
+MpvResourceScheduler *MpvResourceScheduler::instance()
+{
+    static QPointer<MpvResourceScheduler> scheduler;
+    if (!scheduler && QCoreApplication::instance() && !QCoreApplication::closingDown()) {
+        // Deleted together with the application object.
+        scheduler = new MpvResourceScheduler(QCoreApplication::instance());
+    }
+    return scheduler;
+}
+
+MpvResourceScheduler *MpvResourceScheduler::create(QQmlEngine *qmlEngine, QJSEngine *jsEngine)
+{
+    Q_UNUSED(qmlEngine)
+    Q_UNUSED(jsEngine)
+    MpvResourceScheduler *scheduler = instance();
+    QJSEngine::setObjectOwnership(scheduler, QJSEngine::CppOwnership);
+    return scheduler;
+}
+
+MpvResourceScheduler::MpvResourceScheduler(QObject *parent) : QObject(parent)
+{
+    m_pollTimer.setInterval(500);
+    connect(&m_pollTimer, &QTimer::timeout, this, &MpvResourceScheduler::rebalance);
+    m_rebalanceTimer.setSingleShot(true);
+    m_rebalanceTimer.setInterval(0);
+    connect(&m_rebalanceTimer, &QTimer::timeout, this, &MpvResourceScheduler::rebalance);
+}
+
+MpvResourceScheduler::~MpvResourceScheduler() = default;
+
+bool MpvResourceScheduler::enabled() const
+{
+    return currentEnabled;
+}
+
+int MpvResourceScheduler::coreCount() const
+{
+    return qMax(QThread::idealThreadCount(), 1);
+}
+
+int MpvResourceScheduler::smallTileHeight() const
+{
+    return currentSmallTileHeight;
+}
+
+int MpvResourceScheduler::interval() const
+{
+    return m_pollTimer.interval();
+}
+
+qint64 MpvResourceScheduler::memoryBudget() const
+{
+    return currentMemoryBudget;
+}
+
+qint64 MpvResourceScheduler::memoryUsage() const
+{
+    qint64 usage = 0;
+    for (auto &&player : qAsConst(m_players)) {
+        usage += player->cacheBytes();
+    }
+    return usage;
+}
+
+int MpvResourceScheduler::playerCount() const
+{
+    return m_players.size();
+}
+
+QVariantList MpvResourceScheduler::allocations() const
+{
+    QVariantList allocations = {};
+    for (auto &&player : qAsConst(m_players)) {
+        const QVariantMap allocation = this->allocation(player);
+        if (!allocation.isEmpty()) {
+            allocations.append(allocation);
+        }
+    }
+    return allocations;
+}
+
+void MpvResourceScheduler::setEnabled(const bool enabled)
+{
+    if (enabled == currentEnabled) {
+        return;
+    }
+    currentEnabled = enabled;
+    if (currentEnabled) {
+        m_pollTimer.start();
+    } else {
+        m_pollTimer.stop();
+    }
+    // Also gives the players their defaults back.
+    rebalance();
+    Q_EMIT enabledChanged();
+}
+
+void MpvResourceScheduler::setSmallTileHeight(const int smallTileHeight)
+{
+    if (smallTileHeight == currentSmallTileHeight) {
+        return;
+    }
+    currentSmallTileHeight = qMax(smallTileHeight, 0);
+    scheduleRebalance();
+    Q_EMIT smallTileHeightChanged();
+}
+
+void MpvResourceScheduler::setInterval(const int interval)
+{
+    if (interval == m_pollTimer.interval()) {
+        return;
+    }
+    m_pollTimer.setInterval(qMax(interval, 1));
+    Q_EMIT intervalChanged();
+}
+
+void MpvResourceScheduler::setMemoryBudget(const qint64 memoryBudget)
+{
+    const qint64 budget = qMax(memoryBudget, qint64(0));
+    if (budget == currentMemoryBudget) {
+        return;
+    }
+    currentMemoryBudget = budget;
+    rebalance();
+    Q_EMIT memoryBudgetChanged();
+}
+
+void MpvResourceScheduler::registerPlayer(MpvObject *player)
+{
+    Q_ASSERT(player);
+    if (!player || m_players.contains(player)) {
+        return;
+    }
+    m_players.append(player);
+    connect(player, &QQuickItem::visibleChanged, this, &MpvResourceScheduler::scheduleRebalance);
+    connect(player, &QQuickItem::opacityChanged, this, &MpvResourceScheduler::scheduleRebalance);
+    connect(player, &QQuickItem::widthChanged, this, &MpvResourceScheduler::scheduleRebalance);
+    connect(player, &QQuickItem::heightChanged, this, &MpvResourceScheduler::scheduleRebalance);
+    connect(player,
+            &QQuickItem::activeFocusChanged,
+            this,
+            &MpvResourceScheduler::scheduleRebalance);
+    connect(player, &QQuickItem::windowChanged, this, &MpvResourceScheduler::scheduleRebalance);
+    connect(player, &MpvObject::priorityChanged, this, &MpvResourceScheduler::scheduleRebalance);
+    connect(player,
+            &MpvObject::playbackStateChanged,
+            this,
+            &MpvResourceScheduler::scheduleRebalance);
+    connect(player,
+            &MpvObject::cacheBytesChanged,
+            this,
+            &MpvResourceScheduler::memoryUsageChanged);
+    scheduleRebalance();
+    Q_EMIT allocationsChanged();
+}
+
+void MpvResourceScheduler::unregisterPlayer(MpvObject *player)
+{
+    if (!m_players.removeOne(player)) {
+        return;
+    }
+    disconnect(player, nullptr, this, nullptr);
+    m_allocations.remove(player);
+    // The others get its share.
+    scheduleRebalance();
+    Q_EMIT allocationsChanged();
+    Q_EMIT memoryUsageChanged();
+}
+
+QVariantMap MpvResourceScheduler::allocation(MpvObject *player) const
+{
+    const auto iterator = m_allocations.constFind(player);
+    if (iterator == m_allocations.cend()) {
+        return {};
+    }
+    return QVariantMap{{QString::fromUtf8("player"), QVariant::fromValue(player)},
+                       {QString::fromUtf8("priority"), QVariant::fromValue(iterator->priority)},
+                       {QString::fromUtf8("decoderThreads"), iterator->decoderThreads},
+                       {QString::fromUtf8("readaheadSecs"), iterator->readaheadSecs},
+                       {QString::fromUtf8("renderScale"), iterator->renderScale},
+                       {QString::fromUtf8("maxBytes"), iterator->maxBytes},
+                       {QString::fromUtf8("maxBackBytes"), iterator->maxBackBytes},
+                       {QString::fromUtf8("cacheBytes"), player->cacheBytes()}};
+}
+
+MpvObject::Priority MpvResourceScheduler::priorityOf(MpvObject *player) const
+{
+    if (!player) {
+        return MpvObject::Priority::OffScreen;
+    }
+    if (player->priority() != MpvObject::Priority::Automatic) {
+        return player->priority();
+    }
+    const QQuickWindow *window = player->window();
+    if (!window || !window->isVisible() || !player->isVisible()
+        || qFuzzyIsNull(player->opacity()) || (player->width() <= 0.0)
+        || (player->height() <= 0.0)) {
+        return MpvObject::Priority::OffScreen;
+    }
+    const QRectF sceneRect = player->mapRectToScene(
+        QRectF(0.0, 0.0, player->width(), player->height()));
+    if (!sceneRect.intersects(QRectF(QPointF(0.0, 0.0), window->size()))) {
+        return MpvObject::Priority::OffScreen;
+    }
+    if (player->hasActiveFocus()) {
+        return MpvObject::Priority::Focused;
+    }
+    if (sceneRect.height() < currentSmallTileHeight) {
+        return MpvObject::Priority::SmallTile;
+    }
+    return MpvObject::Priority::Visible;
+}
+
+void MpvResourceScheduler::rebalance()
+{
+    m_rebalanceTimer.stop();
+    if (!currentEnabled && (currentMemoryBudget <= 0) && m_allocations.isEmpty()) {
+        return;
+    }
+    QVector<MpvObject::Priority> priorities = {};
+    QVector<MpvObject::PlaybackState> states = {};
+    priorities.reserve(m_players.size());
+    states.reserve(m_players.size());
+    int totalWeight = 0;
+    int totalCacheWeight = 0;
+    int stoppedCount = 0;
+    for (auto &&player : qAsConst(m_players)) {
+        const MpvObject::Priority priority = priorityOf(player);
+        const MpvObject::PlaybackState state = player->playbackState();
+        priorities.append(priority);
+        states.append(state);
+        totalWeight += priorityWeight(priority);
+        if (state == MpvObject::PlaybackState::Stopped) {
+            ++stoppedCount;
+        } else {
+            totalCacheWeight += cacheWeight(priority, state);
+        }
+    }
+    const int cores = coreCount();
+    const qint64 cacheBudget = qMax(currentMemoryBudget - (stoppedCount * m_minCacheBytes),
+                                    qint64(0));
+    bool changed = false;
+    for (int i = 0; i != m_players.size(); ++i) {
+        MpvObject *player = m_players.at(i);
+        const MpvObject::Priority priority = priorities.at(i);
+        const MpvObject::PlaybackState state = states.at(i);
+        Allocation allocation;
+        allocation.priority = priority;
+        if (currentEnabled) {
+            const int weight = priorityWeight(priority);
+            allocation.decoderThreads = (weight > 0)
+                                            ? qBound(1,
+                                                     qRound(static_cast<qreal>(cores) * weight
+                                                            / totalWeight),
+                                                     m_maxDecoderThreads)
+                                            : 1;
+            allocation.readaheadSecs = priorityReadahead(priority);
+            allocation.renderScale = priorityRenderScale(priority);
+        }
+        if (currentMemoryBudget > 0) {
+            const qint64 share = (state == MpvObject::PlaybackState::Stopped)
+                                     ? m_minCacheBytes
+                                     : qMax(cacheBudget * cacheWeight(priority, state)
+                                                / qMax(totalCacheWeight, 1),
+                                            m_minCacheBytes);
+            // The same ratio as mpv's defaults.
+            allocation.maxBytes = share * 3 / 4;
+            allocation.maxBackBytes = share - allocation.maxBytes;
+        }
+        const Allocation previous = m_allocations.value(player);
+        const bool managed = (currentEnabled || (currentMemoryBudget > 0));
+        if (!managed) {
+            // Back to the defaults.
+            apply(player, previous, Allocation());
+            continue;
+        }
+        if (m_allocations.contains(player) && (previous == allocation)) {
+            continue;
+        }
+        qCDebug(lcMpvScheduler).nospace()
+            << player << ": priority " << priority << ", " << allocation.decoderThreads
+            << " decoder threads, " << allocation.readaheadSecs << "s readahead, render scale "
+            << allocation.renderScale << ", " << allocation.maxBytes << " + "
+            << allocation.maxBackBytes << " cache bytes";
+        apply(player, previous, allocation);
+        m_allocations.insert(player, allocation);
+        changed = true;
+    }
+    if (!currentEnabled && (currentMemoryBudget <= 0)) {
+        m_allocations.clear();
+        changed = true;
+    }
+    if (changed) {
+        Q_EMIT allocationsChanged();
+    }
+}
+
+void MpvResourceScheduler::scheduleRebalance()
+{
+    if (currentEnabled || (currentMemoryBudget > 0)) {
+        m_rebalanceTimer.start();
+    }
+}
+
+void MpvResourceScheduler::apply(MpvObject *player,
+                                 const Allocation &previous,
+                                 const Allocation &allocation)
+{
+    if (allocation.decoderThreads != previous.decoderThreads) {
+        player->mpvSetProperty(QString::fromUtf8("vd-lavc-threads"), allocation.decoderThreads);
+    }
+    if (!qFuzzyCompare(allocation.readaheadSecs, previous.readaheadSecs)) {
+        player->mpvSetProperty(QString::fromUtf8("demuxer-readahead-secs"),
+                               allocation.readaheadSecs);
+    }
+    if (!qFuzzyCompare(allocation.renderScale, previous.renderScale)) {
+        player->setRenderScale(allocation.renderScale);
+    }
+    if (allocation.maxBytes != previous.maxBytes) {
+        player->setDemuxerMaxBytes(allocation.maxBytes);
+    }
+    if (allocation.maxBackBytes != previous.maxBackBytes) {
+        player->setDemuxerMaxBackBytes(allocation.maxBackBytes);
+    }
+}
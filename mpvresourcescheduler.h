@@ -0,0 +1,173 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "mpvobject.h"
+#include <QHash>
+#include <QLoggingCategory>
+#include <QObject>
+#include <QTimer>
+#include <QVariantList>
+#include <QVector>
+#include <QtQml/qqml.h>
+
+Q_DECLARE_LOGGING_CATEGORY(lcMpvScheduler)
+
+QT_BEGIN_NAMESPACE
+class QQmlEngine;
+class QJSEngine;
+QT_END_NAMESPACE
+
+// Process-wide scheduler that shares the machine between the players of a
+// video wall. Every MpvObject registers with it, and once it's enabled
+// each player gets a share of the decoder threads, a demuxer readahead and
+// a render resolution that depend on its priority:
+//
+// - Focused: the player has the active focus.
+// - Visible: the player is on screen.
+// - SmallTile: the player is on screen, but shorter than smallTileHeight.
+// - OffScreen: the player is hidden, transparent, or outside its window.
+//
+// The priority is worked out from the item unless MpvObject::priority is
+// set explicitly. Clipping by a Flickable is not taken into account, set
+// the priority of the delegates that are scrolled away if that matters.
+//
+// Independently of that, a process-wide memory budget can be set for the
+// demuxer caches. It's divided between the players by priority as well,
+// paused players get a smaller share and stopped ones only keep a minimal
+// cache. Without a budget, each player may use up to 200 MiB (mpv's
+// defaults for --demuxer-max-bytes and --demuxer-max-back-bytes).
+//
+// Allocations are updated as soon as a player is resized, shown, hidden,
+// focused, paused or stopped, and every "interval" milliseconds to catch
+// players that have been moved. Decoder threads (--vd-lavc-threads) only
+// apply when the decoder is initialized, ie: for the next file or track.
+class MpvResourceScheduler : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
+    Q_DISABLE_COPY_MOVE(MpvResourceScheduler)
+
+    Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(int coreCount READ coreCount CONSTANT)
+    Q_PROPERTY(int smallTileHeight READ smallTileHeight WRITE setSmallTileHeight NOTIFY
+                   smallTileHeightChanged)
+    Q_PROPERTY(int interval READ interval WRITE setInterval NOTIFY intervalChanged)
+    Q_PROPERTY(
+        qint64 memoryBudget READ memoryBudget WRITE setMemoryBudget NOTIFY memoryBudgetChanged)
+    Q_PROPERTY(qint64 memoryUsage READ memoryUsage NOTIFY memoryUsageChanged)
+    Q_PROPERTY(int playerCount READ playerCount NOTIFY allocationsChanged)
+    Q_PROPERTY(QVariantList allocations READ allocations NOTIFY allocationsChanged)
+
+public:
+    // What a player has been given.
+    struct Allocation
+    {
+        MpvObject::Priority priority = MpvObject::Priority::Visible;
+        // --vd-lavc-threads, 0 lets FFmpeg decide.
+        int decoderThreads = 0;
+        // --demuxer-readahead-secs
+        qreal readaheadSecs = 1.0;
+        // MpvObject::renderScale
+        qreal renderScale = 1.0;
+        // --demuxer-max-bytes and --demuxer-max-back-bytes
+        qint64 maxBytes = 150 * 1024 * 1024;
+        qint64 maxBackBytes = 50 * 1024 * 1024;
+
+        bool operator==(const Allocation &other) const;
+        bool operator!=(const Allocation &other) const;
+    };
+
+    // Returns null once the application is shutting down.
+    static MpvResourceScheduler *instance();
+    static MpvResourceScheduler *create(QQmlEngine *qmlEngine, QJSEngine *jsEngine);
+
+    ~MpvResourceScheduler() override;
+
+    // Disabled by default, every player then keeps mpv's defaults. Players
+    // are given their defaults back when it's disabled again.
+    bool enabled() const;
+    // Number of logical cores the decoder threads are shared between.
+    int coreCount() const;
+    // In device independent pixels, defaults to 360.
+    int smallTileHeight() const;
+    // In milliseconds, defaults to 500.
+    int interval() const;
+    // Total size of the demuxer caches of all players, in bytes. 0 (the
+    // default) leaves the cache limits alone. A player never gets less
+    // than 1 MiB, so many players may exceed a tiny budget.
+    qint64 memoryBudget() const;
+    // What the demuxer caches of all players actually use, in bytes.
+    qint64 memoryUsage() const;
+    int playerCount() const;
+    // One map per player, in registration order: "player", "priority",
+    // "decoderThreads", "readaheadSecs", "renderScale", "maxBytes",
+    // "maxBackBytes" and "cacheBytes" (what it actually uses).
+    QVariantList allocations() const;
+
+    void setEnabled(const bool enabled);
+    void setSmallTileHeight(const int smallTileHeight);
+    void setInterval(const int interval);
+    void setMemoryBudget(const qint64 memoryBudget);
+
+    // Called by MpvObject.
+    void registerPlayer(MpvObject *player);
+    void unregisterPlayer(MpvObject *player);
+
+    // The allocation of the player, empty if it has none.
+    Q_INVOKABLE QVariantMap allocation(MpvObject *player) const;
+    // The priority the player is scheduled with.
+    Q_INVOKABLE MpvObject::Priority priorityOf(MpvObject *player) const;
+
+public Q_SLOTS:
+    // Works out the priorities and allocations again, right now.
+    void rebalance();
+
+Q_SIGNALS:
+    void enabledChanged();
+    void smallTileHeightChanged();
+    void intervalChanged();
+    void memoryBudgetChanged();
+    void memoryUsageChanged();
+    void allocationsChanged();
+
+private:
+    explicit MpvResourceScheduler(QObject *parent = nullptr);
+
+    // Coalesces the changes that happen during one event loop iteration.
+    void scheduleRebalance();
+    // Only sets what differs from the previous allocation.
+    static void apply(MpvObject *player, const Allocation &previous, const Allocation &allocation);
+
+private:
+    bool currentEnabled = false;
+    int currentSmallTileHeight = 360;
+    qint64 currentMemoryBudget = 0;
+    QVector<MpvObject *> m_players = {};
+    QHash<MpvObject *, Allocation> m_allocations = {};
+    QTimer m_pollTimer;
+    QTimer m_rebalanceTimer;
+};
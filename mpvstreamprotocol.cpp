@@ -0,0 +1,358 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvstreamprotocol.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QIODevice>
+#include <QResource>
+#include <cstring>
+
+Q_LOGGING_CATEGORY(lcMpvStream, "libmpv.stream.general")
+
+namespace {
+
+class MemorySource : public MpvStreamSource
+{
+    Q_DISABLE_COPY_MOVE(MemorySource)
+
+public:
+    explicit MemorySource(const QByteArray &data)
+        : m_keepAlive(data), m_data(data.constData()), m_size(data.size())
+    {}
+    explicit MemorySource(const uchar *data, const qint64 size)
+        : m_data(reinterpret_cast<const char *>(data)), m_size(qMax(size, qint64(0)))
+    {}
+    ~MemorySource() override = default;
+
+    qint64 size() const override { return m_size; }
+
+    qint64 readAt(const qint64 offset, char *data, const qint64 maxSize) override
+    {
+        if ((offset < 0) || (offset > m_size)) {
+            return -1;
+        }
+        const qint64 count = qMin(maxSize, m_size - offset);
+        std::memcpy(data, m_data + offset, static_cast<size_t>(count));
+        return count;
+    }
+
+private:
+    // Keeps the data of a QByteArray alive, without copying it.
+    QByteArray m_keepAlive = {};
+    const char *m_data = nullptr;
+    qint64 m_size = 0;
+};
+
+class DeviceSource : public MpvStreamSource
+{
+    Q_DISABLE_COPY_MOVE(DeviceSource)
+
+public:
+    explicit DeviceSource(const QSharedPointer<QIODevice> &device, const qint64 readAhead)
+        : m_device(device), m_readAhead(qMax(readAhead, qint64(4096))),
+          m_devicePosition(device->pos())
+    {}
+    ~DeviceSource() override = default;
+
+    qint64 size() const override
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_device->isSequential() ? -1 : m_device->size();
+    }
+
+    qint64 readAt(const qint64 offset, char *data, const qint64 maxSize) override
+    {
+        QMutexLocker locker(&m_mutex);
+        const qint64 bufferEnd = m_bufferOffset + m_buffer.size();
+        if ((offset >= m_bufferOffset) && (offset < bufferEnd)) {
+            const qint64 count = qMin(maxSize, bufferEnd - offset);
+            std::memcpy(data,
+                        m_buffer.constData() + (offset - m_bufferOffset),
+                        static_cast<size_t>(count));
+            return count;
+        }
+        if (!moveTo(offset)) {
+            return -1;
+        }
+        if (maxSize >= m_readAhead) {
+            // Large reads don't go through the buffer.
+            const qint64 count = m_device->read(data, maxSize);
+            if (count < 0) {
+                return -1;
+            }
+            m_devicePosition += count;
+            return count;
+        }
+        m_buffer.resize(static_cast<int>(m_readAhead));
+        const qint64 count = m_device->read(m_buffer.data(), m_readAhead);
+        if (count < 0) {
+            m_buffer.clear();
+            return -1;
+        }
+        m_buffer.resize(static_cast<int>(count));
+        m_bufferOffset = offset;
+        m_devicePosition += count;
+        const qint64 copied = qMin(maxSize, count);
+        std::memcpy(data, m_buffer.constData(), static_cast<size_t>(copied));
+        return copied;
+    }
+
+private:
+    bool moveTo(const qint64 offset)
+    {
+        if (offset == m_devicePosition) {
+            return true;
+        }
+        if (!m_device->isSequential()) {
+            if (!m_device->seek(offset)) {
+                return false;
+            }
+            m_devicePosition = offset;
+            return true;
+        }
+        // Sequential devices only go forward.
+        if (offset < m_devicePosition) {
+            return false;
+        }
+        const qint64 skipped = m_device->skip(offset - m_devicePosition);
+        if (skipped < 0) {
+            return false;
+        }
+        m_devicePosition += skipped;
+        return (m_devicePosition == offset);
+    }
+
+private:
+    mutable QMutex m_mutex;
+    QSharedPointer<QIODevice> m_device;
+    qint64 m_readAhead = 0;
+    qint64 m_devicePosition = 0;
+    QByteArray m_buffer = {};
+    qint64 m_bufferOffset = 0;
+};
+
+// One per stream mpv opens.
+struct Stream
+{
+    QSharedPointer<MpvStreamSource> source;
+    qint64 position = 0;
+};
+
+struct Registry
+{
+    QMutex mutex;
+    QHash<QString, QSharedPointer<MpvStreamSource>> sources = {};
+    quint64 nextId = 0;
+};
+
+Registry &registry()
+{
+    static Registry registry;
+    return registry;
+}
+
+// The hosts of the URLs of the protocol.
+const char m_sourceHost[] = "source";
+const char m_resourceHost[] = "qrc";
+
+QSharedPointer<MpvStreamSource> openResource(const QString &path)
+{
+    const QResource resource(path);
+    if (!resource.isValid() || (resource.data() == nullptr)) {
+        return {};
+    }
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    const bool compressed = (resource.compressionAlgorithm() != QResource::NoCompression);
+#else
+    const bool compressed = resource.isCompressed();
+#endif
+    if (!compressed) {
+        // Resources stay where they are as long as they're registered.
+        return QSharedPointer<MemorySource>::create(resource.data(), resource.size());
+    }
+    const QSharedPointer<QFile> file = QSharedPointer<QFile>::create(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return QSharedPointer<DeviceSource>::create(file, 4 * 1024 * 1024);
+}
+
+int64_t readStream(void *cookie, char *buf, uint64_t nbytes)
+{
+    const auto stream = static_cast<Stream *>(cookie);
+    const qint64 count = stream->source->readAt(stream->position,
+                                                buf,
+                                                static_cast<qint64>(nbytes));
+    if (count > 0) {
+        stream->position += count;
+    }
+    return count;
+}
+
+int64_t seekStream(void *cookie, int64_t offset)
+{
+    const auto stream = static_cast<Stream *>(cookie);
+    const qint64 size = stream->source->size();
+    if (size < 0) {
+        return MPV_ERROR_UNSUPPORTED;
+    }
+    if ((offset < 0) || (offset > size)) {
+        return MPV_ERROR_GENERIC;
+    }
+    stream->position = offset;
+    return offset;
+}
+
+int64_t streamSize(void *cookie)
+{
+    const qint64 size = static_cast<Stream *>(cookie)->source->size();
+    return (size >= 0) ? size : MPV_ERROR_UNSUPPORTED;
+}
+
+void closeStream(void *cookie)
+{
+    delete static_cast<Stream *>(cookie);
+}
+
+int openStream(void *user_data, char *uri, mpv_stream_cb_info *info)
+{
+    // Called on a mpv thread.
+    Q_UNUSED(user_data)
+    const QUrl url(QString::fromUtf8(uri));
+    QSharedPointer<MpvStreamSource> source = {};
+    if (url.host() == QString::fromUtf8(m_resourceHost)) {
+        source = openResource(QString::fromUtf8(":") + url.path());
+    } else if (url.host() == QString::fromUtf8(m_sourceHost)) {
+        Registry &sources = registry();
+        QMutexLocker locker(&sources.mutex);
+        source = sources.sources.value(url.path().mid(1));
+    }
+    if (!source) {
+        qCWarning(lcMpvStream) << "Nothing to play at" << url;
+        return MPV_ERROR_LOADING_FAILED;
+    }
+    info->cookie = new Stream{source, 0};
+    info->read_fn = readStream;
+    // Without a size, there's nothing to seek in.
+    info->seek_fn = (source->size() >= 0) ? seekStream : nullptr;
+    info->size_fn = streamSize;
+    info->close_fn = closeStream;
+    return 0;
+}
+
+} // namespace
+
+MpvStreamSource::~MpvStreamSource() = default;
+
+QString MpvStreamProtocol::scheme()
+{
+    return QString::fromUtf8("qtstream");
+}
+
+QUrl MpvStreamProtocol::addData(const QByteArray &data)
+{
+    return addSource(QSharedPointer<MemorySource>::create(data));
+}
+
+QUrl MpvStreamProtocol::addMemory(const uchar *data, const qint64 size)
+{
+    return addSource(QSharedPointer<MemorySource>::create(data, size));
+}
+
+QUrl MpvStreamProtocol::addDevice(const QSharedPointer<QIODevice> &device, const qint64 readAhead)
+{
+    if (!device || !device->isReadable()) {
+        qCWarning(lcMpvStream) << "The device is not open for reading.";
+        return {};
+    }
+    return addSource(QSharedPointer<DeviceSource>::create(device, readAhead));
+}
+
+QUrl MpvStreamProtocol::addSource(const QSharedPointer<MpvStreamSource> &source)
+{
+    if (!source) {
+        return {};
+    }
+    Registry &sources = registry();
+    QMutexLocker locker(&sources.mutex);
+    const QString id = QString::number(++sources.nextId);
+    sources.sources.insert(id, source);
+    QUrl url;
+    url.setScheme(scheme());
+    url.setHost(QString::fromUtf8(m_sourceHost));
+    url.setPath(QString::fromUtf8("/") + id);
+    return url;
+}
+
+void MpvStreamProtocol::remove(const QUrl &url)
+{
+    if ((url.scheme() != scheme()) || (url.host() != QString::fromUtf8(m_sourceHost))) {
+        return;
+    }
+    Registry &sources = registry();
+    QMutexLocker locker(&sources.mutex);
+    sources.sources.remove(url.path().mid(1));
+}
+
+QUrl MpvStreamProtocol::resourceUrl(const QUrl &url)
+{
+    QString path = {};
+    if (url.scheme() == QString::fromUtf8("qrc")) {
+        path = url.path();
+    } else if (url.scheme().isEmpty() && url.path().startsWith(QString::fromUtf8(":/"))) {
+        path = url.path().mid(1);
+    } else {
+        return {};
+    }
+    QUrl streamUrl;
+    streamUrl.setScheme(scheme());
+    streamUrl.setHost(QString::fromUtf8(m_resourceHost));
+    streamUrl.setPath(path);
+    return streamUrl;
+}
+
+QUrl MpvStreamProtocol::resourceFromUrl(const QUrl &url)
+{
+    if ((url.scheme() != scheme()) || (url.host() != QString::fromUtf8(m_resourceHost))) {
+        return {};
+    }
+    QUrl resource;
+    resource.setScheme(QString::fromUtf8("qrc"));
+    resource.setPath(url.path());
+    return resource;
+}
+
+bool MpvStreamProtocol::install(mpv_handle *mpv)
+{
+    const int result = mpv::qt::stream_cb_add_ro(mpv, scheme(), nullptr, openStream);
+    if (result < 0) {
+        qCWarning(lcMpvStream).noquote()
+            << "Failed to register the stream protocol:" << mpv::qt::error_string(result);
+        return false;
+    }
+    return true;
+}
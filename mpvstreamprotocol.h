@@ -0,0 +1,113 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+// Don't use any deprecated APIs from MPV.
+#ifdef MPV_ENABLE_DEPRECATED
+#undef MPV_ENABLE_DEPRECATED
+#endif
+
+#define MPV_ENABLE_DEPRECATED 0
+
+#include "mpvqthelper.hpp"
+#include <QByteArray>
+#include <QLoggingCategory>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QUrl>
+
+Q_DECLARE_LOGGING_CATEGORY(lcMpvStream)
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+// Something mpv can read media from, instead of a file or a network URL.
+// Called from mpv's demuxer threads, and possibly from several of them at
+// once if the stream is opened more than once, so implementations must be
+// thread-safe.
+class MpvStreamSource
+{
+    Q_DISABLE_COPY_MOVE(MpvStreamSource)
+
+public:
+    MpvStreamSource() = default;
+    virtual ~MpvStreamSource();
+
+    // In bytes, -1 if unknown. Seeking is only possible if it's known.
+    virtual qint64 size() const = 0;
+    // Copies up to maxSize bytes from the given offset. Returns the number
+    // of bytes read, 0 at the end and -1 on errors.
+    virtual qint64 readAt(const qint64 offset, char *data, const qint64 maxSize) = 0;
+};
+
+// A custom "qtstream://" protocol, registered on every handle, that lets
+// mpv read media from memory or from a QIODevice instead of writing it to
+// a temporary file first:
+//
+// - addData(): a QByteArray, eg: a decrypted blob. It's implicitly shared,
+//   not copied.
+// - addMemory(): any region of memory, eg: from QFile::map(), that stays
+//   valid until the source is removed and no stream uses it anymore.
+// - addDevice(): a QIODevice (a QFile, a QBuffer, an archive member...),
+//   read through a read-ahead buffer of configurable size.
+//
+// Each of them returns the URL to give to MpvObject::source (or to any
+// "loadfile"). Qt resources don't need to be added: MpvObject plays "qrc:"
+// URLs through the protocol by itself, without copying uncompressed
+// resources.
+//
+// Everything here is thread-safe.
+class MpvStreamProtocol
+{
+    Q_DISABLE_COPY_MOVE(MpvStreamProtocol)
+
+public:
+    // "qtstream"
+    static QString scheme();
+
+    static QUrl addData(const QByteArray &data);
+    static QUrl addMemory(const uchar *data, const qint64 size);
+    // The device must be open and readable, and must not be used by anyone
+    // else while it's registered: it's read from mpv's threads. Sequential
+    // devices can't seek.
+    static QUrl addDevice(const QSharedPointer<QIODevice> &device,
+                          const qint64 readAhead = 4 * 1024 * 1024);
+    static QUrl addSource(const QSharedPointer<MpvStreamSource> &source);
+    // Streams that are open keep their source until mpv closes them.
+    static void remove(const QUrl &url);
+
+    // The URL a "qrc:" URL or a ":/" path is played through.
+    static QUrl resourceUrl(const QUrl &url);
+    // The opposite, an invalid URL if it's not a resource.
+    static QUrl resourceFromUrl(const QUrl &url);
+
+    // Registers the protocol on the handle, done by MpvHandlePool and
+    // MpvHeadlessHandle.
+    static bool install(mpv_handle *mpv);
+
+private:
+    MpvStreamProtocol() = default;
+};
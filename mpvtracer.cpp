@@ -0,0 +1,339 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvtracer.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJSEngine>
+#include <QMutex>
+#include <QPointer>
+#include <QSaveFile>
+#include <QSharedPointer>
+#include <QThread>
+#include <QVector>
+#include <cstring>
+#include <memory>
+
+Q_LOGGING_CATEGORY(lcMpvTrace, "libmpv.trace.general")
+
+namespace {
+
+// Longer details are truncated, so that recording never allocates.
+const int m_detailSize = 48;
+
+struct Record
+{
+    const char *name = nullptr;
+    const char *category = nullptr;
+    // 'X' for a span, 'C' for a counter.
+    char phase = 'X';
+    qint64 timestamp = 0;
+    // The duration of a span, or the value of a counter.
+    qint64 value = 0;
+    char detail[m_detailSize] = {};
+};
+
+// Written by its thread only, read by dumps from any thread.
+struct ThreadBuffer
+{
+    std::unique_ptr<Record[]> records;
+    quint64 size = 0;
+    QAtomicInteger<quint64> head = 0;
+    int id = 0;
+    QByteArray name = {};
+};
+
+struct Registry
+{
+    QMutex mutex;
+    QVector<QSharedPointer<ThreadBuffer>> buffers = {};
+    int nextId = 1;
+    // Bumped by clear(), threads then start over with a new buffer.
+    QAtomicInt generation = 1;
+    QAtomicInt bufferSize = 65536;
+};
+
+Registry &registry()
+{
+    static Registry registry;
+    return registry;
+}
+
+struct LocalBuffer
+{
+    QSharedPointer<ThreadBuffer> buffer = {};
+    int generation = 0;
+};
+
+ThreadBuffer *localBuffer()
+{
+    // QThreadStorage would cost a lookup per record, and the buffers must
+    // work on threads Qt doesn't know about as well.
+    thread_local LocalBuffer local;
+    Registry &reg = registry();
+    const int generation = reg.generation.loadAcquire();
+    if (local.generation != generation) {
+        auto buffer = QSharedPointer<ThreadBuffer>::create();
+        buffer->size = static_cast<quint64>(reg.bufferSize.loadRelaxed());
+        buffer->records.reset(new Record[buffer->size]);
+        const QThread *thread = QThread::currentThread();
+        buffer->name = thread ? thread->objectName().toUtf8() : QByteArray();
+        if (QCoreApplication::instance() && (thread == QCoreApplication::instance()->thread())) {
+            buffer->name = "GUI thread";
+        }
+        {
+            QMutexLocker locker(&reg.mutex);
+            buffer->id = reg.nextId++;
+            if (buffer->name.isEmpty()) {
+                buffer->name = "Thread " + QByteArray::number(buffer->id);
+            }
+            reg.buffers.append(buffer);
+        }
+        local.buffer = buffer;
+        local.generation = generation;
+    }
+    return local.buffer.data();
+}
+
+void record(const char *name,
+            const char *category,
+            const char phase,
+            const qint64 timestamp,
+            const qint64 value,
+            const QByteArray &detail)
+{
+    ThreadBuffer *buffer = localBuffer();
+    const quint64 index = buffer->head.loadRelaxed();
+    Record &entry = buffer->records[index % buffer->size];
+    entry.name = name;
+    entry.category = category;
+    entry.phase = phase;
+    entry.timestamp = timestamp;
+    entry.value = value;
+    const int length = qMin(detail.size(), m_detailSize - 1);
+    std::memcpy(entry.detail, detail.constData(), length);
+    entry.detail[length] = '\0';
+    buffer->head.storeRelease(index + 1);
+}
+
+void appendString(QByteArray &json, const char *string)
+{
+    json.append('"');
+    for (const char *c = string; *c; ++c) {
+        if ((*c == '"') || (*c == '\\')) {
+            json.append('\\');
+            json.append(*c);
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            json.append(' ');
+        } else {
+            json.append(*c);
+        }
+    }
+    json.append('"');
+}
+
+// Microseconds with nanosecond precision, what the trace format expects.
+QByteArray microseconds(const qint64 nsecs)
+{
+    return QByteArray::number(nsecs / 1000) + '.'
+           + QByteArray::number(nsecs % 1000).rightJustified(3, '0');
+}
+
+} // namespace
+
+QAtomicInt MpvTracer::m_active = 0;
+
+MpvTracer *MpvTracer::instance()
+{
+    static QPointer<MpvTracer> tracer;
+    if (!tracer && QCoreApplication::instance() && !QCoreApplication::closingDown()) {
+        // Deleted together with the application object.
+        tracer = new MpvTracer(QCoreApplication::instance());
+    }
+    return tracer;
+}
+
+MpvTracer *MpvTracer::create(QQmlEngine *qmlEngine, QJSEngine *jsEngine)
+{
+    Q_UNUSED(qmlEngine)
+    Q_UNUSED(jsEngine)
+    MpvTracer *tracer = instance();
+    QJSEngine::setObjectOwnership(tracer, QJSEngine::CppOwnership);
+    return tracer;
+}
+
+MpvTracer::MpvTracer(QObject *parent) : QObject(parent)
+{
+    // Starts the clock.
+    now();
+}
+
+MpvTracer::~MpvTracer()
+{
+    m_active.storeRelaxed(0);
+}
+
+qint64 MpvTracer::now()
+{
+    static const QElapsedTimer timer = []() {
+        QElapsedTimer elapsedTimer;
+        elapsedTimer.start();
+        return elapsedTimer;
+    }();
+    return timer.nsecsElapsed();
+}
+
+void MpvTracer::complete(const char *name,
+                         const char *category,
+                         const qint64 start,
+                         const QByteArray &detail)
+{
+    if (!isActive()) {
+        return;
+    }
+    record(name, category, 'X', start, now() - start, detail);
+}
+
+void MpvTracer::counter(const char *name, const qint64 value)
+{
+    if (!isActive()) {
+        return;
+    }
+    record(name, "counter", 'C', now(), value, {});
+}
+
+bool MpvTracer::enabled() const
+{
+    return isActive();
+}
+
+int MpvTracer::bufferSize() const
+{
+    return registry().bufferSize.loadRelaxed();
+}
+
+void MpvTracer::setEnabled(const bool enabled)
+{
+    if (enabled == isActive()) {
+        return;
+    }
+    m_active.storeRelaxed(enabled ? 1 : 0);
+    Q_EMIT enabledChanged();
+}
+
+void MpvTracer::setBufferSize(const int bufferSize)
+{
+    const int newBufferSize = qMax(bufferSize, 1);
+    if (newBufferSize == this->bufferSize()) {
+        return;
+    }
+    registry().bufferSize.storeRelaxed(newBufferSize);
+    Q_EMIT bufferSizeChanged();
+}
+
+QByteArray MpvTracer::toChromeTrace() const
+{
+    QVector<QSharedPointer<ThreadBuffer>> buffers = {};
+    {
+        Registry &reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        buffers = reg.buffers;
+    }
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    QByteArray json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (auto &&buffer : qAsConst(buffers)) {
+        const QByteArray tid = QByteArray::number(buffer->id);
+        json.append(first ? "" : ",");
+        first = false;
+        json.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid
+                    + ",\"args\":{\"name\":");
+        appendString(json, buffer->name.constData());
+        json.append("}}");
+
+        // The thread keeps recording meanwhile, what it may have overwritten
+        // during the copy is dropped.
+        const quint64 head = buffer->head.loadAcquire();
+        quint64 begin = (head > buffer->size) ? (head - buffer->size) : 0;
+        const std::unique_ptr<Record[]> records(new Record[head - begin]);
+        for (quint64 i = begin; i != head; ++i) {
+            records[i - begin] = buffer->records[i % buffer->size];
+        }
+        // The slot after the head may be being written already, it's the
+        // one that held record "after - size".
+        const quint64 after = buffer->head.loadAcquire();
+        const quint64 valid = ((after + 1) > buffer->size) ? (after + 1 - buffer->size) : 0;
+        const quint64 offset = begin;
+        begin = qMax(begin, valid);
+
+        for (quint64 i = begin; i < head; ++i) {
+            const Record &entry = records[i - offset];
+            json.append(",{\"name\":");
+            appendString(json, entry.name);
+            json.append(",\"cat\":");
+            appendString(json, entry.category);
+            json.append(",\"ph\":\"");
+            json.append(entry.phase);
+            json.append("\",\"ts\":" + microseconds(entry.timestamp) + ",\"pid\":" + pid
+                        + ",\"tid\":" + tid);
+            if (entry.phase == 'C') {
+                json.append(",\"args\":{\"value\":" + QByteArray::number(entry.value) + "}}");
+                continue;
+            }
+            json.append(",\"dur\":" + microseconds(entry.value));
+            if (entry.detail[0] != '\0') {
+                json.append(",\"args\":{\"detail\":");
+                appendString(json, entry.detail);
+                json.append('}');
+            }
+            json.append('}');
+        }
+    }
+    json.append("]}");
+    return json;
+}
+
+bool MpvTracer::dump(const QString &fileName) const
+{
+    if (fileName.isEmpty()) {
+        return false;
+    }
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || (file.write(toChromeTrace()) < 0)
+        || !file.commit()) {
+        qCWarning(lcMpvTrace) << "Failed to write the trace to" << fileName;
+        return false;
+    }
+    return true;
+}
+
+void MpvTracer::clear()
+{
+    Registry &reg = registry();
+    QMutexLocker locker(&reg.mutex);
+    reg.buffers.clear();
+    reg.generation.fetchAndAddRelease(1);
+}
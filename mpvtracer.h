@@ -0,0 +1,145 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QLoggingCategory>
+#include <QObject>
+#include <QtQml/qqml.h>
+
+Q_DECLARE_LOGGING_CATEGORY(lcMpvTrace)
+
+QT_BEGIN_NAMESPACE
+class QQmlEngine;
+class QJSEngine;
+QT_END_NAMESPACE
+
+// Opt-in tracing of the player internals, to find out whether the GUI
+// thread, the render thread or libmpv is responsible for a stutter. Spans
+// (event batches, property dispatch, commands, rendering, FBO creation) and
+// counters are recorded into a ring buffer per thread, without locking, and
+// can be dumped at any time as a Chrome trace (chrome://tracing, or
+// https://ui.perfetto.dev) with nanosecond timestamps:
+//
+//     MpvTracer.enabled = true
+//     ...
+//     MpvTracer.dump("/tmp/player.json")
+//
+// When it's disabled, tracing costs one relaxed atomic load per span. Each
+// thread keeps its last "bufferSize" records, older ones are overwritten.
+class MpvTracer : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
+    Q_DISABLE_COPY_MOVE(MpvTracer)
+
+    Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(int bufferSize READ bufferSize WRITE setBufferSize NOTIFY bufferSizeChanged)
+
+public:
+    // Returns null once the application is shutting down.
+    static MpvTracer *instance();
+    static MpvTracer *create(QQmlEngine *qmlEngine, QJSEngine *jsEngine);
+
+    ~MpvTracer() override;
+
+    // The recording functions can be called from any thread. Names and
+    // categories must be string literals, they are not copied.
+    static bool isActive() { return m_active.loadRelaxed() != 0; }
+    // Monotonic, in nanoseconds.
+    static qint64 now();
+    // A span that started at "start" and ends now.
+    static void complete(const char *name,
+                         const char *category,
+                         const qint64 start,
+                         const QByteArray &detail = {});
+    static void counter(const char *name, const qint64 value);
+
+    // Disabled by default.
+    bool enabled() const;
+    // Records kept per thread, defaults to 65536. Takes effect on clear().
+    int bufferSize() const;
+
+    void setEnabled(const bool enabled);
+    void setBufferSize(const int bufferSize);
+
+    // Everything recorded so far, as Chrome trace JSON.
+    Q_INVOKABLE QByteArray toChromeTrace() const;
+    Q_INVOKABLE bool dump(const QString &fileName) const;
+    // Drops everything recorded so far.
+    Q_INVOKABLE void clear();
+
+Q_SIGNALS:
+    void enabledChanged();
+    void bufferSizeChanged();
+
+private:
+    explicit MpvTracer(QObject *parent = nullptr);
+
+private:
+    static QAtomicInt m_active;
+};
+
+// Records the span of its scope. Only looks at the clock if tracing is
+// enabled when it's created.
+class MpvTraceScope
+{
+    Q_DISABLE_COPY_MOVE(MpvTraceScope)
+
+public:
+    explicit MpvTraceScope(const char *name, const char *category)
+        : m_name(name), m_category(category), m_start(MpvTracer::isActive() ? MpvTracer::now() : -1)
+    {}
+    ~MpvTraceScope()
+    {
+        if (m_start >= 0) {
+            MpvTracer::complete(m_name, m_category, m_start, m_detail);
+        }
+    }
+
+    bool isActive() const { return m_start >= 0; }
+    // Shown in the "args" of the span. Only copied when tracing, check
+    // isActive() first if building it is expensive.
+    void setDetail(const char *detail)
+    {
+        if (m_start >= 0) {
+            m_detail = detail;
+        }
+    }
+    void setDetail(const QString &detail)
+    {
+        if (m_start >= 0) {
+            m_detail = detail.toUtf8();
+        }
+    }
+
+private:
+    const char *m_name = nullptr;
+    const char *m_category = nullptr;
+    qint64 m_start = -1;
+    QByteArray m_detail = {};
+};
@@ -0,0 +1,547 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpvwaveform.h"
+#include "mpvaudiokernels.h"
+#include "mpvheadlesshandle.h"
+#include "mpvmediacache.h"
+#include "mpvpcmpipe.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QElapsedTimer>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+struct MpvWaveform::Job
+{
+    QUrl source = QUrl();
+    int sampleRate = 0;
+    int binsPerSecond = 0;
+    bool cacheEnabled = true;
+    QAtomicInt cancelled = 0;
+};
+
+namespace {
+
+const QString m_cacheSuffix = QString::fromUtf8("peaks");
+const quint32 m_cacheFormatVersion = 1;
+
+// Stop halving once a level is this small.
+const int m_minimumBinCount = 64;
+const int m_maximumLevelCount = 16;
+
+// How many bytes of PCM are pulled out of the pipe at once.
+const int m_readBufferSize = 64 * 1024;
+const int m_progressInterval = 250;
+
+QVariantMap waveformOptions(const QString &pcmPath, const int sampleRate)
+{
+    return QVariantMap{{QString::fromUtf8("ao"), QString::fromUtf8("pcm")},
+                       {QString::fromUtf8("ao-pcm-file"), QDir::toNativeSeparators(pcmPath)},
+                       {QString::fromUtf8("ao-pcm-waveheader"), false},
+                       {QString::fromUtf8("audio-format"), QString::fromUtf8("float")},
+                       {QString::fromUtf8("audio-channels"), QString::fromUtf8("mono")},
+                       {QString::fromUtf8("audio-samplerate"), sampleRate},
+                       {QString::fromUtf8("vid"), QString::fromUtf8("no")},
+                       {QString::fromUtf8("sid"), QString::fromUtf8("no")},
+                       // We need MPV_EVENT_END_FILE at the end of the file.
+                       {QString::fromUtf8("keep-open"), QString::fromUtf8("no")}};
+}
+
+// Accumulates the decoded samples into fixed-size bins.
+class BinAccumulator
+{
+public:
+    explicit BinAccumulator(const int samplesPerBin, MpvWaveform::Level &level)
+        : m_samplesPerBin(samplesPerBin), m_level(level)
+    {
+        reset();
+    }
+
+    void addSamples(const float *samples, const int count)
+    {
+        int offset = 0;
+        while (offset < count) {
+            const int take = qMin(count - offset, m_samplesPerBin - m_filled);
+            mpv::kernels::accumulate_peaks(samples + offset, take, m_min, m_max, m_sumSquares);
+            m_filled += take;
+            m_totalSamples += take;
+            offset += take;
+            if (m_filled == m_samplesPerBin) {
+                flush();
+            }
+        }
+    }
+
+    // Appends the last, partially filled bin.
+    void finish()
+    {
+        if (m_filled > 0) {
+            flush();
+        }
+    }
+
+    qint64 totalSamples() const { return m_totalSamples; }
+
+private:
+    void reset()
+    {
+        m_min = std::numeric_limits<float>::max();
+        m_max = std::numeric_limits<float>::lowest();
+        m_sumSquares = 0.0;
+        m_filled = 0;
+    }
+
+    void flush()
+    {
+        m_level.mins.append(m_min);
+        m_level.maxs.append(m_max);
+        m_level.rms.append(static_cast<float>(std::sqrt(m_sumSquares / m_filled)));
+        reset();
+    }
+
+    const int m_samplesPerBin;
+    MpvWaveform::Level &m_level;
+    float m_min = 0.0f;
+    float m_max = 0.0f;
+    double m_sumSquares = 0.0;
+    int m_filled = 0;
+    qint64 m_totalSamples = 0;
+};
+
+} // namespace
+
+MpvWaveform::MpvWaveform(QObject *parent) : QObject(parent)
+{
+    m_threadPool.setMaxThreadCount(1);
+}
+
+MpvWaveform::~MpvWaveform()
+{
+    cancel();
+    m_threadPool.waitForDone();
+}
+
+QUrl MpvWaveform::source() const
+{
+    return currentSource;
+}
+
+int MpvWaveform::sampleRate() const
+{
+    return currentSampleRate;
+}
+
+int MpvWaveform::binsPerSecond() const
+{
+    return currentBinsPerSecond;
+}
+
+bool MpvWaveform::cacheEnabled() const
+{
+    return currentCacheEnabled;
+}
+
+bool MpvWaveform::running() const
+{
+    return !m_job.isNull();
+}
+
+bool MpvWaveform::ready() const
+{
+    return !m_envelope.levels.isEmpty();
+}
+
+qreal MpvWaveform::progress() const
+{
+    return currentProgress;
+}
+
+qreal MpvWaveform::duration() const
+{
+    return m_envelope.duration;
+}
+
+int MpvWaveform::levelCount() const
+{
+    return m_envelope.levels.size();
+}
+
+void MpvWaveform::setSource(const QUrl &source)
+{
+    if (source == currentSource) {
+        return;
+    }
+    currentSource = source;
+    Q_EMIT sourceChanged();
+}
+
+void MpvWaveform::setSampleRate(const int sampleRate)
+{
+    const int rate = qBound(1000, sampleRate, 48000);
+    if (rate == currentSampleRate) {
+        return;
+    }
+    currentSampleRate = rate;
+    Q_EMIT sampleRateChanged();
+}
+
+void MpvWaveform::setBinsPerSecond(const int binsPerSecond)
+{
+    const int bins = qBound(1, binsPerSecond, 1000);
+    if (bins == currentBinsPerSecond) {
+        return;
+    }
+    currentBinsPerSecond = bins;
+    Q_EMIT binsPerSecondChanged();
+}
+
+void MpvWaveform::setCacheEnabled(const bool cacheEnabled)
+{
+    if (cacheEnabled == currentCacheEnabled) {
+        return;
+    }
+    currentCacheEnabled = cacheEnabled;
+    Q_EMIT cacheEnabledChanged();
+}
+
+int MpvWaveform::binCount(const int level) const
+{
+    if ((level < 0) || (level >= m_envelope.levels.size())) {
+        return 0;
+    }
+    return m_envelope.levels.at(level).mins.size();
+}
+
+qreal MpvWaveform::binDuration(const int level) const
+{
+    if ((level < 0) || (level >= m_envelope.levels.size()) || (m_envelope.binsPerSecond <= 0)) {
+        return 0.0;
+    }
+    return static_cast<qreal>(1 << level) / m_envelope.binsPerSecond;
+}
+
+int MpvWaveform::levelForWidth(const int width) const
+{
+    for (int i = m_envelope.levels.size() - 1; i > 0; --i) {
+        if (m_envelope.levels.at(i).mins.size() >= width) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+QList<qreal> MpvWaveform::peaks(const int level) const
+{
+    if ((level < 0) || (level >= m_envelope.levels.size())) {
+        return {};
+    }
+    const Level &data = m_envelope.levels.at(level);
+    QList<qreal> result = {};
+    result.reserve(data.mins.size() * 3);
+    for (int i = 0; i != data.mins.size(); ++i) {
+        result.append(data.mins.at(i));
+        result.append(data.maxs.at(i));
+        result.append(data.rms.at(i));
+    }
+    return result;
+}
+
+MpvWaveform::Level MpvWaveform::level(const int level) const
+{
+    return m_envelope.levels.value(level);
+}
+
+bool MpvWaveform::analyze()
+{
+    if (running() || !currentSource.isValid()) {
+        return false;
+    }
+    const auto job = QSharedPointer<Job>::create();
+    job->source = currentSource;
+    job->sampleRate = currentSampleRate;
+    job->binsPerSecond = qMin(currentBinsPerSecond, currentSampleRate);
+    job->cacheEnabled = currentCacheEnabled;
+    m_job = job;
+    currentProgress = 0.0;
+    Q_EMIT runningChanged();
+    Q_EMIT progressChanged();
+    Q_EMIT started();
+    m_threadPool.start([this, job]() { runJob(job); });
+    return true;
+}
+
+void MpvWaveform::cancel()
+{
+    if (m_job) {
+        m_job->cancelled.storeRelease(1);
+    }
+}
+
+void MpvWaveform::clear()
+{
+    if (m_envelope.levels.isEmpty()) {
+        return;
+    }
+    m_envelope = {};
+    Q_EMIT envelopeChanged();
+}
+
+void MpvWaveform::buildLevels(Envelope &envelope)
+{
+    if (envelope.levels.isEmpty()) {
+        return;
+    }
+    envelope.levels.resize(1);
+    while (envelope.levels.size() < m_maximumLevelCount) {
+        const Level &finer = envelope.levels.constLast();
+        const int count = finer.mins.size();
+        if ((count / 2) < m_minimumBinCount) {
+            break;
+        }
+        Level coarser = {};
+        const int coarserCount = (count + 1) / 2;
+        coarser.mins.resize(coarserCount);
+        coarser.maxs.resize(coarserCount);
+        coarser.rms.resize(coarserCount);
+        mpv::kernels::reduce_envelope(finer.mins.constData(),
+                                      finer.maxs.constData(),
+                                      finer.rms.constData(),
+                                      count,
+                                      coarser.mins.data(),
+                                      coarser.maxs.data(),
+                                      coarser.rms.data());
+        if ((count % 2) != 0) {
+            coarser.mins.last() = finer.mins.constLast();
+            coarser.maxs.last() = finer.maxs.constLast();
+            coarser.rms.last() = finer.rms.constLast();
+        }
+        envelope.levels.append(coarser);
+    }
+}
+
+QByteArray MpvWaveform::serialize(const Envelope &envelope)
+{
+    if (envelope.levels.isEmpty()) {
+        return {};
+    }
+    // Only the finest level is stored, the others are cheap to rebuild.
+    const Level &level = envelope.levels.constFirst();
+    const auto byteCount = static_cast<int>(level.mins.size() * sizeof(float));
+    QByteArray data = {};
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << m_cacheFormatVersion << qint32(envelope.sampleRate)
+           << qint32(envelope.binsPerSecond) << envelope.duration << qint32(level.mins.size());
+    // Raw native floats: the cache never leaves this machine.
+    stream.writeRawData(reinterpret_cast<const char *>(level.mins.constData()), byteCount);
+    stream.writeRawData(reinterpret_cast<const char *>(level.maxs.constData()), byteCount);
+    stream.writeRawData(reinterpret_cast<const char *>(level.rms.constData()), byteCount);
+    return data;
+}
+
+bool MpvWaveform::deserialize(const QByteArray &data, Envelope &envelope)
+{
+    if (data.isEmpty()) {
+        return false;
+    }
+    QDataStream stream(data);
+    quint32 version = 0;
+    qint32 sampleRate = 0, binsPerSecond = 0, count = 0;
+    qreal duration = 0.0;
+    stream >> version >> sampleRate >> binsPerSecond >> duration >> count;
+    if ((stream.status() != QDataStream::Ok) || (version != m_cacheFormatVersion)
+        || (count <= 0)) {
+        return false;
+    }
+    Level level = {};
+    level.mins.resize(count);
+    level.maxs.resize(count);
+    level.rms.resize(count);
+    const auto byteCount = static_cast<int>(count * sizeof(float));
+    if ((stream.readRawData(reinterpret_cast<char *>(level.mins.data()), byteCount) != byteCount)
+        || (stream.readRawData(reinterpret_cast<char *>(level.maxs.data()), byteCount)
+            != byteCount)
+        || (stream.readRawData(reinterpret_cast<char *>(level.rms.data()), byteCount)
+            != byteCount)) {
+        return false;
+    }
+    envelope.sampleRate = sampleRate;
+    envelope.binsPerSecond = binsPerSecond;
+    envelope.duration = duration;
+    envelope.levels = {level};
+    return true;
+}
+
+void MpvWaveform::runJob(const QSharedPointer<Job> &job)
+{
+    // Runs in the thread pool.
+    Envelope envelope = {};
+    bool success = false;
+    if (job->cacheEnabled) {
+        success = deserialize(MpvMediaCache::load(job->source, m_cacheSuffix), envelope)
+                  && (envelope.sampleRate == job->sampleRate)
+                  && (envelope.binsPerSecond == job->binsPerSecond);
+    }
+    if (!success) {
+        envelope = {};
+        success = decode(job, envelope);
+        if (success && job->cacheEnabled
+            && !MpvMediaCache::save(job->source, m_cacheSuffix, serialize(envelope))) {
+            qCWarning(lcMpvHeadless) << "Failed to cache the waveform of" << job->source;
+        }
+    }
+    if (success) {
+        buildLevels(envelope);
+    }
+    QMetaObject::invokeMethod(
+        this,
+        [this, job, envelope, success]() { finishJob(job, envelope, success); },
+        Qt::QueuedConnection);
+}
+
+bool MpvWaveform::decode(const QSharedPointer<Job> &job, Envelope &envelope)
+{
+    // Runs in the thread pool.
+    MpvPcmPipe pipe;
+    if (!pipe.open()) {
+        qCWarning(lcMpvHeadless) << "Failed to create the PCM pipe" << pipe.path();
+        return false;
+    }
+    MpvHeadlessHandle mpv(waveformOptions(pipe.path(), job->sampleRate), &job->cancelled);
+    if (!mpv.isValid()
+        || !mpv.command(QVariantList{QString::fromUtf8("loadfile"),
+                                     job->source.isLocalFile()
+                                         ? QDir::toNativeSeparators(job->source.toLocalFile())
+                                         : job->source.url()})) {
+        return false;
+    }
+
+    envelope.sampleRate = job->sampleRate;
+    envelope.binsPerSecond = job->binsPerSecond;
+    envelope.levels.resize(1);
+    BinAccumulator accumulator(job->sampleRate / job->binsPerSecond, envelope.levels[0]);
+
+    std::vector<char> buffer(m_readBufferSize);
+    int pending = 0; // Bytes of an incomplete sample left from the last read.
+    bool ended = false;
+    qreal duration = 0.0;
+    QElapsedTimer progressTimer;
+    progressTimer.start();
+    while (!mpv.isCancelled()) {
+        // mpv may block while the pipe is full, so never wait for events
+        // here, just drain whatever has arrived.
+        while (const mpv_event *event = mpv.pollEvent()) {
+            if (event->event_id == MPV_EVENT_NONE) {
+                break;
+            }
+            if (event->event_id == MPV_EVENT_SHUTDOWN) {
+                return false;
+            }
+            if (event->event_id == MPV_EVENT_END_FILE) {
+                const auto e = static_cast<const mpv_event_end_file *>(event->data);
+                if (e->reason == MPV_END_FILE_REASON_ERROR) {
+                    qCWarning(lcMpvHeadless).noquote()
+                        << "Failed to decode the audio:" << mpv::qt::error_string(e->error);
+                    return false;
+                }
+                ended = true;
+                pipe.setWriterFinished();
+            }
+        }
+        const qint64 bytesRead = pipe.read(buffer.data() + pending,
+                                           static_cast<qint64>(buffer.size()) - pending,
+                                           50);
+        if (bytesRead < 0) {
+            break;
+        }
+        if (bytesRead == 0) {
+            // Everything has been written once the file has ended.
+            if (ended) {
+                break;
+            }
+            continue;
+        }
+        const auto available = static_cast<int>(pending + bytesRead);
+        const int sampleCount = available / static_cast<int>(sizeof(float));
+        const int consumed = sampleCount * static_cast<int>(sizeof(float));
+        // The buffer comes from std::vector<char>, which is suitably aligned.
+        accumulator.addSamples(reinterpret_cast<const float *>(buffer.data()), sampleCount);
+        pending = available - consumed;
+        if (pending > 0) {
+            std::memmove(buffer.data(), buffer.data() + consumed, static_cast<size_t>(pending));
+        }
+        if (progressTimer.elapsed() >= m_progressInterval) {
+            progressTimer.restart();
+            if (duration <= 0.0) {
+                duration = mpv.getProperty(QString::fromUtf8("duration")).toReal();
+            }
+            if (duration > 0.0) {
+                const qreal progress = qBound(0.0,
+                                              accumulator.totalSamples()
+                                                  / static_cast<qreal>(job->sampleRate) / duration,
+                                              1.0);
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, job, progress]() {
+                        if ((job != m_job) || qFuzzyCompare(progress, currentProgress)) {
+                            return;
+                        }
+                        currentProgress = progress;
+                        Q_EMIT progressChanged();
+                    },
+                    Qt::QueuedConnection);
+            }
+        }
+    }
+    if (mpv.isCancelled()) {
+        return false;
+    }
+    accumulator.finish();
+    if (accumulator.totalSamples() <= 0) {
+        qCWarning(lcMpvHeadless) << "No audio has been decoded from" << job->source;
+        return false;
+    }
+    envelope.duration = accumulator.totalSamples() / static_cast<qreal>(job->sampleRate);
+    return true;
+}
+
+void MpvWaveform::finishJob(const QSharedPointer<Job> &job,
+                            const Envelope &envelope,
+                            const bool success)
+{
+    if (job != m_job) {
+        return;
+    }
+    m_job.reset();
+    if (success) {
+        m_envelope = envelope;
+        currentProgress = 1.0;
+        Q_EMIT envelopeChanged();
+    }
+    Q_EMIT runningChanged();
+    Q_EMIT progressChanged();
+    Q_EMIT finished(success);
+}
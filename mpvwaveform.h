@@ -0,0 +1,153 @@
+/*
+ * MIT License
+ *
+ * Copyright (C) 2020 by wangwenx190 (Yuhang Zhao)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QUrl>
+#include <QVector>
+#include <QtQml/qqml.h>
+
+// Computes the audio overview of a file, eg: to draw a waveform along the
+// seek bar. The audio track is decoded by a headless mpv handle on a worker
+// thread, downmixed to mono, resampled to a low rate and streamed through a
+// pipe into min/max/RMS reduction kernels, so the memory usage only depends
+// on the length of the envelope, never on the length of the PCM data. The
+// envelope is stored at several zoom levels, each one having half the
+// resolution of the previous one, and is cached alongside the media.
+class MpvWaveform : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_DISABLE_COPY_MOVE(MpvWaveform)
+
+    Q_PROPERTY(QUrl source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(int sampleRate READ sampleRate WRITE setSampleRate NOTIFY sampleRateChanged)
+    Q_PROPERTY(
+        int binsPerSecond READ binsPerSecond WRITE setBinsPerSecond NOTIFY binsPerSecondChanged)
+    Q_PROPERTY(bool cacheEnabled READ cacheEnabled WRITE setCacheEnabled NOTIFY cacheEnabledChanged)
+    Q_PROPERTY(bool running READ running NOTIFY runningChanged)
+    Q_PROPERTY(bool ready READ ready NOTIFY envelopeChanged)
+    Q_PROPERTY(qreal progress READ progress NOTIFY progressChanged)
+    Q_PROPERTY(qreal duration READ duration NOTIFY envelopeChanged)
+    Q_PROPERTY(int levelCount READ levelCount NOTIFY envelopeChanged)
+
+public:
+    // One zoom level of the envelope, all vectors have the same size.
+    struct Level
+    {
+        QVector<float> mins = {};
+        QVector<float> maxs = {};
+        QVector<float> rms = {};
+    };
+
+    explicit MpvWaveform(QObject *parent = nullptr);
+    ~MpvWaveform() override;
+
+    QUrl source() const;
+    // The audio is resampled to this rate (in Hz) before being analyzed.
+    // Peaks above half of it are filtered out, which doesn't matter for a
+    // picture that is a few hundred pixels wide. Defaults to 8000.
+    int sampleRate() const;
+    // Resolution of the finest zoom level. Defaults to 50, which is about
+    // 13 MiB for all the levels of a 3 hours file.
+    int binsPerSecond() const;
+    // Load the envelope from (and save it to) the cache. Defaults to true.
+    bool cacheEnabled() const;
+    bool running() const;
+    bool ready() const;
+    // 0.0 - 1.0
+    qreal progress() const;
+    // Length of the analyzed audio, in seconds.
+    qreal duration() const;
+    int levelCount() const;
+
+    void setSource(const QUrl &source);
+    void setSampleRate(const int sampleRate);
+    void setBinsPerSecond(const int binsPerSecond);
+    void setCacheEnabled(const bool cacheEnabled);
+
+    // Number of bins of the given level, level 0 being the finest.
+    Q_INVOKABLE int binCount(const int level) const;
+    // How many seconds of audio one bin of the given level covers.
+    Q_INVOKABLE qreal binDuration(const int level) const;
+    // Returns the coarsest level that still has at least "width" bins, so
+    // that drawing it doesn't need to touch more data than there are pixels.
+    Q_INVOKABLE int levelForWidth(const int width) const;
+    // Returns the given level as a flat array of interleaved
+    // [min, max, rms] triples, in the range -1.0 - 1.0.
+    Q_INVOKABLE QList<qreal> peaks(const int level) const;
+    Level level(const int level) const;
+
+public Q_SLOTS:
+    // Starts analyzing the current source. Returns false if a job is
+    // already running.
+    bool analyze();
+    void cancel();
+    // Release the envelope.
+    void clear();
+
+Q_SIGNALS:
+    void started();
+    void finished(bool success);
+
+    void sourceChanged();
+    void sampleRateChanged();
+    void binsPerSecondChanged();
+    void cacheEnabledChanged();
+    void runningChanged();
+    void progressChanged();
+    void envelopeChanged();
+
+private:
+    struct Job;
+    struct Envelope
+    {
+        int sampleRate = 0;
+        int binsPerSecond = 0;
+        qreal duration = 0.0;
+        QVector<Level> levels = {};
+    };
+
+    static void buildLevels(Envelope &envelope);
+    static QByteArray serialize(const Envelope &envelope);
+    static bool deserialize(const QByteArray &data, Envelope &envelope);
+
+    void runJob(const QSharedPointer<Job> &job);
+    bool decode(const QSharedPointer<Job> &job, Envelope &envelope);
+    void finishJob(const QSharedPointer<Job> &job, const Envelope &envelope, const bool success);
+
+private:
+    QUrl currentSource = QUrl();
+    int currentSampleRate = 8000;
+    int currentBinsPerSecond = 50;
+    bool currentCacheEnabled = true;
+    qreal currentProgress = 0.0;
+
+    QThreadPool m_threadPool;
+    QSharedPointer<Job> m_job;
+    Envelope m_envelope = {};
+};
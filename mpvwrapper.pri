@@ -0,0 +1,83 @@
+# The wrapper itself: everything but the QML plugin entry point, shared by
+# the plugin and the benchmarks.
+QT += quick
+unix: !android: !macx: QT += x11extras
+CONFIG += c++17 strict_c++ warn_on rtti_off exceptions_off
+DEFINES += MPV_ENABLE_DEPRECATED=0
+dynamic_libmpv: DEFINES += WWX190_DYNAMIC_LIBMPV
+win32: !mingw {
+    # You can download shinchiro's libmpv SDK (build from mpv's master branch) from:
+    # https://sourceforge.net/projects/mpv-player-windows/files/libmpv/
+    isEmpty(MPV_SDK_DIR) {
+        error(You have to setup \"MPV_SDK_DIR\" in \".qmake.conf\" first!)
+    } else {
+        MPV_BIN_DIR = $$MPV_SDK_DIR/bin
+        MPV_BIN_DIR_EX = $$MPV_BIN_DIR/x
+        MPV_LIB_DIR = $$MPV_SDK_DIR/lib
+        MPV_LIB_DIR_EX = $$MPV_LIB_DIR/x
+        contains(QMAKE_TARGET.arch, x86_64) {
+            MPV_BIN_DIR_EX = $$join(MPV_BIN_DIR_EX,,,64)
+            MPV_LIB_DIR_EX = $$join(MPV_LIB_DIR_EX,,,64)
+        } else {
+            MPV_BIN_DIR_EX = $$join(MPV_BIN_DIR_EX,,,86)
+            MPV_LIB_DIR_EX = $$join(MPV_LIB_DIR_EX,,,86)
+        }
+        INCLUDEPATH += $$MPV_SDK_DIR/include
+        # How to generate the import library file for MSVC:
+        # lib.exe /def:mpv.def /name:mpv.dll /out:mpv.lib /MACHINE:X64
+        !dynamic_libmpv: LIBS += -L$$MPV_SDK_DIR -L$$MPV_LIB_DIR -L$$MPV_LIB_DIR_EX -lmpv
+        libmpv.path = $$[QT_INSTALL_BINS]
+        libmpv.files = $$MPV_BIN_DIR/*.dll $$MPV_BIN_DIR_EX/*.dll
+        INSTALLS += libmpv
+    }
+} else: !dynamic_libmpv {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += mpv
+}
+INCLUDEPATH += $$PWD
+HEADERS += \
+    $$PWD/mpvaudioanalyzer.h \
+    $$PWD/mpvaudiokernels.h \
+    $$PWD/mpvcachetelemetry.h \
+    $$PWD/mpvcore.h \
+    $$PWD/mpveventdispatcher.h \
+    $$PWD/mpvframeextractor.h \
+    $$PWD/mpvframetap.h \
+    $$PWD/mpvhandlepool.h \
+    $$PWD/mpvheadlesshandle.h \
+    $$PWD/mpvkeyframeindex.h \
+    $$PWD/mpvlatencytracker.h \
+    $$PWD/mpvlogsink.h \
+    $$PWD/mpvmediamodels.h \
+    $$PWD/mpvmediacache.h \
+    $$PWD/mpvobject.h \
+    $$PWD/mpvpcmpipe.h \
+    $$PWD/mpvperformancemonitor.h \
+    $$PWD/mpvplaylistmodel.h \
+    $$PWD/mpvqthelper.hpp \
+    $$PWD/mpvresourcescheduler.h \
+    $$PWD/mpvstreamprotocol.h \
+    $$PWD/mpvtracer.h \
+    $$PWD/mpvwaveform.h
+SOURCES += \
+    $$PWD/mpvaudioanalyzer.cpp \
+    $$PWD/mpvcachetelemetry.cpp \
+    $$PWD/mpvcore.cpp \
+    $$PWD/mpveventdispatcher.cpp \
+    $$PWD/mpvframeextractor.cpp \
+    $$PWD/mpvframetap.cpp \
+    $$PWD/mpvhandlepool.cpp \
+    $$PWD/mpvheadlesshandle.cpp \
+    $$PWD/mpvkeyframeindex.cpp \
+    $$PWD/mpvlatencytracker.cpp \
+    $$PWD/mpvlogsink.cpp \
+    $$PWD/mpvmediamodels.cpp \
+    $$PWD/mpvmediacache.cpp \
+    $$PWD/mpvobject.cpp \
+    $$PWD/mpvpcmpipe.cpp \
+    $$PWD/mpvperformancemonitor.cpp \
+    $$PWD/mpvplaylistmodel.cpp \
+    $$PWD/mpvresourcescheduler.cpp \
+    $$PWD/mpvstreamprotocol.cpp \
+    $$PWD/mpvtracer.cpp \
+    $$PWD/mpvwaveform.cpp